@@ -0,0 +1,47 @@
+# CMAKE generated file: DO NOT EDIT!
+# Generated by CMake Version 3.25
+cmake_policy(SET CMP0009 NEW)
+
+# SRC_FILES at CMakeLists.txt:23 (file)
+file(GLOB NEW_GLOB LIST_DIRECTORIES true "/root/repo/src/*.c")
+set(OLD_GLOB
+  "/root/repo/src/arena.c"
+  "/root/repo/src/checker.c"
+  "/root/repo/src/codegen.c"
+  "/root/repo/src/errors.c"
+  "/root/repo/src/lexer.c"
+  "/root/repo/src/main.c"
+  "/root/repo/src/parser.c"
+  "/root/repo/src/ring.c"
+  "/root/repo/src/scan.c"
+  "/root/repo/src/source.c"
+  "/root/repo/src/symbols.c"
+  "/root/repo/src/verifier.c"
+  "/root/repo/src/watch.c"
+  )
+if(NOT "${NEW_GLOB}" STREQUAL "${OLD_GLOB}")
+  message("-- GLOB mismatch!")
+  file(TOUCH_NOCREATE "/root/repo/_gate_rel/CMakeFiles/cmake.verify_globs")
+endif()
+
+# HDR_FILES at CMakeLists.txt:24 (file)
+file(GLOB NEW_GLOB LIST_DIRECTORIES true "/root/repo/src/*.h")
+set(OLD_GLOB
+  "/root/repo/src/arena.h"
+  "/root/repo/src/checker.h"
+  "/root/repo/src/codegen.h"
+  "/root/repo/src/colours.h"
+  "/root/repo/src/errors.h"
+  "/root/repo/src/lexer.h"
+  "/root/repo/src/parser.h"
+  "/root/repo/src/ring.h"
+  "/root/repo/src/scan.h"
+  "/root/repo/src/source.h"
+  "/root/repo/src/symbols.h"
+  "/root/repo/src/verifier.h"
+  "/root/repo/src/watch.h"
+  )
+if(NOT "${NEW_GLOB}" STREQUAL "${OLD_GLOB}")
+  message("-- GLOB mismatch!")
+  file(TOUCH_NOCREATE "/root/repo/_gate_rel/CMakeFiles/cmake.verify_globs")
+endif()
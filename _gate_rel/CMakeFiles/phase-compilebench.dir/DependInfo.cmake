@@ -0,0 +1,29 @@
+
+# Consider dependencies only in project.
+set(CMAKE_DEPENDS_IN_PROJECT_ONLY OFF)
+
+# The set of languages for which implicit dependencies are needed:
+set(CMAKE_DEPENDS_LANGUAGES
+  )
+
+# The set of dependency files which are needed:
+set(CMAKE_DEPENDS_DEPENDENCY_FILES
+  "/root/repo/benchmarks/compile_bench.c" "CMakeFiles/phase-compilebench.dir/benchmarks/compile_bench.c.o" "gcc" "CMakeFiles/phase-compilebench.dir/benchmarks/compile_bench.c.o.d"
+  "/root/repo/src/arena.c" "CMakeFiles/phase-compilebench.dir/src/arena.c.o" "gcc" "CMakeFiles/phase-compilebench.dir/src/arena.c.o.d"
+  "/root/repo/src/checker.c" "CMakeFiles/phase-compilebench.dir/src/checker.c.o" "gcc" "CMakeFiles/phase-compilebench.dir/src/checker.c.o.d"
+  "/root/repo/src/codegen.c" "CMakeFiles/phase-compilebench.dir/src/codegen.c.o" "gcc" "CMakeFiles/phase-compilebench.dir/src/codegen.c.o.d"
+  "/root/repo/src/errors.c" "CMakeFiles/phase-compilebench.dir/src/errors.c.o" "gcc" "CMakeFiles/phase-compilebench.dir/src/errors.c.o.d"
+  "/root/repo/src/lexer.c" "CMakeFiles/phase-compilebench.dir/src/lexer.c.o" "gcc" "CMakeFiles/phase-compilebench.dir/src/lexer.c.o.d"
+  "/root/repo/src/parser.c" "CMakeFiles/phase-compilebench.dir/src/parser.c.o" "gcc" "CMakeFiles/phase-compilebench.dir/src/parser.c.o.d"
+  "/root/repo/src/ring.c" "CMakeFiles/phase-compilebench.dir/src/ring.c.o" "gcc" "CMakeFiles/phase-compilebench.dir/src/ring.c.o.d"
+  "/root/repo/src/scan.c" "CMakeFiles/phase-compilebench.dir/src/scan.c.o" "gcc" "CMakeFiles/phase-compilebench.dir/src/scan.c.o.d"
+  "/root/repo/src/source.c" "CMakeFiles/phase-compilebench.dir/src/source.c.o" "gcc" "CMakeFiles/phase-compilebench.dir/src/source.c.o.d"
+  "/root/repo/src/symbols.c" "CMakeFiles/phase-compilebench.dir/src/symbols.c.o" "gcc" "CMakeFiles/phase-compilebench.dir/src/symbols.c.o.d"
+  )
+
+# Targets to which this target links.
+set(CMAKE_TARGET_LINKED_INFO_FILES
+  )
+
+# Fortran module output directory.
+set(CMAKE_Fortran_TARGET_MODULE_DIR "")
@@ -0,0 +1,31 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/phase-compilebench.dir/benchmarks/compile_bench.c.o"
+  "CMakeFiles/phase-compilebench.dir/benchmarks/compile_bench.c.o.d"
+  "CMakeFiles/phase-compilebench.dir/src/arena.c.o"
+  "CMakeFiles/phase-compilebench.dir/src/arena.c.o.d"
+  "CMakeFiles/phase-compilebench.dir/src/checker.c.o"
+  "CMakeFiles/phase-compilebench.dir/src/checker.c.o.d"
+  "CMakeFiles/phase-compilebench.dir/src/codegen.c.o"
+  "CMakeFiles/phase-compilebench.dir/src/codegen.c.o.d"
+  "CMakeFiles/phase-compilebench.dir/src/errors.c.o"
+  "CMakeFiles/phase-compilebench.dir/src/errors.c.o.d"
+  "CMakeFiles/phase-compilebench.dir/src/lexer.c.o"
+  "CMakeFiles/phase-compilebench.dir/src/lexer.c.o.d"
+  "CMakeFiles/phase-compilebench.dir/src/parser.c.o"
+  "CMakeFiles/phase-compilebench.dir/src/parser.c.o.d"
+  "CMakeFiles/phase-compilebench.dir/src/ring.c.o"
+  "CMakeFiles/phase-compilebench.dir/src/ring.c.o.d"
+  "CMakeFiles/phase-compilebench.dir/src/scan.c.o"
+  "CMakeFiles/phase-compilebench.dir/src/scan.c.o.d"
+  "CMakeFiles/phase-compilebench.dir/src/source.c.o"
+  "CMakeFiles/phase-compilebench.dir/src/source.c.o.d"
+  "CMakeFiles/phase-compilebench.dir/src/symbols.c.o"
+  "CMakeFiles/phase-compilebench.dir/src/symbols.c.o.d"
+  "phase-compilebench"
+  "phase-compilebench.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang C)
+  include(CMakeFiles/phase-compilebench.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,21 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/phase-lexbench.dir/benchmarks/lex_bench.c.o"
+  "CMakeFiles/phase-lexbench.dir/benchmarks/lex_bench.c.o.d"
+  "CMakeFiles/phase-lexbench.dir/src/arena.c.o"
+  "CMakeFiles/phase-lexbench.dir/src/arena.c.o.d"
+  "CMakeFiles/phase-lexbench.dir/src/errors.c.o"
+  "CMakeFiles/phase-lexbench.dir/src/errors.c.o.d"
+  "CMakeFiles/phase-lexbench.dir/src/lexer.c.o"
+  "CMakeFiles/phase-lexbench.dir/src/lexer.c.o.d"
+  "CMakeFiles/phase-lexbench.dir/src/scan.c.o"
+  "CMakeFiles/phase-lexbench.dir/src/scan.c.o.d"
+  "CMakeFiles/phase-lexbench.dir/src/source.c.o"
+  "CMakeFiles/phase-lexbench.dir/src/source.c.o.d"
+  "phase-lexbench"
+  "phase-lexbench.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang C)
+  include(CMakeFiles/phase-lexbench.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
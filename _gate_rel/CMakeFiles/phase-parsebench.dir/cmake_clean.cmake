@@ -0,0 +1,25 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/phase-parsebench.dir/benchmarks/parse_bench.c.o"
+  "CMakeFiles/phase-parsebench.dir/benchmarks/parse_bench.c.o.d"
+  "CMakeFiles/phase-parsebench.dir/src/arena.c.o"
+  "CMakeFiles/phase-parsebench.dir/src/arena.c.o.d"
+  "CMakeFiles/phase-parsebench.dir/src/errors.c.o"
+  "CMakeFiles/phase-parsebench.dir/src/errors.c.o.d"
+  "CMakeFiles/phase-parsebench.dir/src/lexer.c.o"
+  "CMakeFiles/phase-parsebench.dir/src/lexer.c.o.d"
+  "CMakeFiles/phase-parsebench.dir/src/parser.c.o"
+  "CMakeFiles/phase-parsebench.dir/src/parser.c.o.d"
+  "CMakeFiles/phase-parsebench.dir/src/ring.c.o"
+  "CMakeFiles/phase-parsebench.dir/src/ring.c.o.d"
+  "CMakeFiles/phase-parsebench.dir/src/scan.c.o"
+  "CMakeFiles/phase-parsebench.dir/src/scan.c.o.d"
+  "CMakeFiles/phase-parsebench.dir/src/source.c.o"
+  "CMakeFiles/phase-parsebench.dir/src/source.c.o.d"
+  "phase-parsebench"
+  "phase-parsebench.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang C)
+  include(CMakeFiles/phase-parsebench.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,35 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/phase-switch.dir/src/arena.c.o"
+  "CMakeFiles/phase-switch.dir/src/arena.c.o.d"
+  "CMakeFiles/phase-switch.dir/src/checker.c.o"
+  "CMakeFiles/phase-switch.dir/src/checker.c.o.d"
+  "CMakeFiles/phase-switch.dir/src/codegen.c.o"
+  "CMakeFiles/phase-switch.dir/src/codegen.c.o.d"
+  "CMakeFiles/phase-switch.dir/src/errors.c.o"
+  "CMakeFiles/phase-switch.dir/src/errors.c.o.d"
+  "CMakeFiles/phase-switch.dir/src/lexer.c.o"
+  "CMakeFiles/phase-switch.dir/src/lexer.c.o.d"
+  "CMakeFiles/phase-switch.dir/src/main.c.o"
+  "CMakeFiles/phase-switch.dir/src/main.c.o.d"
+  "CMakeFiles/phase-switch.dir/src/parser.c.o"
+  "CMakeFiles/phase-switch.dir/src/parser.c.o.d"
+  "CMakeFiles/phase-switch.dir/src/ring.c.o"
+  "CMakeFiles/phase-switch.dir/src/ring.c.o.d"
+  "CMakeFiles/phase-switch.dir/src/scan.c.o"
+  "CMakeFiles/phase-switch.dir/src/scan.c.o.d"
+  "CMakeFiles/phase-switch.dir/src/source.c.o"
+  "CMakeFiles/phase-switch.dir/src/source.c.o.d"
+  "CMakeFiles/phase-switch.dir/src/symbols.c.o"
+  "CMakeFiles/phase-switch.dir/src/symbols.c.o.d"
+  "CMakeFiles/phase-switch.dir/src/verifier.c.o"
+  "CMakeFiles/phase-switch.dir/src/verifier.c.o.d"
+  "CMakeFiles/phase-switch.dir/src/watch.c.o"
+  "CMakeFiles/phase-switch.dir/src/watch.c.o.d"
+  "phase-switch"
+  "phase-switch.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang C)
+  include(CMakeFiles/phase-switch.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,31 @@
+
+# Consider dependencies only in project.
+set(CMAKE_DEPENDS_IN_PROJECT_ONLY OFF)
+
+# The set of languages for which implicit dependencies are needed:
+set(CMAKE_DEPENDS_LANGUAGES
+  )
+
+# The set of dependency files which are needed:
+set(CMAKE_DEPENDS_DEPENDENCY_FILES
+  "/root/repo/src/arena.c" "CMakeFiles/phase.dir/src/arena.c.o" "gcc" "CMakeFiles/phase.dir/src/arena.c.o.d"
+  "/root/repo/src/checker.c" "CMakeFiles/phase.dir/src/checker.c.o" "gcc" "CMakeFiles/phase.dir/src/checker.c.o.d"
+  "/root/repo/src/codegen.c" "CMakeFiles/phase.dir/src/codegen.c.o" "gcc" "CMakeFiles/phase.dir/src/codegen.c.o.d"
+  "/root/repo/src/errors.c" "CMakeFiles/phase.dir/src/errors.c.o" "gcc" "CMakeFiles/phase.dir/src/errors.c.o.d"
+  "/root/repo/src/lexer.c" "CMakeFiles/phase.dir/src/lexer.c.o" "gcc" "CMakeFiles/phase.dir/src/lexer.c.o.d"
+  "/root/repo/src/main.c" "CMakeFiles/phase.dir/src/main.c.o" "gcc" "CMakeFiles/phase.dir/src/main.c.o.d"
+  "/root/repo/src/parser.c" "CMakeFiles/phase.dir/src/parser.c.o" "gcc" "CMakeFiles/phase.dir/src/parser.c.o.d"
+  "/root/repo/src/ring.c" "CMakeFiles/phase.dir/src/ring.c.o" "gcc" "CMakeFiles/phase.dir/src/ring.c.o.d"
+  "/root/repo/src/scan.c" "CMakeFiles/phase.dir/src/scan.c.o" "gcc" "CMakeFiles/phase.dir/src/scan.c.o.d"
+  "/root/repo/src/source.c" "CMakeFiles/phase.dir/src/source.c.o" "gcc" "CMakeFiles/phase.dir/src/source.c.o.d"
+  "/root/repo/src/symbols.c" "CMakeFiles/phase.dir/src/symbols.c.o" "gcc" "CMakeFiles/phase.dir/src/symbols.c.o.d"
+  "/root/repo/src/verifier.c" "CMakeFiles/phase.dir/src/verifier.c.o" "gcc" "CMakeFiles/phase.dir/src/verifier.c.o.d"
+  "/root/repo/src/watch.c" "CMakeFiles/phase.dir/src/watch.c.o" "gcc" "CMakeFiles/phase.dir/src/watch.c.o.d"
+  )
+
+# Targets to which this target links.
+set(CMAKE_TARGET_LINKED_INFO_FILES
+  )
+
+# Fortran module output directory.
+set(CMAKE_Fortran_TARGET_MODULE_DIR "")
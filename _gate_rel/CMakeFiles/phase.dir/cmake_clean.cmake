@@ -0,0 +1,35 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/phase.dir/src/arena.c.o"
+  "CMakeFiles/phase.dir/src/arena.c.o.d"
+  "CMakeFiles/phase.dir/src/checker.c.o"
+  "CMakeFiles/phase.dir/src/checker.c.o.d"
+  "CMakeFiles/phase.dir/src/codegen.c.o"
+  "CMakeFiles/phase.dir/src/codegen.c.o.d"
+  "CMakeFiles/phase.dir/src/errors.c.o"
+  "CMakeFiles/phase.dir/src/errors.c.o.d"
+  "CMakeFiles/phase.dir/src/lexer.c.o"
+  "CMakeFiles/phase.dir/src/lexer.c.o.d"
+  "CMakeFiles/phase.dir/src/main.c.o"
+  "CMakeFiles/phase.dir/src/main.c.o.d"
+  "CMakeFiles/phase.dir/src/parser.c.o"
+  "CMakeFiles/phase.dir/src/parser.c.o.d"
+  "CMakeFiles/phase.dir/src/ring.c.o"
+  "CMakeFiles/phase.dir/src/ring.c.o.d"
+  "CMakeFiles/phase.dir/src/scan.c.o"
+  "CMakeFiles/phase.dir/src/scan.c.o.d"
+  "CMakeFiles/phase.dir/src/source.c.o"
+  "CMakeFiles/phase.dir/src/source.c.o.d"
+  "CMakeFiles/phase.dir/src/symbols.c.o"
+  "CMakeFiles/phase.dir/src/symbols.c.o.d"
+  "CMakeFiles/phase.dir/src/verifier.c.o"
+  "CMakeFiles/phase.dir/src/verifier.c.o.d"
+  "CMakeFiles/phase.dir/src/watch.c.o"
+  "CMakeFiles/phase.dir/src/watch.c.o.d"
+  "phase"
+  "phase.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang C)
+  include(CMakeFiles/phase.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,56 @@
+#!/bin/sh
+# Time several phase binaries against the same benchmark sources.
+#
+# Usage: benchmarks/compare.sh [-r runs] <phase-binary>... -- <file.phase>...
+#
+# Each binary runs every source `runs` times (default 5) and the best
+# wall-clock time is reported in milliseconds.
+
+runs=5
+
+if [ "$1" = "-r" ]; then
+    runs=$2
+    shift 2
+fi
+
+binaries=""
+
+while [ $# -gt 0 ] && [ "$1" != "--" ]; do
+    binaries="$binaries $1"
+    shift
+done
+
+if [ "$1" != "--" ] || [ -z "$binaries" ] || [ $# -lt 2 ]; then
+    echo "usage: $0 [-r runs] <phase-binary>... -- <file.phase>..." >&2
+    exit 1
+fi
+
+shift
+
+now_ms() {
+    date +%s%N | cut -c1-13
+}
+
+for source in "$@"; do
+    echo "$source"
+
+    for binary in $binaries; do
+        best=""
+        i=0
+
+        while [ $i -lt "$runs" ]; do
+            start=$(now_ms)
+            "$binary" "$source" >/dev/null 2>&1
+            end=$(now_ms)
+            elapsed=$((end - start))
+
+            if [ -z "$best" ] || [ $elapsed -lt "$best" ]; then
+                best=$elapsed
+            fi
+
+            i=$((i + 1))
+        done
+
+        printf "  %-40s %8s ms\n" "$binary" "$best"
+    done
+done
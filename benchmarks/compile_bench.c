@@ -0,0 +1,160 @@
+/* Compile micro-benchmark: parse, check and emit a source file repeatedly
+ * into fresh bytecode and report the best run.
+ *
+ * Usage: phase-compilebench [-r runs] [-j jobs] <file.phase>
+ *
+ * -j compiles function bodies across that many threads, as phase --parallel
+ * does with one per CPU, 1 being the baseline for it. Without it the
+ * program is parsed whole, then checked and emitted.
+ * Built with -DPHASE_BENCHMARKS=ON. Programs with many functions can be
+ * generated with benchmarks/gen_symbols.sh */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "arena.h"
+#include "checker.h"
+
+static char *read_source(const char *path, size_t *len_out) {
+
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        perror(path);
+        exit(1);
+    }
+
+    char  *buffer = NULL;
+    size_t len    = 0;
+    size_t cap    = 0;
+
+    for (;;) {
+
+        if (len + 4096 > cap) {
+
+            cap            = cap ? cap * 2 : 65536;
+            void *temp_ptr = realloc(buffer, cap);
+            if (!temp_ptr) {
+                free(buffer);
+                fputs("out of memory\n", stderr);
+                exit(1);
+            }
+
+            buffer = temp_ptr;
+        }
+
+        size_t got = fread(buffer + len, 1, cap - len, file);
+        len += got;
+
+        if (got == 0)
+            break;
+    }
+
+    fclose(file);
+
+    *len_out = len;
+
+    return buffer;
+}
+
+static double now_seconds(void) {
+
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/* Compile the whole source once, returning the bytes of code emitted */
+static size_t
+compile_all(const char *src, size_t len, const char *path, size_t jobs) {
+
+    Source source;
+    init_source(&source, src, len);
+    error_set_lines(&source);
+
+    Arena   arena   = {0};
+    Lexer   lexer   = init_lexer(&source, path, &arena);
+    Parser  parser  = init_parser(&lexer, NULL, NULL, false);
+    Emitter emitter = {0};
+
+    if (jobs) {
+
+        compile_parallel(&emitter, &parser, &arena, jobs);
+
+    } else {
+
+        AstProgram *program = parse_program(&parser);
+
+        check_program(&emitter, program, &arena);
+        emit_program(&emitter, program);
+    }
+
+    size_t code_len = emitter.code_len;
+
+    free_emitter(&emitter);
+    free_parser(&parser);
+    arena_free(&arena);
+    free_source(&source);
+
+    return code_len;
+}
+
+int main(int argc, char **argv) {
+
+    int runs = 10;
+    int jobs = 0;
+    int arg  = 1;
+
+    if (arg + 1 < argc && strcmp(argv[arg], "-r") == 0) {
+
+        runs  = atoi(argv[arg + 1]);
+        arg  += 2;
+    }
+
+    if (arg + 1 < argc && strcmp(argv[arg], "-j") == 0) {
+
+        jobs  = atoi(argv[arg + 1]);
+        arg  += 2;
+    }
+
+    if (arg != argc - 1 || runs < 1 || jobs < 0) {
+
+        fprintf(stderr,
+                "usage: %s [-r runs] [-j jobs] <file.phase>\n",
+                argv[0]);
+        return 1;
+    }
+
+    error_set_source(argv[arg]);
+
+    size_t len  = 0;
+    char  *src  = read_source(argv[arg], &len);
+    size_t code = 0;
+    double best = 0.0;
+
+    for (int i = 0; i < runs; i++) {
+
+        double start   = now_seconds();
+        code           = compile_all(src, len, argv[arg], (size_t)jobs);
+        double elapsed = now_seconds() - start;
+
+        if (i == 0 || elapsed < best)
+            best = elapsed;
+    }
+
+    if (jobs)
+        printf("%d jobs, ", jobs);
+
+    printf("%zu bytes, %zu bytes of code, best of %d: %.3f ms\n",
+           len,
+           code,
+           runs,
+           best * 1e3);
+    printf("%.1f MB/s\n", (double)len / best / 1e6);
+
+    free(src);
+
+    return 0;
+}
@@ -0,0 +1,41 @@
+#!/bin/sh
+# Compile one program of generated functions with its bodies spread across a
+# growing number of threads, to show how parallel compilation scales with
+# cores. The first line is the serial compile the others are measured
+# against, and each job count after it should approach the time of finding
+# the declarations plus 1/jobs of the rest, up to the cores there are.
+#
+# Usage: benchmarks/compile_scaling.sh [-r runs] <phase-compilebench> [functions] [jobs...]
+
+runs=5
+
+if [ "$1" = "-r" ]; then
+    runs=$2
+    shift 2
+fi
+
+if [ $# -lt 1 ]; then
+    echo "usage: $0 [-r runs] <phase-compilebench> [functions] [jobs...]" >&2
+    exit 1
+fi
+
+binary=$1
+functions=${2:-10000}
+shift
+[ $# -gt 0 ] && shift
+
+jobs=${*:-"1 2 4 8"}
+dir=$(dirname "$0")
+source=$(mktemp)
+
+trap 'rm -f "$source"' EXIT
+
+"$dir/gen_symbols.sh" "$functions" > "$source"
+
+echo "$(wc -c < "$source") bytes, $(getconf _NPROCESSORS_ONLN) cores online"
+
+"$binary" -r "$runs" "$source" | head -n 1
+
+for j in $jobs; do
+    "$binary" -r "$runs" -j "$j" "$source" | head -n 1
+done
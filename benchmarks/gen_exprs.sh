@@ -0,0 +1,27 @@
+#!/bin/sh
+# Generate a program of n functions made almost entirely of arithmetic and
+# boolean expressions mixing every operator and precedence level, to time
+# expression parsing.
+#
+# Usage: benchmarks/gen_exprs.sh <n> > exprs.phase
+
+if [ $# -ne 1 ]; then
+    echo "usage: $0 <n>" >&2
+    exit 1
+fi
+
+awk -v n="$1" 'BEGIN {
+    for (i = 0; i < n; i++) {
+        printf "\nfunc e%d(a: int, b: int): int {\n", i
+        printf "    let x: int = a + %d * (b - 3) / (a * b + 1) - -a + b * b\n", i
+        printf "    let y: int = x - (a - b) / 2 + x * (a + b * (x - %d))\n", i
+        printf "    let c: bool = a < b and not (x == y) or a >= %d and b <= x\n", i
+        printf "    if c or !(a > b) and y + 1 > x * 2 - a {\n"
+        printf "        x = x * 2 + a / (b + 1) - (y - x) * (a + b) / 3\n"
+        printf "    }\n"
+        printf "    return x + a * b - (y + 1) / 3 + -(x - a) * -b\n"
+        printf "}\n"
+    }
+
+    printf "\nentry {\n    out(e0(1, 2))\n}\n"
+}'
@@ -0,0 +1,33 @@
+#!/bin/sh
+# Generate a program with n globals and n functions, each of which reads a
+# few globals, declares nested locals and calls the function before it.
+#
+# Usage: benchmarks/gen_symbols.sh <n> > symbols.phase
+
+if [ $# -ne 1 ]; then
+    echo "usage: $0 <n>" >&2
+    exit 1
+fi
+
+awk -v n="$1" 'BEGIN {
+    for (i = 0; i < n; i++)
+        printf "let g%d: int\n", i
+
+    for (i = 0; i < n; i++) {
+        printf "\nfunc f%d(a: int): int {\n", i
+        printf "    let x%d: int = a + g%d\n", i, (i * 7) % n
+        printf "    if x%d > 0 {\n", i
+        printf "        let y: int = x%d + g%d\n", i, (i * 13) % n
+        printf "        x%d = y\n", i
+        printf "    }\n"
+
+        if (i > 0)
+            printf "    return x%d + f%d(a)\n", i, i - 1
+        else
+            printf "    return x%d\n", i
+
+        printf "}\n"
+    }
+
+    printf "\nentry {\n    out(f%d(1))\n}\n", n - 1
+}'
@@ -0,0 +1,173 @@
+/* Lexer micro-benchmark: tokenise a source file repeatedly and report the
+ * best run in tokens per second.
+ *
+ * Usage: phase-lexbench [-r runs] [-j jobs] [--scalar] <file.phase>
+ *
+ * -j lexes into a token buffer split across that many threads, 1 being the
+ * sequential baseline for it. --scalar turns off the vector scanners to
+ * compare against them.
+ * Built with -DPHASE_BENCHMARKS=ON. Identifier-heavy input can be generated
+ * with benchmarks/gen_symbols.sh */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "arena.h"
+#include "lexer.h"
+#include "scan.h"
+
+static char *read_source(const char *path, size_t *len_out) {
+
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        perror(path);
+        exit(1);
+    }
+
+    char  *buffer = NULL;
+    size_t len    = 0;
+    size_t cap    = 0;
+
+    for (;;) {
+
+        if (len + 4096 + 1 > cap) {
+
+            cap            = cap ? cap * 2 : 65536;
+            void *temp_ptr = realloc(buffer, cap);
+            if (!temp_ptr) {
+                free(buffer);
+                fputs("out of memory\n", stderr);
+                exit(1);
+            }
+
+            buffer = temp_ptr;
+        }
+
+        size_t got = fread(buffer + len, 1, cap - len - 1, file);
+        len += got;
+
+        if (got == 0)
+            break;
+    }
+
+    fclose(file);
+
+    buffer[len] = '\0';
+    *len_out    = len;
+
+    return buffer;
+}
+
+static double now_seconds(void) {
+
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/* Lex the whole source once, line index included, returning the number of
+ * tokens produced. With jobs the tokens go into a buffer, otherwise they are
+ * pulled one at a time */
+static size_t
+lex_all(const char *src, size_t len, const char *path, size_t jobs) {
+
+    Source source;
+    init_source(&source, src, len);
+
+    Arena  arena  = {0};
+    Lexer  lexer  = init_lexer(&source, path, &arena);
+    size_t tokens = 0;
+
+    if (jobs) {
+
+        TokenBuffer buffer;
+        lex_tokens_parallel(&lexer, &buffer, jobs);
+
+        tokens = buffer.count;
+        free_tokens(&buffer);
+
+    } else {
+
+        for (;;) {
+
+            Token token = next_token(&lexer);
+            tokens++;
+
+            if (token.type == TOK_EOF)
+                break;
+        }
+    }
+
+    arena_free(&arena);
+    free_source(&source);
+
+    return tokens;
+}
+
+int main(int argc, char **argv) {
+
+    int runs = 10;
+    int jobs = 0;
+    int arg  = 1;
+
+    if (arg + 1 < argc && strcmp(argv[arg], "-r") == 0) {
+
+        runs  = atoi(argv[arg + 1]);
+        arg  += 2;
+    }
+
+    if (arg + 1 < argc && strcmp(argv[arg], "-j") == 0) {
+
+        jobs  = atoi(argv[arg + 1]);
+        arg  += 2;
+    }
+
+    if (arg < argc && strcmp(argv[arg], "--scalar") == 0) {
+
+        scan_use_scalar();
+        arg++;
+    }
+
+    if (arg != argc - 1 || runs < 1 || jobs < 0) {
+
+        fprintf(stderr,
+                "usage: %s [-r runs] [-j jobs] [--scalar] <file.phase>\n",
+                argv[0]);
+        return 1;
+    }
+
+    size_t len    = 0;
+    char  *src    = read_source(argv[arg], &len);
+    size_t tokens = 0;
+    double best   = 0.0;
+
+    for (int i = 0; i < runs; i++) {
+
+        double start   = now_seconds();
+        tokens         = lex_all(src, len, argv[arg], (size_t)jobs);
+        double elapsed = now_seconds() - start;
+
+        if (i == 0 || elapsed < best)
+            best = elapsed;
+    }
+
+    if (jobs)
+        printf("%d jobs, ", jobs);
+
+    printf("%s scanner, %zu bytes, %zu tokens, best of %d: %.3f ms\n",
+           scan_impl_name(),
+           len,
+           tokens,
+           runs,
+           best * 1e3);
+    printf("%.2f Mtokens/s, %.1f MB/s\n",
+           (double)tokens / best / 1e6,
+           (double)len / best / 1e6);
+
+    free(src);
+
+    return 0;
+}
@@ -0,0 +1,38 @@
+#!/bin/sh
+# Lex one large generated source into a token buffer split across a growing
+# number of threads, to show how chunked lexing scales with cores. Each job
+# count after the first should approach 1/jobs of its time, up to the number
+# of cores the machine has.
+#
+# Usage: benchmarks/lex_scaling.sh [-r runs] <phase-lexbench> [symbols] [jobs...]
+
+runs=5
+
+if [ "$1" = "-r" ]; then
+    runs=$2
+    shift 2
+fi
+
+if [ $# -lt 1 ]; then
+    echo "usage: $0 [-r runs] <phase-lexbench> [symbols] [jobs...]" >&2
+    exit 1
+fi
+
+binary=$1
+symbols=${2:-100000}
+shift
+[ $# -gt 0 ] && shift
+
+jobs=${*:-"1 2 4 8"}
+dir=$(dirname "$0")
+source=$(mktemp)
+
+trap 'rm -f "$source"' EXIT
+
+"$dir/gen_symbols.sh" "$symbols" > "$source"
+
+echo "$(wc -c < "$source") bytes, $(getconf _NPROCESSORS_ONLN) cores online"
+
+for j in $jobs; do
+    "$binary" -r "$runs" -j "$j" "$source" | head -n 1
+done
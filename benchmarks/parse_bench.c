@@ -0,0 +1,158 @@
+/* Parser micro-benchmark: lex and parse a source file repeatedly into a
+ * fresh AST and report the best run.
+ *
+ * Usage: phase-parsebench [-r runs] [--lazy] [--overlap] <file.phase>
+ *
+ * --lazy skips function bodies the way phase --lazy does before any of them
+ * turn out to be called. --overlap lexes on a second thread feeding the
+ * parser through a token ring, as phase --overlap does.
+ * Built with -DPHASE_BENCHMARKS=ON. Expression-heavy input can be generated
+ * with benchmarks/gen_exprs.sh */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "arena.h"
+#include "parser.h"
+
+static char *read_source(const char *path, size_t *len_out) {
+
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        perror(path);
+        exit(1);
+    }
+
+    char  *buffer = NULL;
+    size_t len    = 0;
+    size_t cap    = 0;
+
+    for (;;) {
+
+        if (len + 4096 > cap) {
+
+            cap            = cap ? cap * 2 : 65536;
+            void *temp_ptr = realloc(buffer, cap);
+            if (!temp_ptr) {
+                free(buffer);
+                fputs("out of memory\n", stderr);
+                exit(1);
+            }
+
+            buffer = temp_ptr;
+        }
+
+        size_t got = fread(buffer + len, 1, cap - len, file);
+        len += got;
+
+        if (got == 0)
+            break;
+    }
+
+    fclose(file);
+
+    *len_out = len;
+
+    return buffer;
+}
+
+static double now_seconds(void) {
+
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/* Parse the whole source once, returning the number of declarations */
+static size_t parse_all(const char *src,
+                        size_t      len,
+                        const char *path,
+                        bool        lazy,
+                        bool        overlap) {
+
+    Source source;
+    init_source(&source, src, len);
+    error_set_lines(&source);
+
+    Arena       arena   = {0};
+    Lexer       lexer   = init_lexer(&source, path, &arena);
+    TokenRing  *ring    = overlap ? start_token_ring(&lexer) : NULL;
+    Parser      parser  = init_parser(&lexer, NULL, ring, lazy);
+    AstProgram *program = parse_program(&parser);
+    size_t      decls   = program->len;
+
+    stop_token_ring(ring);
+    free_parser(&parser);
+    arena_free(&arena);
+    free_source(&source);
+
+    return decls;
+}
+
+int main(int argc, char **argv) {
+
+    int  runs    = 10;
+    int  arg     = 1;
+    bool lazy    = false;
+    bool overlap = false;
+
+    if (arg + 1 < argc && strcmp(argv[arg], "-r") == 0) {
+
+        runs  = atoi(argv[arg + 1]);
+        arg  += 2;
+    }
+
+    if (arg < argc && strcmp(argv[arg], "--lazy") == 0) {
+
+        lazy = true;
+        arg++;
+    }
+
+    if (arg < argc && strcmp(argv[arg], "--overlap") == 0) {
+
+        overlap = true;
+        arg++;
+    }
+
+    if (arg != argc - 1 || runs < 1) {
+
+        fprintf(stderr,
+                "usage: %s [-r runs] [--lazy] [--overlap] <file.phase>\n",
+                argv[0]);
+        return 1;
+    }
+
+    error_set_source(argv[arg]);
+
+    size_t len   = 0;
+    char  *src   = read_source(argv[arg], &len);
+    size_t decls = 0;
+    double best  = 0.0;
+
+    for (int i = 0; i < runs; i++) {
+
+        double start   = now_seconds();
+        decls          = parse_all(src, len, argv[arg], lazy, overlap);
+        double elapsed = now_seconds() - start;
+
+        if (i == 0 || elapsed < best)
+            best = elapsed;
+    }
+
+    if (overlap)
+        printf("overlapped, ");
+
+    printf("%zu bytes, %zu declarations, best of %d: %.3f ms\n",
+           len,
+           decls,
+           runs,
+           best * 1e3);
+    printf("%.1f MB/s\n", (double)len / best / 1e6);
+
+    free(src);
+
+    return 0;
+}
@@ -0,0 +1,54 @@
+#!/bin/sh
+# Time compile-only runs (--check) on generated programs of growing size, to
+# show that symbol resolution stays linear in the number of symbols.
+#
+# Usage: benchmarks/scaling.sh [-r runs] <phase-binary> [n...]
+
+runs=3
+
+if [ "$1" = "-r" ]; then
+    runs=$2
+    shift 2
+fi
+
+if [ $# -lt 1 ]; then
+    echo "usage: $0 [-r runs] <phase-binary> [n...]" >&2
+    exit 1
+fi
+
+binary=$1
+shift
+
+sizes=${*:-"1000 2000 4000 8000 16000"}
+dir=$(dirname "$0")
+source=$(mktemp)
+
+trap 'rm -f "$source"' EXIT
+
+now_ms() {
+    date +%s%N | cut -c1-13
+}
+
+printf "  %8s %10s %10s\n" "symbols" "ms" "us/symbol"
+
+for n in $sizes; do
+    "$dir/gen_symbols.sh" "$n" > "$source"
+
+    best=""
+    i=0
+
+    while [ $i -lt "$runs" ]; do
+        start=$(now_ms)
+        "$binary" "$source" --check >/dev/null 2>&1
+        end=$(now_ms)
+        elapsed=$((end - start))
+
+        if [ -z "$best" ] || [ $elapsed -lt "$best" ]; then
+            best=$elapsed
+        fi
+
+        i=$((i + 1))
+    done
+
+    printf "  %8s %10s %10s\n" "$((2 * n))" "$best" "$((best * 1000 / (2 * n)))"
+done
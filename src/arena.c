@@ -0,0 +1,168 @@
+#include "arena.h"
+
+#include <stdalign.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "errors.h"
+
+#define ARENA_BLOCK_SIZE (64 * 1024)
+
+struct ArenaBlock {
+
+    ArenaBlock *next;
+    size_t      used;
+    size_t      cap;
+    max_align_t data[];
+};
+
+static size_t align_up(size_t size) {
+
+    size_t align = alignof(max_align_t);
+
+    return (size + align - 1) & ~(align - 1);
+}
+
+/* Start a fresh block in front of the current one. Blocks come from calloc,
+ * and no byte is ever handed out twice, so every allocation is zeroed */
+static ArenaBlock *new_block(Arena *arena, size_t size) {
+
+    size_t      cap   = size > ARENA_BLOCK_SIZE ? size : ARENA_BLOCK_SIZE;
+    ArenaBlock *block = calloc(1, sizeof(ArenaBlock) + cap);
+    if (!block)
+        error_oom();
+
+    block->next = arena->head;
+    block->used = 0;
+    block->cap  = cap;
+    arena->head = block;
+
+    return block;
+}
+
+void *arena_alloc(Arena *arena, size_t size) {
+
+    size = align_up(size ? size : 1);
+
+    ArenaBlock *block = arena->head;
+
+    if (!block || block->cap - block->used < size)
+        block = new_block(arena, size);
+
+    void *ptr = (uint8_t *)block->data + block->used;
+    block->used += size;
+
+    arena->last      = ptr;
+    arena->last_size = size;
+
+    return ptr;
+}
+
+/* Resize an allocation for a growing vector. The newest allocation extends
+ * in place when its block has room, anything else moves to a new slot */
+void *arena_grow(Arena *arena, void *ptr, size_t old_size, size_t new_size) {
+
+    if (!ptr)
+        return arena_alloc(arena, new_size);
+
+    ArenaBlock *block = arena->head;
+
+    if (ptr == arena->last) {
+
+        if (new_size <= arena->last_size)
+            return ptr;
+
+        size_t extra = align_up(new_size) - arena->last_size;
+
+        if (block->cap - block->used >= extra) {
+
+            block->used      += extra;
+            arena->last_size += extra;
+
+            return ptr;
+        }
+    }
+
+    void *moved = arena_alloc(arena, new_size);
+    memcpy(moved, ptr, old_size < new_size ? old_size : new_size);
+
+    return moved;
+}
+
+char *arena_strndup(Arena *arena, const char *src, size_t len) {
+
+    char *copy = arena_alloc(arena, len + 1);
+    memcpy(copy, src, len);
+    copy[len] = '\0';
+
+    return copy;
+}
+
+/* Take over every block of from, leaving it empty, so what was allocated
+ * there lives as long as arena. The blocks go behind arena's current one,
+ * whose newest allocation can still grow in place */
+void arena_adopt(Arena *arena, Arena *from) {
+
+    ArenaBlock *first = from->head;
+
+    if (!first)
+        return;
+
+    ArenaBlock *last = first;
+
+    while (last->next)
+        last = last->next;
+
+    if (arena->head) {
+
+        last->next        = arena->head->next;
+        arena->head->next = first;
+
+    } else {
+
+        arena->head = first;
+    }
+
+    *from = (Arena){0};
+}
+
+/* Drop everything allocated so far, keeping only the newest block to reuse.
+ * Its used part is zeroed again, as every allocation is expected to be */
+void arena_reset(Arena *arena) {
+
+    ArenaBlock *block = arena->head;
+
+    if (!block)
+        return;
+
+    ArenaBlock *older = block->next;
+
+    while (older) {
+
+        ArenaBlock *next = older->next;
+        free(older);
+        older = next;
+    }
+
+    memset(block->data, 0, block->used);
+
+    block->next      = NULL;
+    block->used      = 0;
+    arena->last      = NULL;
+    arena->last_size = 0;
+}
+
+void arena_free(Arena *arena) {
+
+    ArenaBlock *block = arena->head;
+
+    while (block) {
+
+        ArenaBlock *next = block->next;
+        free(block);
+        block = next;
+    }
+
+    *arena = (Arena){0};
+}
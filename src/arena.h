@@ -0,0 +1,26 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+typedef struct ArenaBlock ArenaBlock;
+
+/* A bump allocator that owns everything the compiler builds from a source:
+ * tokens, AST nodes and the checker's side tables. Nothing is freed
+ * individually, arena_free() releases it all at once */
+typedef struct {
+
+    ArenaBlock *head;
+    void       *last; // Most recent allocation, which can grow in place
+    size_t      last_size;
+
+} Arena;
+
+void *arena_alloc(Arena *arena, size_t size);
+void *arena_grow(Arena *arena, void *ptr, size_t old_size, size_t new_size);
+char *arena_strndup(Arena *arena, const char *src, size_t len);
+void  arena_adopt(Arena *arena, Arena *from);
+void  arena_reset(Arena *arena);
+void  arena_free(Arena *arena);
+
+#endif
@@ -0,0 +1,1507 @@
+#include "checker.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "errors.h"
+#include "scan.h"
+
+// Function bodies are compiled on worker threads wherever POSIX has them
+#ifdef _POSIX_C_SOURCE
+#    define CHECK_THREADS 1
+#    include <pthread.h>
+#    include <unistd.h>
+#endif
+
+// Functions go to the threads of a parallel compile in runs of this many,
+// and no thread is started for fewer than SHARE_MIN of them
+#define SHARE_RUN ((size_t)16)
+#define SHARE_MIN ((size_t)64)
+
+typedef struct {
+
+    char     **names;
+    TokenType *types;
+    size_t     count;
+    size_t     cap;
+
+} VarTable;
+
+/* Names are borrowed from the AST, which lives as long as the arena */
+static size_t add_to_var_table(Arena     *arena,
+                               VarTable  *table,
+                               char      *name,
+                               TokenType  type) {
+
+    if (table->count + 1 > table->cap) {
+
+        size_t new_cap = table->cap ? table->cap * 2 : 8;
+
+        table->names = arena_grow(arena,
+                                  table->names,
+                                  table->cap * sizeof(char *),
+                                  new_cap * sizeof(char *));
+        table->types = arena_grow(arena,
+                                  table->types,
+                                  table->cap * sizeof(TokenType),
+                                  new_cap * sizeof(TokenType));
+        table->cap   = new_cap;
+    }
+
+    table->names[table->count] = name;
+    table->types[table->count] = type;
+
+    return table->count++;
+}
+
+static size_t add_global(Emitter *emitter, char *name, TokenType type) {
+
+    VarTable table = {.names = emitter->global_names,
+                      .types = emitter->global_types,
+                      .count = emitter->global_count,
+                      .cap   = emitter->global_cap};
+    size_t   idx   = add_to_var_table(emitter->arena, &table, name, type);
+    uint64_t hash  = hash_symbol(name);
+
+    emitter->global_names = table.names;
+    emitter->global_types = table.types;
+    emitter->global_count = table.count;
+    emitter->global_cap   = table.cap;
+
+    // A repeated global keeps resolving to its first declaration
+    if (find_symbol(&emitter->global_index, name, hash) == SIZE_MAX)
+        bind_symbol(&emitter->global_index, name, hash, idx);
+
+    return idx;
+}
+
+static size_t find_global(Emitter *emitter, const char *name, uint64_t hash) {
+
+    return find_symbol(&emitter->global_index, name, hash);
+}
+
+static FunctionDef *find_function(Emitter *emitter, const char *name) {
+
+    size_t indx =
+            find_symbol(&emitter->function_index, name, hash_symbol(name));
+
+    return indx == SIZE_MAX ? NULL : &emitter->functions[indx];
+}
+
+static FunctionDef *register_function(Emitter   *emitter,
+                                      char      *name,
+                                      TokenType  return_type,
+                                      AstParam  *params,
+                                      size_t     param_count) {
+
+    if (find_function(emitter, name)) {
+
+        ErrorLocation loc = {0};
+        error_invalid_token(loc);
+    }
+
+    if (emitter->func_count + 1 > emitter->func_cap) {
+
+        size_t new_cap = emitter->func_cap ? emitter->func_cap * 2 : 4;
+        void  *temp_ptr =
+                realloc(emitter->functions, new_cap * sizeof(FunctionDef));
+        if (!temp_ptr) {
+            free(emitter->functions);
+            error_oom();
+        }
+
+        emitter->functions = temp_ptr;
+        emitter->func_cap  = new_cap;
+    }
+
+    FunctionDef *fn = &emitter->functions[emitter->func_count++];
+
+    fn->name         = name;
+    fn->return_type  = return_type;
+    fn->param_count  = param_count;
+    fn->param_types  = arena_alloc(emitter->arena,
+                                  param_count * sizeof(TokenType));
+    fn->has_return   = false;
+    fn->local_names  = NULL;
+    fn->local_types  = NULL;
+    fn->local_count  = 0;
+    fn->local_cap    = 0;
+    fn->start_ip     = 0;
+    fn->max_stack    = 0;
+    fn->callees      = NULL;
+    fn->callee_count = 0;
+    fn->callee_cap   = 0;
+    fn->compiled     = false;
+
+    for (size_t i = 0; i < param_count; i++)
+        fn->param_types[i] = params[i].type;
+
+    bind_symbol(&emitter->function_index,
+                fn->name,
+                hash_symbol(fn->name),
+                emitter->func_count - 1);
+
+    return fn;
+}
+
+/* Compiling in one pass, a name not known yet may still be declared further
+ * down. The first miss reads ahead for every declaration left, once */
+static bool read_ahead(Emitter *emitter) {
+
+    Parser *parser = emitter->ahead;
+
+    if (!parser)
+        return false;
+
+    emitter->ahead = NULL;
+    scan_declarations(parser);
+
+    return true;
+}
+
+/* Queue a function's body for checking, once */
+static void queue_function(Emitter *emitter, size_t indx) {
+
+    FunctionDef *fn = &emitter->functions[indx];
+
+    if (fn->compiled)
+        return;
+
+    fn->compiled = true;
+
+    emitter->pending[emitter->pending_count++] = indx;
+}
+
+/* Every declaration gets a fresh slot, and the name is bound in the
+ * innermost open scope so it shadows outer locals until that scope closes */
+static size_t add_local(Emitter     *emitter,
+                        FunctionDef *fn,
+                        char        *name,
+                        TokenType    type) {
+
+    VarTable table  = {.names = fn->local_names,
+                       .types = fn->local_types,
+                       .count = fn->local_count,
+                       .cap   = fn->local_cap};
+    size_t   idx    = add_to_var_table(emitter->arena, &table, name, type);
+    fn->local_names = table.names;
+    fn->local_types = table.types;
+    fn->local_count = table.count;
+    fn->local_cap   = table.cap;
+
+    bind_symbol(&emitter->local_index,
+                fn->local_names[idx],
+                hash_symbol(name),
+                idx);
+
+    return idx;
+}
+
+static size_t find_local(Emitter *emitter, const char *name, uint64_t hash) {
+
+    return find_symbol(&emitter->local_index, name, hash);
+}
+
+static TokenType get_variable_type(Emitter     *emitter,
+                                   FunctionDef *current_fn,
+                                   const char  *name,
+                                   bool        *is_local_out,
+                                   size_t      *index_out) {
+
+    uint64_t hash      = hash_symbol(name);
+    size_t   local_idx = find_local(emitter, name, hash);
+
+    if (local_idx != SIZE_MAX) {
+
+        if (is_local_out)
+            *is_local_out = true;
+        if (index_out)
+            *index_out = local_idx;
+
+        return current_fn->local_types[local_idx];
+    }
+
+    size_t global_idx = find_global(emitter, name, hash);
+
+    if (global_idx == SIZE_MAX && read_ahead(emitter))
+        global_idx = find_global(emitter, name, hash);
+
+    if (global_idx != SIZE_MAX) {
+
+        if (is_local_out)
+            *is_local_out = false;
+        if (index_out)
+            *index_out = global_idx;
+
+        return emitter->global_types[global_idx];
+    }
+
+    if (is_local_out)
+        *is_local_out = false;
+
+    return TOK_UNKNOWN;
+}
+
+/* Whether a value of type actual can't go where expected is wanted. A name
+ * already reported as undefined has no type and fits anywhere, so its uses
+ * aren't reported over again */
+static bool mismatched(TokenType expected, TokenType actual) {
+
+    return expected != actual && expected != TOK_UNKNOWN &&
+           actual != TOK_UNKNOWN;
+}
+
+/* Whether type can't be used as a number, by the same rule */
+static bool not_number(TokenType type) {
+
+    return type != TOK_INTEGER_T && type != TOK_FLOAT_T &&
+           type != TOK_UNKNOWN;
+}
+
+/* Check a call as its arguments resolve: the callee and the argument count
+ * before the first, then the type of each as soon as it is known. A callee
+ * already reported as undefined is left without a slot, and its call
+ * without a type, so only its first call is reported */
+static void
+check_call(Emitter *emitter, AstExpression *expression, size_t resolved) {
+
+    if (resolved == 0) {
+
+        FunctionDef *fn = find_function(emitter, expression->call.func_name);
+
+        if (!fn && read_ahead(emitter))
+            fn = find_function(emitter, expression->call.func_name);
+
+        if (!fn) {
+
+            char    *name = expression->call.func_name;
+            uint64_t hash = hash_symbol(name);
+
+            if (find_symbol(&emitter->undefined_index, name, hash) !=
+                SIZE_MAX) {
+
+                expression->slot = SIZE_MAX;
+                return;
+            }
+
+            ErrorLocation loc = {.line      = expression->line,
+                                 .col_start = expression->column_start,
+                                 .col_end   = expression->column_end};
+
+            if (emitter->recover)
+                bind_symbol(&emitter->undefined_index, name, hash, 0);
+
+            if (emitter->lost) {
+
+                expression->slot = SIZE_MAX;
+                return;
+            }
+
+            error_undefined_func(loc, name);
+        }
+
+        if (expression->call.arg_count != fn->param_count) {
+
+            ErrorLocation loc = {.line      = expression->line,
+                                 .col_start = expression->column_start,
+                                 .col_end   = expression->column_end};
+            error_wrong_var_init(loc,
+                                 fn->param_count,
+                                 expression->call.arg_count);
+        }
+
+        expression->slot = (size_t)(fn - emitter->functions);
+        queue_function(emitter, expression->slot);
+
+        return;
+    }
+
+    if (expression->slot == SIZE_MAX)
+        return;
+
+    FunctionDef   *fn         = &emitter->functions[expression->slot];
+    AstExpression *arg        = expression->call.args[resolved - 1];
+    TokenType      param_type = fn->param_types[resolved - 1];
+
+    if (mismatched(param_type, arg->type)) {
+
+        ErrorLocation loc = {.line      = arg->line,
+                             .col_start = arg->column_start,
+                             .col_end   = arg->column_end};
+        error_type_mismatch(loc,
+                            fn->name,
+                            token_type_to_string(param_type),
+                            token_type_to_string(arg->type));
+    }
+}
+
+/* The type of an expression whose operands are already resolved */
+static TokenType resolve_expression(Emitter       *emitter,
+                                    FunctionDef   *current_fn,
+                                    AstExpression *expression) {
+
+    switch (expression->tag) {
+
+        case EXP_STRING:
+            return TOK_STRING_T;
+        case EXP_INTEGER:
+            return TOK_INTEGER_T;
+        case EXP_FLOAT:
+            return TOK_FLOAT_T;
+        case EXP_BOOLEAN:
+            return TOK_BOOLEAN_T;
+        case EXP_VARIABLE: {
+
+            TokenType t = get_variable_type(emitter,
+                                            current_fn,
+                                            expression->variable.name,
+                                            &expression->is_local,
+                                            &expression->slot);
+
+            // An untyped local stands in for a name already reported, and
+            // is declared for the rest of its scope so only its first use is
+            if (t == TOK_UNKNOWN && !expression->is_local) {
+
+                ErrorLocation loc = {.line      = expression->line,
+                                     .col_start = expression->column_start,
+                                     .col_end   = expression->column_end};
+
+                if (emitter->recover)
+                    add_local(emitter,
+                              current_fn,
+                              expression->variable.name,
+                              TOK_UNKNOWN);
+
+                if (!emitter->lost)
+                    error_undefined_var(loc, expression->variable.name);
+            }
+
+            return t;
+        }
+        case EXP_CALL:
+            return expression->slot == SIZE_MAX
+                           ? TOK_UNKNOWN
+                           : emitter->functions[expression->slot].return_type;
+
+        case EXP_UNARY: {
+
+            TokenType inner = expression->unary.expr->type;
+
+            if (expression->unary.op == TOK_BANG ||
+                expression->unary.op == TOK_NOT) {
+
+                if (mismatched(TOK_BOOLEAN_T, inner)) {
+
+                    ErrorLocation loc = {.line      = expression->line,
+                                         .col_start = expression->column_start,
+                                         .col_end   = expression->column_end};
+                    error_type_mismatch(loc,
+                                        "not",
+                                        "bool",
+                                        token_type_to_string(inner));
+                }
+
+                return TOK_BOOLEAN_T;
+
+            } else if (expression->unary.op == TOK_SUBTRACT) {
+
+                if (not_number(inner)) {
+
+                    ErrorLocation loc = {.line      = expression->line,
+                                         .col_start = expression->column_start,
+                                         .col_end   = expression->column_end};
+                    error_type_mismatch(loc,
+                                        "negation",
+                                        "number",
+                                        token_type_to_string(inner));
+                }
+
+                return inner;
+            }
+
+            return TOK_UNKNOWN;
+        }
+
+        case EXP_BINARY: {
+
+            TokenType left_type  = expression->binary.left->type;
+            TokenType right_type = expression->binary.right->type;
+
+            if (mismatched(left_type, right_type)) {
+
+                ErrorLocation loc = {.line      = expression->line,
+                                     .col_start = expression->column_start,
+                                     .col_end   = expression->column_end};
+                error_type_mismatch(loc,
+                                    "binary op",
+                                    token_type_to_string(left_type),
+                                    token_type_to_string(right_type));
+            }
+
+            // An untyped operand takes the other's type, if it has one
+            if (left_type == TOK_UNKNOWN)
+                left_type = right_type;
+
+            // Logic
+            if (expression->binary.op == TOK_AND ||
+                expression->binary.op == TOK_OR) {
+
+                if (mismatched(TOK_BOOLEAN_T, left_type)) {
+
+                    ErrorLocation loc = {.line      = expression->line,
+                                         .col_start = expression->column_start,
+                                         .col_end   = expression->column_end};
+                    error_type_mismatch(loc,
+                                        "logical op",
+                                        "bool",
+                                        token_type_to_string(left_type));
+                }
+
+                return TOK_BOOLEAN_T;
+            }
+
+            // Equality
+            if (expression->binary.op == TOK_EQUAL_EQUAL) {
+
+                if (left_type == TOK_VOID_T) {
+
+                    ErrorLocation loc = {.line      = expression->line,
+                                         .col_start = expression->column_start,
+                                         .col_end   = expression->column_end};
+                    error_type_mismatch(loc, "equality", "value", "void");
+                }
+
+                return TOK_BOOLEAN_T;
+            }
+
+            // Comparison
+            if (expression->binary.op == TOK_LESS ||
+                expression->binary.op == TOK_GREATER ||
+                expression->binary.op == TOK_LESS_EQUAL ||
+                expression->binary.op == TOK_GREATER_EQUAL) {
+
+                if (not_number(left_type)) {
+
+                    ErrorLocation loc = {.line      = expression->line,
+                                         .col_start = expression->column_start,
+                                         .col_end   = expression->column_end};
+                    error_type_mismatch(loc,
+                                        "comparison",
+                                        "number",
+                                        token_type_to_string(left_type));
+                }
+
+                return TOK_BOOLEAN_T;
+            }
+
+            if (not_number(left_type)) {
+
+                ErrorLocation loc = {.line      = expression->line,
+                                     .col_start = expression->column_start,
+                                     .col_end   = expression->column_end};
+                error_type_mismatch(loc,
+                                    "binary op",
+                                    "number",
+                                    token_type_to_string(left_type));
+            }
+
+            return left_type;
+        }
+
+        default:
+            return TOK_UNKNOWN;
+    }
+}
+
+/* Resolve an expression exactly once, recording its type on the node so
+ * neither the enclosing checks nor codegen ever walk it again. Operands are
+ * resolved before the node using them, walked on the emitter's stack */
+static TokenType check_expression(Emitter       *emitter,
+                                  FunctionDef   *current_fn,
+                                  AstExpression *expression) {
+
+    size_t base = emitter->expr_count;
+
+    push_expr_frame(emitter, expression);
+
+    while (emitter->expr_count > base) {
+
+        ExprFrame     *frame = &emitter->expr_stack[emitter->expr_count - 1];
+        AstExpression *node  = frame->expression;
+
+        if (node->tag == EXP_CALL)
+            check_call(emitter, node, frame->next);
+
+        AstExpression *operand = expression_operand(node, frame->next);
+
+        if (operand) {
+
+            frame->next++;
+            push_expr_frame(emitter, operand);
+            continue;
+        }
+
+        emitter->expr_count--;
+        node->type = resolve_expression(emitter, current_fn, node);
+    }
+
+    return expression->type;
+}
+
+/* Check one statement. An if or while checks its condition and opens the
+ * scope its block is checked in */
+static void check_statement(Emitter      *emitter,
+                            FunctionDef  *current_fn,
+                            AstStatement *statement) {
+
+    ErrorLocation loc = {.line      = statement->line,
+                         .col_start = statement->column_start,
+                         .col_end   = statement->column_end};
+
+    switch (statement->tag) {
+
+        case STM_OUT: {
+
+            TokenType expr_type = check_expression(emitter,
+                                                   current_fn,
+                                                   statement->out.expression);
+
+            if (expr_type == TOK_VOID_T)
+                error_type_mismatch(loc, "out", "value", "void");
+
+        } break;
+
+        case STM_ASSIGN: {
+
+            TokenType var_type = get_variable_type(emitter,
+                                                   current_fn,
+                                                   statement->assign.var_name,
+                                                   &statement->assign.is_local,
+                                                   &statement->assign.slot);
+
+            if (var_type == TOK_UNKNOWN && !statement->assign.is_local) {
+
+                if (emitter->recover)
+                    add_local(emitter,
+                              current_fn,
+                              statement->assign.var_name,
+                              TOK_UNKNOWN);
+
+                if (!emitter->lost)
+                    error_undefined_var(loc, statement->assign.var_name);
+            }
+
+            TokenType expr_type =
+                    check_expression(emitter,
+                                     current_fn,
+                                     statement->assign.expression);
+
+            if (mismatched(var_type, expr_type))
+                error_type_mismatch(loc,
+                                    statement->assign.var_name,
+                                    token_type_to_string(var_type),
+                                    token_type_to_string(expr_type));
+
+        } break;
+
+        case STM_VAR_DECL: {
+
+            if (statement->var_decl.init_count > 0 &&
+                statement->var_decl.init_count !=
+                        statement->var_decl.var_count)
+                error_wrong_var_init(loc,
+                                     statement->var_decl.var_count,
+                                     statement->var_decl.init_count);
+
+            // Each name is declared before its initialiser is checked, and
+            // the locals come out consecutive from first_slot
+            for (size_t i = 0; i < statement->var_decl.var_count; i++) {
+
+                size_t var_indx = add_local(emitter,
+                                            current_fn,
+                                            statement->var_decl.var_names[i],
+                                            statement->var_decl.var_type);
+
+                if (i == 0)
+                    statement->var_decl.first_slot = var_indx;
+
+                if (i < statement->var_decl.init_count) {
+
+                    TokenType var_type  = statement->var_decl.var_type;
+                    TokenType expr_type = check_expression(
+                            emitter,
+                            current_fn,
+                            statement->var_decl.init_exprs[i]);
+
+                    if (mismatched(var_type, expr_type))
+                        error_type_mismatch(loc,
+                                            statement->var_decl.var_names[i],
+                                            token_type_to_string(var_type),
+                                            token_type_to_string(expr_type));
+                }
+            }
+
+        } break;
+
+        case STM_RETURN: {
+
+            current_fn->has_return = true;
+
+            if (current_fn->return_type == TOK_VOID_T) {
+
+                if (statement->ret.expression)
+                    error_type_mismatch(loc, "return", "void", "non-void");
+
+                break;
+            }
+
+            if (!statement->ret.expression)
+                error_expect_symbol(loc, "return value");
+
+            TokenType expr_type = check_expression(emitter,
+                                                   current_fn,
+                                                   statement->ret.expression);
+
+            if (mismatched(current_fn->return_type, expr_type))
+                error_type_mismatch(loc,
+                                    "return",
+                                    token_type_to_string(
+                                            current_fn->return_type),
+                                    token_type_to_string(expr_type));
+
+        } break;
+
+        case STM_EXPR: {
+
+            check_expression(emitter, current_fn, statement->expr.expression);
+
+        } break;
+
+        case STM_IF:
+        case STM_WHILE: {
+
+            TokenType cond_type =
+                    check_expression(emitter,
+                                     current_fn,
+                                     statement->if_stmt.condition);
+
+            if (mismatched(TOK_BOOLEAN_T, cond_type))
+                error_type_mismatch(loc,
+                                    "condition",
+                                    "bool",
+                                    token_type_to_string(cond_type));
+
+            open_scope(&emitter->local_index);
+
+        } break;
+    }
+}
+
+/* Go on after an error in the statement last checked in the innermost
+ * block as if it had passed, its names declared and an if or while still
+ * opening its block, so what follows isn't reported for it again */
+static void recover_statement(Emitter *emitter, FunctionDef *current_fn) {
+
+    BlockFrame   *frame     = &emitter->block_stack[emitter->block_count - 1];
+    AstStatement *statement = frame->block->statements[frame->next - 1];
+
+    emitter->expr_count = 0;
+
+    if (statement->tag == STM_VAR_DECL) {
+
+        for (size_t i = 0; i < statement->var_decl.var_count; i++)
+            add_local(emitter,
+                      current_fn,
+                      statement->var_decl.var_names[i],
+                      statement->var_decl.var_type);
+
+    } else if (statement->tag == STM_IF || statement->tag == STM_WHILE) {
+
+        open_scope(&emitter->local_index);
+        push_block_frame(emitter, statement->if_stmt.then_block, statement);
+    }
+}
+
+/* Check a block and every block nested in it on the emitter's stack. Each
+ * block is checked in a scope that closes at its end, and an if's else
+ * block is only started once its then block is done. A recovering checker
+ * reports an error in a statement and goes on with the next */
+static void
+check_block(Emitter *emitter, FunctionDef *current_fn, AstBlock *block) {
+
+    jmp_buf           recover;
+    jmp_buf *volatile outer = NULL;
+    size_t            base  = emitter->block_count;
+
+    open_scope(&emitter->local_index);
+    push_block_frame(emitter, block, NULL);
+
+    if (emitter->recover) {
+
+        outer = error_recover(&recover);
+
+        if (setjmp(recover))
+            recover_statement(emitter, current_fn);
+    }
+
+    while (emitter->block_count > base) {
+
+        BlockFrame *frame = &emitter->block_stack[emitter->block_count - 1];
+
+        if (frame->next < frame->block->len) {
+
+            AstStatement *statement = frame->block->statements[frame->next++];
+            check_statement(emitter, current_fn, statement);
+
+            if (statement->tag == STM_IF || statement->tag == STM_WHILE)
+                push_block_frame(emitter,
+                                 statement->if_stmt.then_block,
+                                 statement);
+            continue;
+        }
+
+        BlockFrame done = *frame;
+        emitter->block_count--;
+
+        close_scope(&emitter->local_index);
+
+        if (done.owner && done.owner->tag == STM_IF &&
+            done.block == done.owner->if_stmt.then_block &&
+            done.owner->if_stmt.else_block) {
+
+            open_scope(&emitter->local_index);
+            push_block_frame(emitter,
+                             done.owner->if_stmt.else_block,
+                             done.owner);
+        }
+    }
+
+    if (emitter->recover)
+        error_recover(outer);
+}
+
+static void
+check_function(Emitter *emitter, FunctionDef *fn, AstDeclaration *declare) {
+
+    fn->has_return = false;
+
+    // The parameters become locals first
+    for (size_t i = 0; i < declare->func.param_count; i++)
+        add_local(emitter,
+                  fn,
+                  declare->func.params[i].name,
+                  declare->func.params[i].type);
+
+    check_block(emitter, fn, declare->func.body);
+    free_symbols(&emitter->local_index);
+
+    if (fn->return_type != TOK_VOID_T && !fn->has_return) {
+
+        ErrorLocation loc = {.line      = declare->line,
+                             .col_start = declare->column_start,
+                             .col_end   = declare->column_end};
+        error_missing_return(loc, fn->name);
+    }
+}
+
+/* Register a function, or take a global's names or the entry block, of
+ * which there must be no more than one. When recovering a name taken twice
+ * or a second entry is reported and left out */
+static void register_declaration(Emitter         *emitter,
+                                 AstDeclaration  *decl,
+                                 AstDeclaration **entry) {
+
+    jmp_buf           recover;
+    jmp_buf *volatile outer = NULL;
+
+    if (emitter->recover) {
+
+        outer = error_recover(&recover);
+
+        if (setjmp(recover)) {
+
+            error_recover(outer);
+            return;
+        }
+    }
+
+    if (decl->tag == DEC_FUNC) {
+
+        register_function(emitter,
+                          decl->func.name,
+                          decl->func.return_type,
+                          decl->func.params,
+                          decl->func.param_count);
+
+    } else if (decl->tag == DEC_VAR) {
+
+        for (size_t v = 0; v < decl->var_decl.var_count; v++)
+            add_global(emitter,
+                       decl->var_decl.var_names[v],
+                       decl->var_decl.var_type);
+
+    } else if (*entry) {
+
+        ErrorLocation loc = {.line      = decl->line,
+                             .col_start = decl->column_start,
+                             .col_end   = decl->column_end};
+        error_multiple_entry(loc);
+
+    } else {
+
+        *entry = decl;
+    }
+
+    if (emitter->recover)
+        error_recover(outer);
+}
+
+/* First pass where we register functions and global vars, so neither has
+ * to be declared before it is used. Returns the entry declaration, or NULL
+ * if there is none */
+static AstDeclaration *register_declarations(Emitter    *emitter,
+                                             AstProgram *program) {
+
+    AstDeclaration *entry = NULL;
+
+    for (size_t i = 0; i < program->len; i++)
+        register_declaration(emitter, program->declarations[i], &entry);
+
+    return entry;
+}
+
+/* The declaration of every function, in the order of the function table */
+static AstDeclaration **
+function_declarations(Emitter *emitter, AstProgram *program, Arena *arena) {
+
+    AstDeclaration **func_decls = arena_alloc(
+            arena, emitter->func_count * sizeof(AstDeclaration *));
+    size_t           fn_indx    = 0;
+
+    for (size_t i = 0; i < program->len; i++) {
+
+        AstDeclaration *decl = program->declarations[i];
+
+        // A function whose name was taken never got a slot
+        if (decl->tag == DEC_FUNC && fn_indx < emitter->func_count &&
+            emitter->functions[fn_indx].name == decl->func.name)
+            func_decls[fn_indx++] = decl;
+    }
+
+    return func_decls;
+}
+
+/* Check the body of entry or of the function fn, parsing it first if it was
+ * skipped. When recovering, an error its statements can't absorb is
+ * reported and the rest of it passed by, as is a body that lost statements
+ * to a syntax error */
+static void check_declaration(Emitter        *emitter,
+                              FunctionDef    *fn,
+                              AstDeclaration *decl,
+                              Parser         *deferred) {
+
+    jmp_buf           recover;
+    jmp_buf *volatile outer = NULL;
+
+    if (emitter->recover) {
+
+        outer = error_recover(&recover);
+
+        if (setjmp(recover)) {
+
+            error_recover(outer);
+
+            emitter->expr_count  = 0;
+            emitter->block_count = 0;
+            free_symbols(&emitter->local_index);
+
+            return;
+        }
+    }
+
+    if (decl->tag == DEC_ENTRY) {
+
+        if (!decl->entry.block->broken) {
+
+            fn->has_return = false;
+            check_block(emitter, fn, decl->entry.block);
+            free_symbols(&emitter->local_index);
+        }
+
+    } else {
+
+        if (!decl->func.body)
+            parse_function_body(deferred, decl);
+
+        if (!decl->func.body->broken)
+            check_function(emitter, fn, decl);
+    }
+
+    if (emitter->recover)
+        error_recover(outer);
+}
+
+/* Resolve every name and type in the program in one walk, filling the
+ * emitter's symbol tables and annotating each node with its type and slot.
+ * Entry is checked first, then functions in declaration order. When the
+ * parser skipped function bodies, a function is only parsed and checked
+ * once a call to it is found, starting from entry, and the rest are never
+ * compiled. Every error is reported before giving up, along with any the
+ * parser went on past. Declarations it lost leave the rest checked, with
+ * names that may have been among them taken as untyped */
+void check_program(Emitter *emitter, AstProgram *program, Arena *arena) {
+
+    init_emitter(emitter, arena);
+
+    emitter->recover = true;
+    emitter->lost    = program->broken;
+
+    AstDeclaration *entry = register_declarations(emitter, program);
+
+    AstDeclaration **func_decls =
+            function_declarations(emitter, program, arena);
+
+    emitter->pending = malloc(emitter->func_count * sizeof(size_t));
+    if (emitter->func_count && !emitter->pending)
+        error_oom();
+
+    // Parsed bodies are all checked, skipped ones only once called
+    if (!program->deferred)
+        for (size_t i = 0; i < emitter->func_count; i++)
+            queue_function(emitter, i);
+
+    if (entry)
+        check_declaration(emitter, &emitter->entry, entry, NULL);
+
+    // Checking a body can queue more functions behind it
+    for (size_t i = 0; i < emitter->pending_count; i++) {
+
+        size_t indx = emitter->pending[i];
+
+        check_declaration(emitter,
+                          &emitter->functions[indx],
+                          func_decls[indx],
+                          program->deferred);
+    }
+
+    emitter->recover = false;
+
+    if (!entry && !emitter->lost)
+        error_no_entry();
+
+    if (error_count())
+        error_fail();
+}
+
+/* Register a function, for a program compiled a declaration at a time */
+FunctionDef *declare_function(Emitter *emitter, AstDeclaration *declaration) {
+
+    return register_function(emitter,
+                             declaration->func.name,
+                             declaration->func.return_type,
+                             declaration->func.params,
+                             declaration->func.param_count);
+}
+
+/* Register one of a declaration's globals */
+size_t declare_global(Emitter *emitter, char *name, TokenType type) {
+
+    return add_global(emitter, name, type);
+}
+
+/* Check and emit the body of entry or a function on its own, once every
+ * declaration is registered. A recovering emitter reports every error in
+ * the body before giving up on it */
+void compile_body(Emitter        *emitter,
+                  FunctionDef    *fn,
+                  AstDeclaration *declaration) {
+
+    size_t    errors = error_count();
+    AstBlock *body;
+
+    if (declaration->tag == DEC_ENTRY) {
+
+        fn->has_return = false;
+        check_block(emitter, fn, declaration->entry.block);
+        free_symbols(&emitter->local_index);
+        body = declaration->entry.block;
+
+    } else {
+
+        check_function(emitter, fn, declaration);
+        body = declaration->func.body;
+    }
+
+    // Errors the check went on past leave nothing fit to emit
+    if (error_count() > errors)
+        error_unwind();
+
+    emit_body(emitter, fn, body);
+}
+
+/* A program being checked and emitted in one pass. The function whose body
+ * is open is worked on as a copy, since reading ahead can grow the table
+ * it lives in, and goes back to its slot once the body ends */
+typedef struct {
+
+    Emitter      *emitter;
+    FunctionDef   body;
+    FunctionDef  *fn;   // body, or entry itself
+    size_t        indx; // Of body in the function table
+    ErrorLocation at;   // Of the declaration being compiled
+    bool          read_ahead;
+    bool          has_entry;
+
+} DirectCompile;
+
+/* Every function is compiled where it is declared, so none is queued */
+static void declare_direct(Emitter *emitter, AstDeclaration *declaration) {
+
+    if (declaration->tag == DEC_VAR) {
+
+        for (size_t v = 0; v < declaration->var_decl.var_count; v++)
+            add_global(emitter,
+                       declaration->var_decl.var_names[v],
+                       declaration->var_decl.var_type);
+
+    } else if (declaration->tag == DEC_FUNC) {
+
+        register_function(emitter,
+                          declaration->func.name,
+                          declaration->func.return_type,
+                          declaration->func.params,
+                          declaration->func.param_count)
+                ->compiled = true;
+    }
+}
+
+static void direct_ahead(void *context, AstDeclaration *declaration) {
+
+    DirectCompile *direct = context;
+
+    direct->read_ahead = true;
+    declare_direct(direct->emitter, declaration);
+}
+
+/* Register a declaration, unless reading ahead already has, and start the
+ * body of an entry or function */
+static void direct_declaration(void *context, AstDeclaration *declaration) {
+
+    DirectCompile *direct  = context;
+    Emitter       *emitter = direct->emitter;
+
+    if (!direct->read_ahead)
+        declare_direct(emitter, declaration);
+
+    if (declaration->tag == DEC_VAR)
+        return;
+
+    direct->at = (ErrorLocation){.line      = declaration->line,
+                                 .col_start = declaration->column_start,
+                                 .col_end   = declaration->column_end};
+
+    if (declaration->tag == DEC_ENTRY) {
+
+        if (direct->has_entry)
+            error_multiple_entry(direct->at);
+
+        direct->has_entry = true;
+        direct->fn        = &emitter->entry;
+
+    } else {
+
+        FunctionDef *fn = find_function(emitter, declaration->func.name);
+
+        direct->indx = (size_t)(fn - emitter->functions);
+        direct->body = *fn;
+        direct->fn   = &direct->body;
+
+        // The parameters become locals first
+        for (size_t i = 0; i < declaration->func.param_count; i++)
+            add_local(emitter,
+                      direct->fn,
+                      declaration->func.params[i].name,
+                      declaration->func.params[i].type);
+    }
+
+    direct->fn->has_return = false;
+    begin_body(emitter, direct->fn);
+
+    open_scope(&emitter->local_index);
+}
+
+static void direct_statement(void *context, AstStatement *statement) {
+
+    DirectCompile *direct = context;
+
+    check_statement(direct->emitter, direct->fn, statement);
+    emit_statement(direct->emitter, direct->fn, statement);
+}
+
+static void direct_otherwise(void *context) {
+
+    DirectCompile *direct = context;
+
+    close_scope(&direct->emitter->local_index);
+    open_scope(&direct->emitter->local_index);
+    emit_else(direct->emitter);
+}
+
+/* The end of an if or while, or with none open the end of a body */
+static void direct_close(void *context) {
+
+    DirectCompile *direct  = context;
+    Emitter       *emitter = direct->emitter;
+    FunctionDef   *fn      = direct->fn;
+
+    close_scope(&emitter->local_index);
+
+    if (emitter->block_count > 0) {
+
+        emit_branch_end(emitter);
+        return;
+    }
+
+    free_symbols(&emitter->local_index);
+
+    if (fn != &emitter->entry && fn->return_type != TOK_VOID_T &&
+        !fn->has_return)
+        error_missing_return(direct->at, fn->name);
+
+    emit_body_end(emitter, fn);
+
+    if (fn == &direct->body)
+        emitter->functions[direct->indx] = direct->body;
+}
+
+/* Check and emit a program in one pass as the parser reads it, with no AST
+ * ever built. Each statement is checked and emitted as soon as it ends and
+ * its nodes are dropped, and entry starts wherever it appears. A name used
+ * before its declaration has the parser read ahead, once, for every
+ * declaration left, so the same programs compile as with check_program()
+ * and emit_program(). Errors come in source order instead, syntax errors no
+ * longer all before the rest */
+void compile_program(Emitter *emitter, Parser *parser, Arena *arena) {
+
+    init_emitter(emitter, arena);
+
+    Arena         scratch = {0};
+    DirectCompile direct  = {.emitter = emitter};
+    ParseSink     sink    = {.context     = &direct,
+                             .declaration = direct_declaration,
+                             .ahead       = direct_ahead,
+                             .statement   = direct_statement,
+                             .otherwise   = direct_otherwise,
+                             .close       = direct_close};
+
+    parser->nodes  = &scratch;
+    parser->sink   = &sink;
+    emitter->ahead = parser;
+
+    parse_program(parser);
+
+    parser->nodes  = parser->lexer->arena;
+    parser->sink   = NULL;
+    emitter->ahead = NULL;
+    arena_free(&scratch);
+
+    if (!direct.has_entry)
+        error_no_entry();
+
+    bound_program(emitter);
+}
+
+/* One thread's part of a parallel compile. Its functions are parsed with a
+ * lexer and parser of its own, then checked and emitted into a part, all
+ * allocating from its arena */
+typedef struct {
+
+    AstDeclaration **func_decls; // Of the whole program
+    CodeSpan        *spans;      // Where each function went in its part
+    size_t           func_count;
+    size_t           first_run;
+    size_t           share_count;
+
+    Lexer   lexer;
+    Parser  parser;
+    Arena   arena;
+    Emitter part;
+    bool    failed;
+
+} CompileShare;
+
+/* Compile every run of functions that falls to this share, stopping at the
+ * first error without reporting it */
+static void *compile_share(void *arg) {
+
+    CompileShare *share = arg;
+    Emitter      *part  = &share->part;
+    jmp_buf       bail;
+
+    if (setjmp(bail)) {
+
+        share->failed = true;
+        error_bail(NULL);
+        return NULL;
+    }
+
+    error_bail(&bail);
+
+    for (size_t start = share->first_run * SHARE_RUN;
+         start < share->func_count;
+         start += share->share_count * SHARE_RUN) {
+
+        size_t end = start + SHARE_RUN < share->func_count
+                             ? start + SHARE_RUN
+                             : share->func_count;
+
+        for (size_t i = start; i < end; i++) {
+
+            AstDeclaration *decl = share->func_decls[i];
+            CodeSpan       *span = &share->spans[i];
+
+            span->code_start  = part->code_len;
+            span->fixup_start = part->fixup_count;
+
+            parse_function_body(&share->parser, decl);
+            check_function(part, &part->functions[i], decl);
+            emit_body(part, &part->functions[i], decl->func.body);
+
+            span->code_end  = part->code_len;
+            span->fixup_end = part->fixup_count;
+        }
+    }
+
+    error_bail(NULL);
+
+    return NULL;
+}
+
+static size_t online_cpus(void) {
+
+#ifdef CHECK_THREADS
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+
+    return count > 0 ? (size_t)count : 1;
+#else
+    return 1;
+#endif
+}
+
+/* Compile every share, all but the first on threads of their own. Without
+ * threads, or if one can't be started, shares are compiled here instead */
+static void compile_shares(CompileShare *shares, size_t count) {
+
+#ifdef CHECK_THREADS
+    pthread_t *threads = calloc(count, sizeof(pthread_t));
+    bool      *started = calloc(count, sizeof(bool));
+    if (!threads || !started)
+        error_oom();
+
+    for (size_t i = 1; i < count; i++)
+        started[i] = pthread_create(&threads[i],
+                                    NULL,
+                                    compile_share,
+                                    &shares[i]) == 0;
+
+    compile_share(&shares[0]);
+
+    for (size_t i = 1; i < count; i++) {
+
+        if (started[i])
+            pthread_join(threads[i], NULL);
+        else
+            compile_share(&shares[i]);
+    }
+
+    free(threads);
+    free(started);
+#else
+    for (size_t i = 0; i < count; i++)
+        compile_share(&shares[i]);
+#endif
+}
+
+/* Parse the program with every function body skipped, then register its
+ * declarations and check entry, false on the first error */
+static bool try_declare(Emitter         *emitter,
+                        Parser          *parser,
+                        Arena           *arena,
+                        AstProgram     **program,
+                        AstDeclaration **entry) {
+
+    jmp_buf bail;
+
+    if (setjmp(bail)) {
+
+        error_bail(NULL);
+        return false;
+    }
+
+    error_bail(&bail);
+    init_emitter(emitter, arena);
+
+    parser->lazy = true;
+    *program     = parse_program(parser);
+    parser->lazy = false;
+
+    *entry = register_declarations(emitter, *program);
+
+    // Every body is compiled, called or not, as when parsed up front
+    for (size_t i = 0; i < emitter->func_count; i++)
+        emitter->functions[i].compiled = true;
+
+    if (!*entry)
+        error_no_entry();
+
+    check_declaration(emitter, &emitter->entry, *entry, NULL);
+
+    error_bail(NULL);
+
+    return true;
+}
+
+/* Put the functions compiled in shares together after entry, in
+ * declaration order, so the program comes out as emit_program() would
+ * have it */
+static void link_shares(Emitter      *emitter,
+                        CompileShare *shares,
+                        size_t        count,
+                        CodeSpan     *spans) {
+
+    size_t **maps = calloc(count, sizeof(size_t *));
+    if (!maps)
+        error_oom();
+
+    for (size_t s = 0; s < count; s++) {
+
+        maps[s] = calloc(shares[s].part.const_count + 1, sizeof(size_t));
+        if (!maps[s])
+            error_oom();
+    }
+
+    for (size_t i = 0; i < emitter->func_count; i++) {
+
+        size_t share = i / SHARE_RUN % count;
+
+        link_function(emitter,
+                      &emitter->functions[i],
+                      &shares[share].part,
+                      &spans[i],
+                      maps[share]);
+    }
+
+    for (size_t s = 0; s < count; s++)
+        free(maps[s]);
+
+    free(maps);
+}
+
+/* After an error anywhere, compile the program again from the start with
+ * every body parsed up front, which reports the error it would have */
+static void compile_again(Emitter *emitter, Parser *parser, Arena *arena) {
+
+    free_emitter(emitter);
+
+    parser->lazy    = false;
+    parser->recover = true;
+    rewind_parser(parser);
+
+    AstProgram *program = parse_program(parser);
+
+    check_program(emitter, program, arena);
+    emit_program(emitter, program);
+}
+
+/* Parse, check and emit the program with its function bodies spread across
+ * jobs threads, or one per CPU if jobs is 0. Declarations are parsed first
+ * with every body skipped, then runs of functions are handed round the
+ * threads, each parsing, checking and emitting its own into a part that is
+ * linked in declaration order once all are done, so the program is the
+ * same one check_program() and emit_program() would make. The parser must
+ * read a token buffer or a loaded source */
+void compile_parallel(Emitter *emitter,
+                      Parser  *parser,
+                      Arena   *arena,
+                      size_t   jobs) {
+
+    AstProgram     *program = NULL;
+    AstDeclaration *entry   = NULL;
+
+    if (!try_declare(emitter, parser, arena, &program, &entry)) {
+
+        compile_again(emitter, parser, arena);
+        return;
+    }
+
+    size_t count = jobs ? jobs : online_cpus();
+
+    if (count > emitter->func_count / SHARE_MIN)
+        count = emitter->func_count / SHARE_MIN;
+
+    if (count < 1)
+        count = 1;
+
+    CompileShare *shares = calloc(count, sizeof(CompileShare));
+    if (!shares)
+        error_oom();
+
+    AstDeclaration **func_decls =
+            function_declarations(emitter, program, arena);
+    CodeSpan        *spans =
+            arena_alloc(arena, emitter->func_count * sizeof(CodeSpan));
+
+    // Pick the scanners now, rather than have the threads race to
+    scan_impl_name();
+
+    for (size_t s = 0; s < count; s++) {
+
+        CompileShare *share = &shares[s];
+
+        share->func_decls  = func_decls;
+        share->spans       = spans;
+        share->func_count  = emitter->func_count;
+        share->first_run   = s;
+        share->share_count = count;
+
+        share->lexer       = *parser->lexer;
+        share->lexer.arena = &share->arena;
+        share->lexer.bail  = NULL;
+
+        share->parser = init_parser(&share->lexer, parser->tokens, NULL, false);
+        init_part(&share->part, emitter, &share->arena);
+    }
+
+    compile_shares(shares, count);
+
+    bool failed = false;
+
+    for (size_t s = 0; s < count; s++)
+        failed = failed || shares[s].failed;
+
+    if (!failed) {
+
+        emit_body(emitter, &emitter->entry, entry->entry.block);
+        link_shares(emitter, shares, count, spans);
+    }
+
+    // The trees and function tables the parts built stay with the program
+    for (size_t s = 0; s < count; s++) {
+
+        free_part(&shares[s].part);
+        free_parser(&shares[s].parser);
+
+        if (failed)
+            arena_free(&shares[s].arena);
+        else
+            arena_adopt(arena, &shares[s].arena);
+    }
+
+    free(shares);
+
+    if (failed)
+        compile_again(emitter, parser, arena);
+    else
+        bound_program(emitter);
+}
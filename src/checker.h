@@ -0,0 +1,20 @@
+#ifndef CHECKER_H
+#define CHECKER_H
+
+#include "codegen.h"
+
+void check_program(Emitter *emitter, AstProgram *program, Arena *arena);
+void compile_program(Emitter *emitter, Parser *parser, Arena *arena);
+void compile_parallel(Emitter *emitter,
+                      Parser  *parser,
+                      Arena   *arena,
+                      size_t   jobs);
+
+// Compiling a declaration at a time, as a watched source does
+FunctionDef *declare_function(Emitter *emitter, AstDeclaration *declaration);
+size_t       declare_global(Emitter *emitter, char *name, TokenType type);
+void         compile_body(Emitter        *emitter,
+                          FunctionDef    *fn,
+                          AstDeclaration *declaration);
+
+#endif
@@ -4,68 +4,33 @@
 #include <stdlib.h>
 #include <string.h>
 
-typedef struct {
-
-    char     **names;
-    TokenType *types;
-    size_t     count;
-    size_t     cap;
-
-} VarTable;
-
+/* Thread the interpreter through a table of label addresses when the compiler
+ * supports labels-as-values, and fall back to a portable switch otherwise */
+#if (defined(__GNUC__) || defined(__clang__)) && !defined(PHASE_SWITCH_DISPATCH)
+#    define COMPUTED_GOTO 1
+#    define VM_CASE(op) \
+        case op:        \
+        do_##op
+#    define VM_NEXT() goto *dispatch_table[read_byte(&ip)]
+#else
+#    define COMPUTED_GOTO 0
+#    define VM_CASE(op) case op
+#    define VM_NEXT() break
+#endif
+
+/* A frame's locals are the window of the VM stack starting at base, with the
+ * arguments the caller pushed forming its first slots */
 typedef struct CallFrame {
 
     FunctionDef *fn;
-    Value       *locals;
+    size_t       base;
     size_t       return_ip;
 
 } CallFrame;
 
-static void zero_locals(Value *locals, size_t count) {
-
-    for (size_t i = 0; i < count; i++)
-        locals[i].type = VAL_VOID;
-}
-static size_t
-add_to_var_table(VarTable *table, const char *name, TokenType type) {
-
-    if (table->count + 1 > table->cap) {
-        size_t new_cap    = table->cap ? table->cap * 2 : 8;
-        void  *temp_ptr_1 = realloc(table->names, new_cap * sizeof(char *));
-        if (!temp_ptr_1) {
-            free(table->names);
-            error_oom();
-        }
-
-        void *temp_ptr_2 = realloc(table->types, new_cap * sizeof(TokenType));
-        if (!temp_ptr_2) {
-            free(table->types);
-            error_oom();
-        }
-
-        table->names = temp_ptr_1;
-        table->types = temp_ptr_2;
-        table->cap   = new_cap;
-    }
-
-    table->names[table->count] = strdup(name);
-    table->types[table->count] = type;
-
-    return table->count++;
-}
-
-static size_t find_in_table(VarTable *table, const char *name) {
-
-    for (size_t i = 0; i < table->count; i++) {
-
-        if (strcmp(table->names[i], name) == 0)
-            return i;
-    }
-
-    return SIZE_MAX;
-}
+void init_emitter(Emitter *emitter, Arena *arena) {
 
-static void init_emitter(Emitter *emitter) {
+    emitter->arena = arena;
 
     emitter->code     = NULL;
     emitter->code_len = 0;
@@ -75,64 +40,114 @@ static void init_emitter(Emitter *emitter) {
     emitter->const_count = 0;
     emitter->const_cap   = 0;
 
+    emitter->const_slots    = NULL;
+    emitter->const_slot_cap = 0;
+    emitter->const_dupes    = 0;
+
     emitter->global_names = NULL;
     emitter->global_types = NULL;
     emitter->global_count = 0;
     emitter->global_cap   = 0;
 
+    emitter->global_index    = (SymbolTable){0};
+    emitter->function_index  = (SymbolTable){0};
+    emitter->local_index     = (SymbolTable){0};
+    emitter->undefined_index = (SymbolTable){0};
+
     emitter->functions  = NULL;
     emitter->func_count = 0;
     emitter->func_cap   = 0;
 
-    emitter->entry.name        = strdup("entry");
-    emitter->entry.return_type = TOK_VOID_T;
-    emitter->entry.param_types = NULL;
-    emitter->entry.param_count = 0;
-    emitter->entry.has_return  = false;
-    emitter->entry.local_names = NULL;
-    emitter->entry.local_types = NULL;
-    emitter->entry.local_count = 0;
-    emitter->entry.local_cap   = 0;
-    emitter->entry.start_ip    = 0;
-}
-
-static void free_function(FunctionDef *fn) {
-
-    if (!fn)
-        return;
-
-    free(fn->name);
-    free(fn->param_types);
-    for (size_t i = 0; i < fn->local_count; i++)
-        free(fn->local_names[i]);
-    free(fn->local_names);
-    free(fn->local_types);
+    emitter->pending       = NULL;
+    emitter->pending_count = 0;
+    emitter->ahead         = NULL;
+    emitter->recover       = false;
+    emitter->lost          = false;
+
+    emitter->stack_depth = 0;
+    emitter->fn_start    = 0;
+    emitter->stack_size  = 0;
+    emitter->frame_depth = 0;
+
+    emitter->apart       = false;
+    emitter->fixups      = NULL;
+    emitter->fixup_count = 0;
+    emitter->fixup_cap   = 0;
+
+    emitter->expr_stack  = NULL;
+    emitter->expr_count  = 0;
+    emitter->expr_cap    = 0;
+    emitter->block_stack = NULL;
+    emitter->block_count = 0;
+    emitter->block_cap   = 0;
+
+    emitter->entry.name         = arena_strndup(arena, "entry", 5);
+    emitter->entry.return_type  = TOK_VOID_T;
+    emitter->entry.param_types  = NULL;
+    emitter->entry.param_count  = 0;
+    emitter->entry.has_return   = false;
+    emitter->entry.local_names  = NULL;
+    emitter->entry.local_types  = NULL;
+    emitter->entry.local_count  = 0;
+    emitter->entry.local_cap    = 0;
+    emitter->entry.start_ip     = 0;
+    emitter->entry.max_stack    = 0;
+    emitter->entry.callees      = NULL;
+    emitter->entry.callee_count = 0;
+    emitter->entry.callee_cap   = 0;
+    emitter->entry.compiled     = true;
 }
 
+/* Release what the emitter keeps on the heap. Names, per-function tables
+ * and string constants belong to the arena and go with it */
 void free_emitter(Emitter *emitter) {
 
     free(emitter->code);
-
-    for (size_t i = 0; i < emitter->const_count; i++) {
-
-        if (emitter->constants[i].type == VAL_STRING)
-            free(emitter->constants[i].as.str);
-    }
-
     free(emitter->constants);
+    free(emitter->const_slots);
 
-    for (size_t i = 0; i < emitter->global_count; i++)
-        free(emitter->global_names[i]);
+    free_symbols(&emitter->global_index);
+    free_symbols(&emitter->function_index);
+    free_symbols(&emitter->local_index);
+    free_symbols(&emitter->undefined_index);
 
-    free(emitter->global_names);
-    free(emitter->global_types);
+    free(emitter->functions);
+    free(emitter->expr_stack);
+    free(emitter->block_stack);
+    free(emitter->pending);
+    free(emitter->fixups);
+}
 
-    free_function(&emitter->entry);
+/* Set up part to emit functions apart from program, into code and a
+ * constant pool of its own, allocating from arena. It resolves names
+ * through program's globals and functions, which stay as they are while
+ * any part is in use */
+void init_part(Emitter *part, const Emitter *program, Arena *arena) {
+
+    init_emitter(part, arena);
+
+    part->global_names   = program->global_names;
+    part->global_types   = program->global_types;
+    part->global_count   = program->global_count;
+    part->global_cap     = program->global_cap;
+    part->global_index   = program->global_index;
+    part->function_index = program->function_index;
+    part->functions      = program->functions;
+    part->func_count     = program->func_count;
+    part->func_cap       = program->func_cap;
+    part->apart          = true;
+}
 
-    for (size_t i = 0; i < emitter->func_count; i++)
-        free_function(&emitter->functions[i]);
+/* Release what a part keeps on the heap, leaving the program's tables */
+void free_part(Emitter *part) {
 
-    free(emitter->functions);
+    free(part->code);
+    free(part->constants);
+    free(part->const_slots);
+    free_symbols(&part->local_index);
+    free(part->expr_stack);
+    free(part->block_stack);
+    free(part->fixups);
 }
 
 static void emit_byte(Emitter *emitter, uint8_t byte) {
@@ -159,6 +174,13 @@ static void emit_u16(Emitter *emitter, size_t value) {
     emit_byte(emitter, value & 0xFF);
 }
 
+/* Where the next instruction goes, counted from the start of the function
+ * being emitted as jump targets are, so a function's code can move */
+static size_t function_offset(Emitter *emitter) {
+
+    return emitter->code_len - emitter->fn_start;
+}
+
 static size_t emit_jump(Emitter *emitter, Opcode op) {
     emit_byte(emitter, op);
     size_t jump_pos = emitter->code_len;
@@ -167,364 +189,278 @@ static size_t emit_jump(Emitter *emitter, Opcode op) {
 }
 
 static void patch_jump(Emitter *emitter, size_t jump_pos) {
-    size_t target = emitter->code_len;
+    size_t target = function_offset(emitter);
     if (target > UINT16_MAX)
         error_complexity();
     emitter->code[jump_pos]     = (target >> 8) & 0xFF;
     emitter->code[jump_pos + 1] = target & 0xFF;
 }
 
+/* Apply the stack effect of the instruction just emitted to the running
+ * depth, keeping the function's high-water mark */
 static void
-emit_block(Emitter *emitter, FunctionDef *current_fn, AstBlock *block);
+track_stack(Emitter *emitter, FunctionDef *fn, size_t pops, size_t pushes) {
 
-static size_t add_constant(Emitter *emitter, Value value) {
+    emitter->stack_depth -= pops;
+    emitter->stack_depth += pushes;
 
-    if (emitter->const_count + 1 > emitter->const_cap) {
+    if (emitter->stack_depth > fn->max_stack)
+        fn->max_stack = emitter->stack_depth;
+}
 
-        size_t new_cap  = emitter->const_cap ? emitter->const_cap * 2 : 8;
-        void  *temp_ptr = realloc(emitter->constants, new_cap * sizeof(Value));
+void push_expr_frame(Emitter *emitter, AstExpression *expression) {
+
+    if (emitter->expr_count + 1 > emitter->expr_cap) {
+
+        size_t new_cap  = emitter->expr_cap ? emitter->expr_cap * 2 : 32;
+        void  *temp_ptr = realloc(emitter->expr_stack,
+                                 new_cap * sizeof(ExprFrame));
         if (!temp_ptr) {
-            free(emitter->constants);
+            free(emitter->expr_stack);
             error_oom();
         }
 
-        emitter->constants = temp_ptr;
-        emitter->const_cap = new_cap;
+        emitter->expr_stack = temp_ptr;
+        emitter->expr_cap   = new_cap;
     }
 
-    emitter->constants[emitter->const_count] = value;
-
-    return emitter->const_count++;
+    emitter->expr_stack[emitter->expr_count++] =
+            (ExprFrame){.expression = expression, .next = 0};
 }
 
-static size_t add_global(Emitter *emitter, const char *name, TokenType type) {
+/* Push a block to walk, returning its frame so the caller can record the
+ * jumps to patch once the block ends */
+BlockFrame *
+push_block_frame(Emitter *emitter, AstBlock *block, AstStatement *owner) {
 
-    if (emitter->global_count + 1 > emitter->global_cap) {
+    if (emitter->block_count + 1 > emitter->block_cap) {
 
-        size_t new_cap = emitter->global_cap ? emitter->global_cap * 2 : 8;
-        void  *temp_ptr_1 =
-                realloc(emitter->global_names, new_cap * sizeof(char *));
-        if (!temp_ptr_1) {
-            free(emitter->global_names);
-            error_oom();
-        }
-
-        void *temp_ptr_2 =
-                realloc(emitter->global_types, new_cap * sizeof(TokenType));
-        if (!temp_ptr_2) {
-            free(emitter->global_types);
+        size_t new_cap  = emitter->block_cap ? emitter->block_cap * 2 : 16;
+        void  *temp_ptr = realloc(emitter->block_stack,
+                                 new_cap * sizeof(BlockFrame));
+        if (!temp_ptr) {
+            free(emitter->block_stack);
             error_oom();
         }
 
-        emitter->global_names = temp_ptr_1;
-        emitter->global_types = temp_ptr_2;
-        emitter->global_cap   = new_cap;
+        emitter->block_stack = temp_ptr;
+        emitter->block_cap   = new_cap;
     }
 
-    emitter->global_names[emitter->global_count] = strdup(name);
-    emitter->global_types[emitter->global_count] = type;
-
-    return emitter->global_count++;
-}
-
-static size_t find_global(Emitter *emitter, const char *name) {
+    BlockFrame *frame = &emitter->block_stack[emitter->block_count++];
 
-    for (size_t i = 0; i < emitter->global_count; i++) {
+    *frame = (BlockFrame){.block = block, .next = 0, .owner = owner};
 
-        if (strcmp(emitter->global_names[i], name) == 0)
-            return i;
-    }
-
-    return SIZE_MAX;
+    return frame;
 }
 
-static FunctionDef *find_function(Emitter *emitter, const char *name) {
+/* The operands of an expression in evaluation order, NULL past the last */
+AstExpression *expression_operand(AstExpression *expression, size_t index) {
 
-    for (size_t i = 0; i < emitter->func_count; i++) {
+    switch (expression->tag) {
 
-        if (strcmp(emitter->functions[i].name, name) == 0)
-            return &emitter->functions[i];
+        case EXP_CALL:
+            return index < expression->call.arg_count
+                           ? expression->call.args[index]
+                           : NULL;
+        case EXP_UNARY:
+            return index == 0 ? expression->unary.expr : NULL;
+        case EXP_BINARY:
+            return index == 0   ? expression->binary.left
+                   : index == 1 ? expression->binary.right
+                                : NULL;
+        default:
+            return NULL;
     }
-
-    return NULL;
 }
 
-static FunctionDef *register_function(Emitter    *emitter,
-                                      const char *name,
-                                      TokenType   return_type,
-                                      AstParam   *params,
-                                      size_t      param_count) {
-
-    if (find_function(emitter, name)) {
+/* FNV-1a over the type tag and the value's bytes. Floats hash by bit
+ * pattern so 0.0 and -0.0 stay distinct constants */
+static uint64_t hash_constant(Value value) {
 
-        ErrorLocation loc = {0};
-        error_invalid_token(loc);
-    }
+    uint64_t       hash = 14695981039346656037ULL;
+    const uint8_t *bytes;
+    size_t         len;
 
-    if (emitter->func_count + 1 > emitter->func_cap) {
+    switch (value.type) {
 
-        size_t new_cap = emitter->func_cap ? emitter->func_cap * 2 : 4;
-        void  *temp_ptr =
-                realloc(emitter->functions, new_cap * sizeof(FunctionDef));
-        if (!temp_ptr) {
-            free(emitter->functions);
-            error_oom();
-        }
+        case VAL_STRING:
+            bytes = (const uint8_t *)value.as.str;
+            len   = strlen(value.as.str);
+            break;
 
-        emitter->functions = temp_ptr;
-        emitter->func_cap  = new_cap;
-    }
+        case VAL_INTEGER:
+            bytes = (const uint8_t *)&value.as.integer;
+            len   = sizeof(value.as.integer);
+            break;
 
-    FunctionDef *fn = &emitter->functions[emitter->func_count++];
+        case VAL_FLOAT:
+            bytes = (const uint8_t *)&value.as.floating;
+            len   = sizeof(value.as.floating);
+            break;
 
-    fn->name        = strdup(name);
-    fn->return_type = return_type;
-    fn->param_count = param_count;
-    fn->param_types = calloc(param_count, sizeof(TokenType));
-    fn->has_return  = false;
-    fn->local_names = NULL;
-    fn->local_types = NULL;
-    fn->local_count = 0;
-    fn->local_cap   = 0;
-    fn->start_ip    = 0;
+        case VAL_BOOLEAN:
+            bytes = (const uint8_t *)&value.as.boolean;
+            len   = sizeof(value.as.boolean);
+            break;
 
-    if (param_count && !fn->param_types)
-        error_oom();
+        default:
+            bytes = NULL;
+            len   = 0;
+            break;
+    }
 
-    for (size_t i = 0; i < param_count; i++)
-        fn->param_types[i] = params[i].type;
+    hash = (hash ^ value.type) * 1099511628211ULL;
 
-    return fn;
-}
+    for (size_t i = 0; i < len; i++)
+        hash = (hash ^ bytes[i]) * 1099511628211ULL;
 
-static size_t add_local(FunctionDef *fn, const char *name, TokenType type) {
-
-    VarTable table  = {.names = fn->local_names,
-                       .types = fn->local_types,
-                       .count = fn->local_count,
-                       .cap   = fn->local_cap};
-    size_t   idx    = add_to_var_table(&table, name, type);
-    fn->local_names = table.names;
-    fn->local_types = table.types;
-    fn->local_count = table.count;
-    fn->local_cap   = table.cap;
-    return idx;
+    return hash;
 }
 
-static size_t find_local(FunctionDef *fn, const char *name) {
-
-    VarTable table = {.names = fn->local_names,
-                      .types = fn->local_types,
-                      .count = fn->local_count};
-    return find_in_table(&table, name);
-}
+static bool same_constant(Value a, Value b) {
 
-static TokenType get_variable_type(Emitter     *emitter,
-                                   FunctionDef *current_fn,
-                                   const char  *name,
-                                   bool        *is_local_out,
-                                   size_t      *index_out) {
+    if (a.type != b.type)
+        return false;
 
-    size_t local_idx = find_local(current_fn, name);
+    switch (a.type) {
 
-    if (local_idx != SIZE_MAX) {
+        case VAL_STRING:
+            return strcmp(a.as.str, b.as.str) == 0;
+        case VAL_INTEGER:
+            return a.as.integer == b.as.integer;
+        case VAL_FLOAT:
+            return memcmp(&a.as.floating,
+                          &b.as.floating,
+                          sizeof(a.as.floating)) == 0;
+        case VAL_BOOLEAN:
+            return a.as.boolean == b.as.boolean;
+        default:
+            return true;
+    }
+}
 
-        if (is_local_out)
-            *is_local_out = true;
-        if (index_out)
-            *index_out = local_idx;
+/* Find the slot holding value, or the empty slot where it belongs */
+static size_t find_const_slot(Emitter *emitter, Value value) {
 
-        return current_fn->local_types[local_idx];
-    }
+    size_t mask = emitter->const_slot_cap - 1;
+    size_t slot = (size_t)hash_constant(value) & mask;
 
-    size_t global_idx = find_global(emitter, name);
+    while (emitter->const_slots[slot] != 0) {
 
-    if (global_idx != SIZE_MAX) {
+        size_t indx = emitter->const_slots[slot] - 1;
 
-        if (is_local_out)
-            *is_local_out = false;
-        if (index_out)
-            *index_out = global_idx;
+        if (same_constant(emitter->constants[indx], value))
+            break;
 
-        return emitter->global_types[global_idx];
+        slot = (slot + 1) & mask;
     }
 
-    return TOK_UNKNOWN;
+    return slot;
 }
 
-static TokenType get_expression_type(Emitter       *emitter,
-                                     FunctionDef   *current_fn,
-                                     AstExpression *expression) {
+/* Double the index and rehash every constant, keeping it at most half full */
+static void grow_const_slots(Emitter *emitter) {
 
-    switch (expression->tag) {
-
-        case EXP_STRING:
-            return TOK_STRING_T;
-        case EXP_INTEGER:
-            return TOK_INTEGER_T;
-        case EXP_FLOAT:
-            return TOK_FLOAT_T;
-        case EXP_BOOLEAN:
-            return TOK_BOOLEAN_T;
-        case EXP_VARIABLE: {
-
-            bool      is_local = false;
-            size_t    idx      = 0;
-            TokenType t        = get_variable_type(emitter,
-                                            current_fn,
-                                            expression->variable.name,
-                                            &is_local,
-                                            &idx);
-
-            if (t == TOK_UNKNOWN) {
-
-                ErrorLocation loc = {.line      = expression->line,
-                                     .col_start = expression->column_start,
-                                     .col_end   = expression->column_end};
-                error_undefined_var(loc, expression->variable.name);
-            }
-
-            return t;
-        }
-        case EXP_CALL: {
+    size_t  new_cap = emitter->const_slot_cap ? emitter->const_slot_cap * 2
+                                              : 16;
+    size_t *slots   = calloc(new_cap, sizeof(size_t));
+    if (!slots)
+        error_oom();
 
-            FunctionDef *fn =
-                    find_function(emitter, expression->call.func_name);
+    free(emitter->const_slots);
+    emitter->const_slots    = slots;
+    emitter->const_slot_cap = new_cap;
 
-            if (!fn) {
+    for (size_t i = 0; i < emitter->const_count; i++) {
 
-                ErrorLocation loc = {.line      = expression->line,
-                                     .col_start = expression->column_start,
-                                     .col_end   = expression->column_end};
-                error_undefined_func(loc, expression->call.func_name);
-            }
+        size_t slot = find_const_slot(emitter, emitter->constants[i]);
 
-            return fn->return_type;
-        }
+        emitter->const_slots[slot] = i + 1;
+    }
+}
 
-        case EXP_UNARY: {
+/* Intern a literal, returning the index of an equal constant if the pool
+ * already holds one. Strings are borrowed from the arena-owned AST */
+static size_t add_constant(Emitter *emitter, Value value) {
 
-            TokenType inner = get_expression_type(emitter,
-                                                  current_fn,
-                                                  expression->unary.expr);
+    if ((emitter->const_count + 1) * 2 > emitter->const_slot_cap)
+        grow_const_slots(emitter);
 
-            if (expression->unary.op == TOK_BANG ||
-                expression->unary.op == TOK_NOT) {
+    size_t slot = find_const_slot(emitter, value);
 
-                if (inner != TOK_BOOLEAN_T) {
+    if (emitter->const_slots[slot] != 0) {
 
-                    ErrorLocation loc = {.line      = expression->line,
-                                         .col_start = expression->column_start,
-                                         .col_end   = expression->column_end};
-                    error_type_mismatch(loc,
-                                        "not",
-                                        "bool",
-                                        token_type_to_string(inner));
-                }
-
-                return TOK_BOOLEAN_T;
+        emitter->const_dupes++;
+        return emitter->const_slots[slot] - 1;
+    }
 
-            } else if (expression->unary.op == TOK_SUBTRACT) {
+    if (emitter->const_count + 1 > emitter->const_cap) {
 
-                if (inner != TOK_INTEGER_T && inner != TOK_FLOAT_T) {
+        size_t new_cap  = emitter->const_cap ? emitter->const_cap * 2 : 8;
+        void  *temp_ptr = realloc(emitter->constants, new_cap * sizeof(Value));
+        if (!temp_ptr) {
+            free(emitter->constants);
+            error_oom();
+        }
 
-                    ErrorLocation loc = {.line      = expression->line,
-                                         .col_start = expression->column_start,
-                                         .col_end   = expression->column_end};
-                    error_type_mismatch(loc,
-                                        "negation",
-                                        "number",
-                                        token_type_to_string(inner));
-                }
+        emitter->constants = temp_ptr;
+        emitter->const_cap = new_cap;
+    }
 
-                return inner;
-            }
+    emitter->constants[emitter->const_count] = value;
+    emitter->const_slots[slot]               = emitter->const_count + 1;
 
-            return TOK_UNKNOWN;
-        }
+    return emitter->const_count++;
+}
 
-        case EXP_BINARY: {
+/* Push a literal from the pool. Emitted apart, the index is only into the
+ * part's own pool, and where it sits is kept for linking */
+static void emit_constant(Emitter *emitter, FunctionDef *fn, Value value) {
 
-            TokenType left_type = get_expression_type(emitter,
-                                                      current_fn,
-                                                      expression->binary.left);
-            TokenType right_type =
-                    get_expression_type(emitter,
-                                        current_fn,
-                                        expression->binary.right);
-
-            if (left_type != right_type) {
-
-                ErrorLocation loc = {.line      = expression->line,
-                                     .col_start = expression->column_start,
-                                     .col_end   = expression->column_end};
-                error_type_mismatch(loc,
-                                    "binary op",
-                                    token_type_to_string(left_type),
-                                    token_type_to_string(right_type));
-            }
+    size_t indx = add_constant(emitter, value);
 
-            // Logic
-            if (expression->binary.op == TOK_AND ||
-                expression->binary.op == TOK_OR) {
+    emit_byte(emitter, OP_PUSH_CONST);
 
-                if (left_type != TOK_BOOLEAN_T) {
+    if (emitter->apart) {
 
-                    ErrorLocation loc = {.line      = expression->line,
-                                         .col_start = expression->column_start,
-                                         .col_end   = expression->column_end};
-                    error_type_mismatch(loc,
-                                        "logical op",
-                                        "bool",
-                                        token_type_to_string(left_type));
-                }
+        if (emitter->fixup_count + 1 > emitter->fixup_cap) {
 
-                return TOK_BOOLEAN_T;
-            }
+            size_t new_cap  = emitter->fixup_cap ? emitter->fixup_cap * 2 : 64;
+            void  *temp_ptr =
+                    realloc(emitter->fixups, new_cap * sizeof(size_t));
+            if (!temp_ptr)
+                error_oom();
 
-            // Equality
-            if (expression->binary.op == TOK_EQUAL_EQUAL) {
+            emitter->fixups    = temp_ptr;
+            emitter->fixup_cap = new_cap;
+        }
 
-                return TOK_BOOLEAN_T;
-            }
+        emitter->fixups[emitter->fixup_count++] = emitter->code_len;
+    }
 
-            // Comparison
-            if (expression->binary.op == TOK_LESS ||
-                expression->binary.op == TOK_GREATER ||
-                expression->binary.op == TOK_LESS_EQUAL ||
-                expression->binary.op == TOK_GREATER_EQUAL) {
-
-                if (left_type != TOK_INTEGER_T && left_type != TOK_FLOAT_T) {
-
-                    ErrorLocation loc = {.line      = expression->line,
-                                         .col_start = expression->column_start,
-                                         .col_end   = expression->column_end};
-                    error_type_mismatch(loc,
-                                        "comparison",
-                                        "number",
-                                        token_type_to_string(left_type));
-                }
+    emit_u16(emitter, indx);
+    track_stack(emitter, fn, 0, 1);
+}
 
-                return TOK_BOOLEAN_T;
-            }
+/* Record a call edge from fn, skipping a repeat of the last one recorded */
+static void add_callee(Emitter *emitter, FunctionDef *fn, size_t callee) {
 
-            if (left_type != TOK_INTEGER_T && left_type != TOK_FLOAT_T) {
+    if (fn->callee_count > 0 && fn->callees[fn->callee_count - 1] == callee)
+        return;
 
-                ErrorLocation loc = {.line      = expression->line,
-                                     .col_start = expression->column_start,
-                                     .col_end   = expression->column_end};
-                error_type_mismatch(loc,
-                                    "binary op",
-                                    "number",
-                                    token_type_to_string(left_type));
-            }
+    if (fn->callee_count + 1 > fn->callee_cap) {
 
-            return left_type;
-        }
+        size_t new_cap = fn->callee_cap ? fn->callee_cap * 2 : 4;
 
-        default:
-            return TOK_UNKNOWN;
+        fn->callees    = arena_grow(emitter->arena,
+                                 fn->callees,
+                                 fn->callee_cap * sizeof(size_t),
+                                 new_cap * sizeof(size_t));
+        fn->callee_cap = new_cap;
     }
+
+    fn->callees[fn->callee_count++] = callee;
 }
 
 const char *token_type_to_string(TokenType type) {
@@ -546,13 +482,87 @@ const char *token_type_to_string(TokenType type) {
     }
 }
 
+/* The value a variable of type holds before anything is assigned to it, so
+ * typed opcodes never meet an untyped slot */
+static Value zero_value(TokenType type) {
+
+    switch (type) {
+
+        case TOK_STRING_T:
+            return (Value){.type = VAL_STRING, .as.str = ""};
+        case TOK_INTEGER_T:
+            return (Value){.type = VAL_INTEGER, .as.integer = 0};
+        case TOK_FLOAT_T:
+            return (Value){.type = VAL_FLOAT, .as.floating = 0.0f};
+        case TOK_BOOLEAN_T:
+            return (Value){.type = VAL_BOOLEAN, .as.boolean = false};
+        default:
+            return (Value){.type = VAL_VOID};
+    }
+}
+
+/* Select the opcode for a binary operator specialised to its operand type */
+static Opcode binary_opcode(TokenType op, TokenType operand_type) {
+
+    bool is_float = operand_type == TOK_FLOAT_T;
+
+    switch (op) {
+
+        case TOK_ADD:
+            return is_float ? OP_ADD_FLOAT : OP_ADD_INT;
+        case TOK_SUBTRACT:
+            return is_float ? OP_SUB_FLOAT : OP_SUB_INT;
+        case TOK_MULTIPLY:
+            return is_float ? OP_MUL_FLOAT : OP_MUL_INT;
+        case TOK_DIVIDE:
+            return is_float ? OP_DIV_FLOAT : OP_DIV_INT;
+        case TOK_AND:
+            return OP_AND;
+        case TOK_OR:
+            return OP_OR;
+        case TOK_LESS:
+            return is_float ? OP_LESS_FLOAT : OP_LESS_INT;
+        case TOK_GREATER:
+            return is_float ? OP_GREATER_FLOAT : OP_GREATER_INT;
+        case TOK_LESS_EQUAL:
+            return is_float ? OP_LESS_EQUAL_FLOAT : OP_LESS_EQUAL_INT;
+        case TOK_GREATER_EQUAL:
+            return is_float ? OP_GREATER_EQUAL_FLOAT : OP_GREATER_EQUAL_INT;
+        case TOK_EQUAL_EQUAL: {
+
+            switch (operand_type) {
+
+                case TOK_INTEGER_T:
+                    return OP_EQUAL_INT;
+                case TOK_FLOAT_T:
+                    return OP_EQUAL_FLOAT;
+                case TOK_BOOLEAN_T:
+                    return OP_EQUAL_BOOL;
+                case TOK_STRING_T:
+                    return OP_EQUAL_STR;
+                default:
+                    break;
+            }
+
+        } break;
+
+        default:
+            break;
+    }
+
+    error_invalid_opcode((ErrorLocation){0}, op);
+}
+
 static void emit_expression(Emitter       *emitter,
                             FunctionDef   *current_fn,
                             AstExpression *expression);
 
-static void emit_statement(Emitter      *emitter,
-                           FunctionDef  *current_fn,
-                           AstStatement *statement) {
+/* Statements and expressions arrive fully resolved by the checker, so
+ * emission only reads the types and slots annotated on each node. An if or
+ * while emits its condition and leaves its block on the walk stack */
+void emit_statement(Emitter      *emitter,
+                    FunctionDef  *current_fn,
+                    AstStatement *statement) {
 
     switch (statement->tag) {
 
@@ -560,46 +570,15 @@ static void emit_statement(Emitter      *emitter,
 
             emit_expression(emitter, current_fn, statement->out.expression);
             emit_byte(emitter, OP_PRINT);
+            track_stack(emitter, current_fn, 1, 0);
 
         } break;
 
         case STM_ASSIGN: {
 
-            bool      is_local = false;
-            size_t    var_indx = 0;
-            TokenType var_type = get_variable_type(emitter,
-                                                   current_fn,
-                                                   statement->assign.var_name,
-                                                   &is_local,
-                                                   &var_indx);
-
-            if (var_type == TOK_UNKNOWN) {
-
-                ErrorLocation loc = {.line      = statement->line,
-                                     .col_start = statement->column_start,
-                                     .col_end   = statement->column_end};
-                error_undefined_var(loc, statement->assign.var_name);
-            }
-
-            TokenType expr_type =
-                    get_expression_type(emitter,
-                                        current_fn,
-                                        statement->assign.expression);
-
-            if (var_type != expr_type) {
-
-                ErrorLocation loc = {.line      = statement->line,
-                                     .col_start = statement->column_start,
-                                     .col_end   = statement->column_end};
-                error_type_mismatch(loc,
-                                    statement->assign.var_name,
-                                    token_type_to_string(var_type),
-                                    token_type_to_string(expr_type));
-            }
-
             emit_expression(emitter, current_fn, statement->assign.expression);
 
-            if (is_local) {
+            if (statement->assign.is_local) {
 
                 emit_byte(emitter, OP_SET_LOCAL);
 
@@ -608,57 +587,28 @@ static void emit_statement(Emitter      *emitter,
                 emit_byte(emitter, OP_SET_GLOBAL);
             }
 
-            emit_u16(emitter, var_indx);
+            emit_u16(emitter, statement->assign.slot);
+            track_stack(emitter, current_fn, 1, 0);
 
         } break;
 
         case STM_VAR_DECL: {
 
-            if (statement->var_decl.init_count > 0 &&
-                statement->var_decl.init_count !=
-                        statement->var_decl.var_count) {
-
-                ErrorLocation loc = {.line      = statement->line,
-                                     .col_start = statement->column_start,
-                                     .col_end   = statement->column_end};
-                error_wrong_var_init(loc,
-                                     statement->var_decl.var_count,
-                                     statement->var_decl.init_count);
-            }
-
+            // A name declared without an initialiser starts at its zero
             for (size_t i = 0; i < statement->var_decl.var_count; i++) {
 
-                size_t var_indx = add_local(current_fn,
-                                            statement->var_decl.var_names[i],
-                                            statement->var_decl.var_type);
-
-                if (i < statement->var_decl.init_count) {
-
-                    TokenType var_type = statement->var_decl.var_type;
-                    TokenType expr_type =
-                            get_expression_type(emitter,
-                                                current_fn,
-                                                statement->var_decl
-                                                        .init_exprs[i]);
-
-                    if (var_type != expr_type) {
-
-                        ErrorLocation loc = {.line = statement->line,
-                                             .col_start =
-                                                     statement->column_start,
-                                             .col_end = statement->column_end};
-                        error_type_mismatch(loc,
-                                            statement->var_decl.var_names[i],
-                                            token_type_to_string(var_type),
-                                            token_type_to_string(expr_type));
-                    }
-
+                if (i < statement->var_decl.init_count)
                     emit_expression(emitter,
                                     current_fn,
                                     statement->var_decl.init_exprs[i]);
-                    emit_byte(emitter, OP_SET_LOCAL);
-                    emit_u16(emitter, var_indx);
-                }
+                else
+                    emit_constant(emitter,
+                                  current_fn,
+                                  zero_value(statement->var_decl.var_type));
+
+                emit_byte(emitter, OP_SET_LOCAL);
+                emit_u16(emitter, statement->var_decl.first_slot + i);
+                track_stack(emitter, current_fn, 1, 0);
             }
 
         } break;
@@ -667,139 +617,63 @@ static void emit_statement(Emitter      *emitter,
 
             if (current_fn->return_type == TOK_VOID_T) {
 
-                if (statement->ret.expression) {
-
-                    ErrorLocation loc = {.line      = statement->line,
-                                         .col_start = statement->column_start,
-                                         .col_end   = statement->column_end};
-                    error_type_mismatch(loc, "return", "void", "non-void");
-                }
-
                 emit_byte(emitter, OP_RET);
-                current_fn->has_return = true;
                 break;
             }
 
-            if (!statement->ret.expression) {
-
-                ErrorLocation loc = {.line      = statement->line,
-                                     .col_start = statement->column_start,
-                                     .col_end   = statement->column_end};
-                error_expect_symbol(loc, "return value");
-            }
-
-            TokenType expr_type =
-                    get_expression_type(emitter,
-                                        current_fn,
-                                        statement->ret.expression);
-
-            if (expr_type != current_fn->return_type) {
-
-                ErrorLocation loc = {.line      = statement->line,
-                                     .col_start = statement->column_start,
-                                     .col_end   = statement->column_end};
-                error_type_mismatch(loc,
-                                    "return",
-                                    token_type_to_string(
-                                            current_fn->return_type),
-                                    token_type_to_string(expr_type));
-            }
-
             emit_expression(emitter, current_fn, statement->ret.expression);
             emit_byte(emitter, OP_RET);
-            current_fn->has_return = true;
+            track_stack(emitter, current_fn, 1, 0);
 
         } break;
 
         case STM_EXPR: {
 
-            TokenType expr_type =
-                    get_expression_type(emitter,
-                                        current_fn,
-                                        statement->expr.expression);
             emit_expression(emitter, current_fn, statement->expr.expression);
 
-            if (expr_type != TOK_VOID_T) {
+            if (statement->expr.expression->type != TOK_VOID_T) {
 
                 emit_byte(emitter, OP_POP);
+                track_stack(emitter, current_fn, 1, 0);
             }
 
         } break;
 
         case STM_IF: {
 
-            TokenType cond_type =
-                    get_expression_type(emitter,
-                                        current_fn,
-                                        statement->if_stmt.condition);
-
-            if (cond_type != TOK_BOOLEAN_T) {
-
-                ErrorLocation loc = {.line      = statement->line,
-                                     .col_start = statement->column_start,
-                                     .col_end   = statement->column_end};
-                error_type_mismatch(loc,
-                                    "condition",
-                                    "bool",
-                                    token_type_to_string(cond_type));
-            }
-
             emit_expression(emitter, current_fn, statement->if_stmt.condition);
             size_t jump_false = emit_jump(emitter, OP_JUMP_IF_FALSE);
+            track_stack(emitter, current_fn, 1, 0);
 
-            emit_block(emitter, current_fn, statement->if_stmt.then_block);
-
-            if (statement->if_stmt.else_block) {
-
-                size_t jump_end = emit_jump(emitter, OP_JUMP);
-                patch_jump(emitter, jump_false);
-                emit_block(emitter, current_fn, statement->if_stmt.else_block);
-                patch_jump(emitter, jump_end);
-
-            } else {
-
-                patch_jump(emitter, jump_false);
-            }
+            push_block_frame(emitter, statement->if_stmt.then_block, statement)
+                    ->jumps[0] = jump_false;
 
         } break;
 
         case STM_WHILE: {
 
-            size_t loop_start = emitter->code_len;
-
-            TokenType cond_type =
-                    get_expression_type(emitter,
-                                        current_fn,
-                                        statement->if_stmt.condition);
-
-            if (cond_type != TOK_BOOLEAN_T) {
-
-                ErrorLocation loc = {.line      = statement->line,
-                                     .col_start = statement->column_start,
-                                     .col_end   = statement->column_end};
-                error_type_mismatch(loc,
-                                    "condition",
-                                    "bool",
-                                    token_type_to_string(cond_type));
-            }
+            size_t loop_start = function_offset(emitter);
 
             emit_expression(emitter, current_fn, statement->if_stmt.condition);
             size_t exit_jump = emit_jump(emitter, OP_JUMP_IF_FALSE);
+            track_stack(emitter, current_fn, 1, 0);
 
-            emit_block(emitter, current_fn, statement->if_stmt.then_block);
-
-            emit_byte(emitter, OP_JUMP);
-            emit_u16(emitter, loop_start);
+            BlockFrame *frame = push_block_frame(emitter,
+                                                 statement->if_stmt.then_block,
+                                                 statement);
 
-            patch_jump(emitter, exit_jump);
+            frame->jumps[0] = loop_start;
+            frame->jumps[1] = exit_jump;
+            frame->loops    = true;
 
         } break;
     }
 }
 
-static void emit_expression(Emitter       *emitter,
-                            FunctionDef   *current_fn,
-                            AstExpression *expression) {
+/* Emit the instruction for one expression, its operands already pushed */
+static void emit_operation(Emitter       *emitter,
+                           FunctionDef   *current_fn,
+                           AstExpression *expression) {
 
     switch (expression->tag) {
 
@@ -808,14 +682,11 @@ static void emit_expression(Emitter       *emitter,
             Value value = {
 
                     .type   = VAL_STRING,
-                    .as.str = strdup(expression->str_lit.value)
+                    .as.str = expression->str_lit.value
 
             };
 
-            size_t indx = add_constant(emitter, value);
-
-            emit_byte(emitter, OP_PUSH_CONST);
-            emit_u16(emitter, indx);
+            emit_constant(emitter, current_fn, value);
 
         } break;
 
@@ -827,10 +698,7 @@ static void emit_expression(Emitter       *emitter,
 
             };
 
-            size_t indx = add_constant(emitter, value);
-
-            emit_byte(emitter, OP_PUSH_CONST);
-            emit_u16(emitter, indx);
+            emit_constant(emitter, current_fn, value);
 
         } break;
 
@@ -843,10 +711,7 @@ static void emit_expression(Emitter       *emitter,
 
             };
 
-            size_t indx = add_constant(emitter, value);
-
-            emit_byte(emitter, OP_PUSH_CONST);
-            emit_u16(emitter, indx);
+            emit_constant(emitter, current_fn, value);
 
         } break;
 
@@ -859,94 +724,35 @@ static void emit_expression(Emitter       *emitter,
 
             };
 
-            size_t indx = add_constant(emitter, value);
-
-            emit_byte(emitter, OP_PUSH_CONST);
-            emit_u16(emitter, indx);
+            emit_constant(emitter, current_fn, value);
 
         } break;
 
         case EXP_VARIABLE: {
 
-            bool      is_local = false;
-            size_t    var_indx = 0;
-            TokenType t        = get_variable_type(emitter,
-                                            current_fn,
-                                            expression->variable.name,
-                                            &is_local,
-                                            &var_indx);
-
-            if (t == TOK_UNKNOWN) {
-
-                ErrorLocation loc = {.line      = expression->line,
-                                     .col_start = expression->column_start,
-                                     .col_end   = expression->column_end};
-                error_undefined_var(loc, expression->variable.name);
-            }
-
-            emit_byte(emitter, is_local ? OP_GET_LOCAL : OP_GET_GLOBAL);
-            emit_u16(emitter, var_indx);
+            emit_byte(emitter,
+                      expression->is_local ? OP_GET_LOCAL : OP_GET_GLOBAL);
+            emit_u16(emitter, expression->slot);
+            track_stack(emitter, current_fn, 0, 1);
 
         } break;
 
         case EXP_CALL: {
 
-            FunctionDef *fn =
-                    find_function(emitter, expression->call.func_name);
-
-            if (!fn) {
-
-                ErrorLocation loc = {.line      = expression->line,
-                                     .col_start = expression->column_start,
-                                     .col_end   = expression->column_end};
-                error_unexpected_ident(loc, expression->call.func_name);
-            }
-
-            if (expression->call.arg_count != fn->param_count) {
-
-                ErrorLocation loc = {.line      = expression->line,
-                                     .col_start = expression->column_start,
-                                     .col_end   = expression->column_end};
-                error_wrong_var_init(loc,
-                                     fn->param_count,
-                                     expression->call.arg_count);
-            }
-
-            for (size_t i = 0; i < expression->call.arg_count; i++) {
-
-                TokenType arg_type =
-                        get_expression_type(emitter,
-                                            current_fn,
-                                            expression->call.args[i]);
-                TokenType param_type = fn->param_types[i];
-
-                if (arg_type != param_type) {
-
-                    ErrorLocation loc =
-                            {.line = expression->call.args[i]->line,
-                             .col_start =
-                                     expression->call.args[i]->column_start,
-                             .col_end = expression->call.args[i]->column_end};
-                    error_type_mismatch(loc,
-                                        fn->name,
-                                        token_type_to_string(param_type),
-                                        token_type_to_string(arg_type));
-                }
-
-                emit_expression(emitter, current_fn, expression->call.args[i]);
-            }
-
-            size_t fn_index = (size_t)(fn - emitter->functions);
+            FunctionDef *fn = &emitter->functions[expression->slot];
 
             emit_byte(emitter, OP_CALL);
-            emit_u16(emitter, fn_index);
+            emit_u16(emitter, expression->slot);
+            track_stack(emitter,
+                        current_fn,
+                        fn->param_count,
+                        fn->return_type != TOK_VOID_T ? 1 : 0);
+            add_callee(emitter, current_fn, expression->slot);
 
         } break;
 
         case EXP_UNARY: {
 
-            emit_expression(emitter, current_fn, expression->unary.expr);
-
             if (expression->unary.op == TOK_BANG ||
                 expression->unary.op == TOK_NOT) {
 
@@ -954,7 +760,11 @@ static void emit_expression(Emitter       *emitter,
 
             } else if (expression->unary.op == TOK_SUBTRACT) {
 
-                emit_byte(emitter, OP_NEG);
+                // Negation keeps the operand's type, so the result type picks
+                // the specialised opcode
+                emit_byte(emitter,
+                          expression->type == TOK_FLOAT_T ? OP_NEG_FLOAT
+                                                          : OP_NEG_INT);
 
             } else {
 
@@ -965,186 +775,391 @@ static void emit_expression(Emitter       *emitter,
 
         case EXP_BINARY: {
 
-            emit_expression(emitter, current_fn, expression->binary.left);
-            emit_expression(emitter, current_fn, expression->binary.right);
+            // Both operands are proven to share a type, which lets the VM
+            // run a handler with no tag checks
+            emit_byte(emitter,
+                      binary_opcode(expression->binary.op,
+                                    expression->binary.left->type));
+            track_stack(emitter, current_fn, 2, 1);
 
-            switch (expression->binary.op) {
+        } break;
+    }
+}
 
-                case TOK_ADD:
-                    emit_byte(emitter, OP_ADD);
-                    break;
-                case TOK_SUBTRACT:
-                    emit_byte(emitter, OP_SUB);
-                    break;
-                case TOK_MULTIPLY:
-                    emit_byte(emitter, OP_MUL);
-                    break;
-                case TOK_DIVIDE:
-                    emit_byte(emitter, OP_DIV);
-                    break;
-                case TOK_AND:
-                    emit_byte(emitter, OP_AND);
-                    break;
-                case TOK_OR:
-                    emit_byte(emitter, OP_OR);
-                    break;
-                case TOK_EQUAL_EQUAL:
-                    emit_byte(emitter, OP_EQUAL);
-                    break;
-                case TOK_LESS:
-                    emit_byte(emitter, OP_LESS);
-                    break;
-                case TOK_GREATER:
-                    emit_byte(emitter, OP_GREATER);
-                    break;
-                case TOK_LESS_EQUAL:
-                    emit_byte(emitter, OP_LESS_EQUAL);
-                    break;
-                case TOK_GREATER_EQUAL:
-                    emit_byte(emitter, OP_GREATER_EQUAL);
-                    break;
-                default:
-                    error_invalid_opcode((ErrorLocation){0},
-                                         expression->binary.op);
-            }
+/* Emit an expression operands first, walking it on the emitter's stack */
+static void emit_expression(Emitter       *emitter,
+                            FunctionDef   *current_fn,
+                            AstExpression *expression) {
 
-        } break;
+    size_t base = emitter->expr_count;
+
+    push_expr_frame(emitter, expression);
+
+    while (emitter->expr_count > base) {
+
+        ExprFrame     *frame   = &emitter->expr_stack[emitter->expr_count - 1];
+        AstExpression *operand = expression_operand(frame->expression,
+                                                    frame->next);
+
+        if (operand) {
+
+            frame->next++;
+            push_expr_frame(emitter, operand);
+            continue;
+        }
+
+        emitter->expr_count--;
+        emit_operation(emitter, current_fn, frame->expression);
     }
 }
 
-static void
-emit_block(Emitter *emitter, FunctionDef *current_fn, AstBlock *block) {
+/* Jump from the end of a then block over the else block starting here,
+ * returning the jump to patch once that ends */
+static size_t jump_over_else(Emitter *emitter, const BlockFrame *done) {
+
+    size_t jump_end = emit_jump(emitter, OP_JUMP);
+    patch_jump(emitter, done->jumps[0]);
+
+    return jump_end;
+}
+
+/* Finish an if or while whose last block has ended: jump back to a loop's
+ * condition, and send the jump past the block here. Only the frame is read,
+ * in one pass the statement is gone by now */
+static void end_branch(Emitter *emitter, const BlockFrame *done) {
+
+    if (done->loops) {
+
+        emit_byte(emitter, OP_JUMP);
+        emit_u16(emitter, done->jumps[0]);
+
+        patch_jump(emitter, done->jumps[1]);
+        return;
+    }
+
+    patch_jump(emitter, done->jumps[0]);
+}
+
+/* Emit what follows the end of an if or while block: the jump back to the
+ * condition, or the jump over an else block that is then walked next */
+static void close_block(Emitter *emitter, const BlockFrame *done) {
+
+    AstStatement *owner = done->owner;
+
+    if (done->block == owner->if_stmt.then_block &&
+        owner->if_stmt.else_block) {
+
+        size_t jump_end = jump_over_else(emitter, done);
+
+        push_block_frame(emitter, owner->if_stmt.else_block, owner)->jumps[0] =
+                jump_end;
+        return;
+    }
+
+    end_branch(emitter, done);
+}
+
+/* The else of the if on top of the walk stack starts, when emitting in one
+ * pass with no blocks to walk */
+void emit_else(Emitter *emitter) {
+
+    BlockFrame *frame = &emitter->block_stack[emitter->block_count - 1];
+
+    frame->jumps[0] = jump_over_else(emitter, frame);
+}
 
-    for (size_t i = 0; i < block->len; i++)
-        emit_statement(emitter, current_fn, block->statements[i]);
+/* The if or while on top of the walk stack ends, when emitting in one pass */
+void emit_branch_end(Emitter *emitter) {
+
+    end_branch(emitter, &emitter->block_stack[--emitter->block_count]);
 }
 
 static void
-emit_function(Emitter *emitter, FunctionDef *fn, AstDeclaration *declare) {
+emit_block(Emitter *emitter, FunctionDef *current_fn, AstBlock *block) {
+
+    size_t base = emitter->block_count;
+
+    push_block_frame(emitter, block, NULL);
+
+    while (emitter->block_count > base) {
+
+        BlockFrame *frame = &emitter->block_stack[emitter->block_count - 1];
+
+        if (frame->next < frame->block->len) {
 
-    fn->start_ip   = emitter->code_len;
-    fn->has_return = false;
+            AstStatement *statement = frame->block->statements[frame->next++];
+            emit_statement(emitter, current_fn, statement);
+            continue;
+        }
+
+        BlockFrame done = *frame;
+        emitter->block_count--;
 
-    // The parameters become locals first
-    for (size_t i = 0; i < declare->func.param_count; i++)
-        add_local(fn,
-                  declare->func.params[i].name,
-                  declare->func.params[i].type);
+        if (done.owner)
+            close_block(emitter, &done);
+    }
+}
 
-    emit_block(emitter, fn, declare->func.body);
+/* Close the body of fn, entry halting and every other function returning
+ * or trapping */
+void emit_body_end(Emitter *emitter, FunctionDef *fn) {
+
+    if (fn == &emitter->entry) {
+
+        emit_byte(emitter, OP_HALT);
+        return;
+    }
 
     if (fn->return_type == TOK_VOID_T && !fn->has_return)
         emit_byte(emitter, OP_RET);
 
-    if (fn->return_type != TOK_VOID_T && !fn->has_return) {
+    // A return nested in a branch doesn't cover every path, so non-void
+    // functions end in a trap rather than falling into the next function
+    if (fn->return_type != TOK_VOID_T)
+        emit_byte(emitter, OP_NO_RETURN);
+}
+
+/* Start the code of fn where the emitter is */
+void begin_body(Emitter *emitter, FunctionDef *fn) {
+
+    fn->start_ip         = emitter->code_len;
+    emitter->fn_start    = emitter->code_len;
+    emitter->stack_depth = 0;
+}
+
+/* Emit the whole body of entry or a function */
+void emit_body(Emitter *emitter, FunctionDef *fn, AstBlock *body) {
+
+    begin_body(emitter, fn);
+    emit_block(emitter, fn, body);
+    emit_body_end(emitter, fn);
+}
+
+/* Copy a function emitted apart into the program's code after everything
+ * so far, moving its constants into the program's pool. map turns the
+ * part's constant indices into the program's, plus one, and starts zeroed.
+ * Jumps are counted from the function's start and move with it as they
+ * are */
+void link_function(Emitter        *emitter,
+                   FunctionDef    *fn,
+                   const Emitter  *part,
+                   const CodeSpan *span,
+                   size_t         *map) {
+
+    size_t len  = span->code_end - span->code_start;
+    size_t base = emitter->code_len;
+
+    if (emitter->code_len + len > emitter->code_cap) {
 
-        ErrorLocation loc = {.line      = declare->line,
-                             .col_start = declare->column_start,
-                             .col_end   = declare->column_end};
-        error_missing_return(loc, fn->name);
+        size_t new_cap = emitter->code_cap ? emitter->code_cap : 64;
+        while (new_cap < emitter->code_len + len)
+            new_cap *= 2;
+
+        void *temp_ptr = realloc(emitter->code, new_cap);
+        if (!temp_ptr) {
+            free(emitter->code);
+            error_oom();
+        }
+
+        emitter->code     = temp_ptr;
+        emitter->code_cap = new_cap;
+    }
+
+    memcpy(emitter->code + base, part->code + span->code_start, len);
+    emitter->code_len += len;
+    fn->start_ip       = base;
+
+    for (size_t i = span->fixup_start; i < span->fixup_end; i++) {
+
+        size_t   pos   = base + (part->fixups[i] - span->code_start);
+        uint16_t local = (uint16_t)((emitter->code[pos] << 8) |
+                                    emitter->code[pos + 1]);
+
+        // Every use counts, as it would emitted in place
+        if (map[local]) {
+
+            emitter->const_dupes++;
+
+        } else {
+
+            map[local] = add_constant(emitter, part->constants[local]) + 1;
+        }
+
+        size_t indx = map[local] - 1;
+        if (indx > UINT16_MAX)
+            error_complexity();
+
+        emitter->code[pos]     = (indx >> 8) & 0xFF;
+        emitter->code[pos + 1] = indx & 0xFF;
     }
 }
 
-static void emit_declaration(Emitter        *emitter,
-                             AstDeclaration *declare,
-                             bool           *entry_exists) {
+typedef enum {
 
-    switch (declare->tag) {
+    BOUND_UNVISITED,
+    BOUND_IN_PROGRESS,
+    BOUND_KNOWN,
+    BOUND_UNKNOWN
 
-        case DEC_ENTRY: {
+} BoundState;
 
-            if (*entry_exists) {
+/* A function on the call path being bounded, with the deepest need found
+ * among the callees it has visited so far */
+typedef struct {
 
-                ErrorLocation loc = {.line      = declare->line,
-                                     .col_start = declare->column_start,
-                                     .col_end   = declare->column_end};
-                error_multiple_entry(loc);
-            }
+    size_t indx;
+    size_t next;
+    size_t deepest_stack;
+    size_t deepest_frames;
 
-            emitter->entry.start_ip   = emitter->code_len;
-            emitter->entry.has_return = false;
-            emit_block(emitter, &emitter->entry, declare->entry.block);
-            emit_byte(emitter, OP_HALT);
-            *entry_exists = true;
+} BoundFrame;
 
-        } break;
+/* Worst-case stack slots and frames from a call to function indx onwards,
+ * false when the calls it makes can recurse. The call graph is walked depth
+ * first on path, which has room for every function. A frame's window is its
+ * locals plus its operand high-water mark, which overestimates slightly
+ * since the callee's window overlaps the arguments */
+static bool bound_function(Emitter    *emitter,
+                           size_t      indx,
+                           BoundState *state,
+                           size_t     *stack,
+                           size_t     *frames,
+                           BoundFrame *path) {
 
-        case DEC_VAR: {
+    if (state[indx] == BOUND_KNOWN)
+        return true;
+    if (state[indx] != BOUND_UNVISITED)
+        return false;
 
-            // Global vars are already registered in the first pass, so we do
-            // nothing
+    size_t depth = 0;
 
-        } break;
+    path[depth++] = (BoundFrame){.indx = indx};
+    state[indx]   = BOUND_IN_PROGRESS;
+
+    while (depth > 0) {
 
-        case DEC_FUNC: {
+        BoundFrame  *frame = &path[depth - 1];
+        FunctionDef *fn    = &emitter->functions[frame->indx];
 
-            FunctionDef *fn = find_function(emitter, declare->func.name);
+        if (frame->next < fn->callee_count) {
 
-            if (!fn) {
+            size_t callee = fn->callees[frame->next];
 
-                ErrorLocation loc = {.line      = declare->line,
-                                     .col_start = declare->column_start,
-                                     .col_end   = declare->column_end};
-                error_invalid_token(loc);
+            // The callee is bounded first, then visited again once known
+            if (state[callee] == BOUND_UNVISITED) {
+
+                path[depth++] = (BoundFrame){.indx = callee};
+                state[callee] = BOUND_IN_PROGRESS;
+                continue;
             }
 
-            emit_function(emitter, fn, declare);
+            if (state[callee] != BOUND_KNOWN) {
 
-        } break;
+                while (depth > 0)
+                    state[path[--depth].indx] = BOUND_UNKNOWN;
+
+                return false;
+            }
+
+            if (stack[callee] > frame->deepest_stack)
+                frame->deepest_stack = stack[callee];
+            if (frames[callee] > frame->deepest_frames)
+                frame->deepest_frames = frames[callee];
+
+            frame->next++;
+            continue;
+        }
+
+        stack[frame->indx] =
+                fn->local_count + fn->max_stack + frame->deepest_stack;
+        frames[frame->indx] = 1 + frame->deepest_frames;
+        state[frame->indx]  = BOUND_KNOWN;
+
+        depth--;
     }
+
+    return true;
 }
 
-void emit_program(Emitter *emitter, AstProgram *program) {
+/* Walk the call graph from entry to size the VM stack and frame array up
+ * front. Recursion leaves both at 0 and the VM grows them at calls instead */
+void bound_program(Emitter *emitter) {
 
-    init_emitter(emitter);
+    size_t      count  = emitter->func_count;
+    BoundState *state  = calloc(count, sizeof(BoundState));
+    size_t     *stack  = calloc(count, sizeof(size_t));
+    size_t     *frames = calloc(count, sizeof(size_t));
+    BoundFrame *path   = calloc(count, sizeof(BoundFrame));
 
-    // First pass where we register functions and global vars
-    for (size_t i = 0; i < program->len; i++) {
+    if (count && (!state || !stack || !frames || !path))
+        error_oom();
 
-        AstDeclaration *decl = program->declarations[i];
+    FunctionDef *entry          = &emitter->entry;
+    size_t       deepest_stack  = 0;
+    size_t       deepest_frames = 0;
+    bool         bounded        = true;
 
-        if (decl->tag == DEC_FUNC) {
+    for (size_t i = 0; bounded && i < entry->callee_count; i++) {
 
-            register_function(emitter,
-                              decl->func.name,
-                              decl->func.return_type,
-                              decl->func.params,
-                              decl->func.param_count);
+        size_t callee = entry->callees[i];
 
-        } else if (decl->tag == DEC_VAR) {
+        bounded = bound_function(emitter, callee, state, stack, frames, path);
 
-            for (size_t v = 0; v < decl->var_decl.var_count; v++)
-                add_global(emitter,
-                           decl->var_decl.var_names[v],
-                           decl->var_decl.var_type);
-        }
+        if (bounded && stack[callee] > deepest_stack)
+            deepest_stack = stack[callee];
+        if (bounded && frames[callee] > deepest_frames)
+            deepest_frames = frames[callee];
     }
 
-    bool entry_exists = false;
+    if (bounded) {
+
+        emitter->stack_size =
+                entry->local_count + entry->max_stack + deepest_stack;
+        emitter->frame_depth = 1 + deepest_frames;
+    }
+
+    free(state);
+    free(stack);
+    free(frames);
+    free(path);
+}
+
+/* Emit a program the checker has already accepted. Entry goes first so
+ * that it starts at IP 0, then functions in declaration order, which is
+ * also the order the checker registered them in */
+void emit_program(Emitter *emitter, AstProgram *program) {
 
-    // Emit entry first so that it starts at IP 0
     for (size_t i = 0; i < program->len; i++) {
 
-        if (program->declarations[i]->tag == DEC_ENTRY) {
+        AstDeclaration *decl = program->declarations[i];
 
-            emit_declaration(emitter, program->declarations[i], &entry_exists);
-        }
+        if (decl->tag == DEC_ENTRY)
+            emit_body(emitter, &emitter->entry, decl->entry.block);
     }
 
-    // We emit functions and globals
+    size_t fn_indx = 0;
+
+    // Global vars need no code, their slots were assigned by the checker
     for (size_t i = 0; i < program->len; i++) {
 
-        if (program->declarations[i]->tag == DEC_FUNC ||
-            program->declarations[i]->tag == DEC_VAR) {
+        AstDeclaration *decl = program->declarations[i];
 
-            emit_declaration(emitter, program->declarations[i], &entry_exists);
-        }
+        if (decl->tag != DEC_FUNC)
+            continue;
+
+        FunctionDef *fn = &emitter->functions[fn_indx++];
+
+        // A lazily parsed function nothing calls gets no code
+        if (fn->compiled)
+            emit_body(emitter, fn, decl->func.body);
     }
 
-    if (!entry_exists)
-        error_no_entry();
+    bound_program(emitter);
 }
 
+static void reserve_stack(VM *vm, size_t needed);
+static void push_locals(VM *vm, size_t count);
+
 void init_vm(VM          *vm,
              Value       *constants,
              size_t       const_count,
@@ -1153,7 +1168,10 @@ void init_vm(VM          *vm,
              FunctionDef *functions,
              size_t       func_count,
              FunctionDef  entry_fn,
-             size_t       global_count) {
+             TokenType   *global_types,
+             size_t       global_count,
+             size_t       stack_size,
+             size_t       frame_depth) {
 
     vm->stack       = NULL;
     vm->stack_count = 0;
@@ -1165,11 +1183,19 @@ void init_vm(VM          *vm,
     vm->code     = code;
     vm->code_len = code_len;
 
-    vm->pos = 0;
+    // Entry comes first unless the program was emitted in one pass
+    vm->pos = entry_fn.start_ip;
 
-    vm->globals      = calloc(global_count, sizeof(Value));
+    vm->globals      = malloc(global_count * sizeof(Value));
     vm->global_count = global_count;
 
+    if (global_count && !vm->globals)
+        error_oom();
+
+    // Globals have no initialisers, so each starts at its type's zero
+    for (size_t i = 0; i < global_count; i++)
+        vm->globals[i] = zero_value(global_types[i]);
+
     vm->functions  = functions;
     vm->func_count = func_count;
     vm->entry_fn   = entry_fn;
@@ -1178,17 +1204,18 @@ void init_vm(VM          *vm,
     vm->frame_count = 0;
     vm->frame_cap   = 0;
 
-    // Seed the entry frame locals
+    // Seed the entry frame locals at the bottom of the stack
     CallFrame entry_frame = {.fn        = &vm->entry_fn,
-                             .locals    = calloc(entry_fn.local_count,
-                                              sizeof(Value)),
+                             .base      = 0,
                              .return_ip = vm->code_len};
 
-    if (entry_fn.local_count && !entry_frame.locals)
-        error_oom();
-    zero_locals(entry_frame.locals, entry_fn.local_count);
+    // With a static bound this is the only allocation the stack ever sees
+    reserve_stack(vm,
+                  stack_size ? stack_size
+                             : entry_fn.local_count + entry_fn.max_stack);
+    push_locals(vm, entry_fn.local_count);
 
-    vm->frame_cap = 4;
+    vm->frame_cap = frame_depth ? frame_depth : 4;
     vm->frames    = malloc(vm->frame_cap * sizeof(CallFrame));
     if (!vm->frames)
         error_oom();
@@ -1199,46 +1226,62 @@ void init_vm(VM          *vm,
 void free_vm(VM *vm) {
 
     free(vm->stack);
-
-    for (size_t i = 0; i < vm->frame_count; i++)
-        free(vm->frames[i].locals);
-
     free(vm->frames);
     free(vm->globals);
 }
 
-static void push(VM *vm, Value value) {
+/* Grow the stack to hold at least needed values. Every frame's window is
+ * reserved before it runs, so push() itself never has to check */
+static void reserve_stack(VM *vm, size_t needed) {
 
-    if (vm->stack_count + 1 > vm->stack_cap) {
+    if (needed <= vm->stack_cap)
+        return;
 
-        size_t new_cap  = vm->stack_cap ? vm->stack_cap * 2 : 8;
-        void  *temp_ptr = realloc(vm->stack, new_cap * sizeof(Value));
-        if (!temp_ptr) {
-            free(vm->stack);
-            error_oom();
-        }
+    size_t new_cap = vm->stack_cap * 2;
+    if (new_cap < needed)
+        new_cap = needed;
 
-        vm->stack     = temp_ptr;
-        vm->stack_cap = new_cap;
+    void *temp_ptr = realloc(vm->stack, new_cap * sizeof(Value));
+    if (!temp_ptr) {
+        free(vm->stack);
+        error_oom();
     }
 
+    vm->stack     = temp_ptr;
+    vm->stack_cap = new_cap;
+}
+
+static void push(VM *vm, Value value) {
+
     vm->stack[vm->stack_count++] = value;
 }
 
+/* Reserve count void slots on the stack for a frame's locals */
+static void push_locals(VM *vm, size_t count) {
+
+    for (size_t i = 0; i < count; i++)
+        push(vm, (Value){.type = VAL_VOID});
+}
+
 static Value pop(VM *vm) {
 
     return vm->stack[--vm->stack_count];
 }
 
-static uint8_t read_byte(VM *vm) {
+static Value *top(VM *vm) {
+
+    return &vm->stack[vm->stack_count - 1];
+}
+
+static uint8_t read_byte(const uint8_t **ip) {
 
-    return vm->code[vm->pos++];
+    return *(*ip)++;
 }
 
-static uint16_t read_u16(VM *vm) {
+static uint16_t read_u16(const uint8_t **ip) {
 
-    uint16_t high = read_byte(vm);
-    uint16_t low  = read_byte(vm);
+    uint16_t high = read_byte(ip);
+    uint16_t low  = read_byte(ip);
 
     return (high << 8) | low;
 }
@@ -1252,28 +1295,80 @@ static CallFrame *current_frame(VM *vm) {
 
 void interpret(VM *vm) {
 
-    for (;;) {
-
-        if (vm->pos >= vm->code_len)
-            error_vm_oob((ErrorLocation){0});
-
-        Opcode operation = (Opcode)read_byte(vm);
+#if COMPUTED_GOTO
+    // Every byte has an entry, so one that isn't an opcode reaches the trap
+    // under default instead of a label past the end of the table. The real
+    // opcodes then override their own entries
+#    pragma GCC diagnostic push
+#    pragma GCC diagnostic ignored "-Woverride-init"
+    static void *dispatch_table[256] = {
+
+            [0 ... 255]              = &&do_invalid,
+            [OP_PUSH_CONST]          = &&do_OP_PUSH_CONST,
+            [OP_PRINT]               = &&do_OP_PRINT,
+            [OP_SET_GLOBAL]          = &&do_OP_SET_GLOBAL,
+            [OP_GET_GLOBAL]          = &&do_OP_GET_GLOBAL,
+            [OP_SET_LOCAL]           = &&do_OP_SET_LOCAL,
+            [OP_GET_LOCAL]           = &&do_OP_GET_LOCAL,
+            [OP_CALL]                = &&do_OP_CALL,
+            [OP_RET]                 = &&do_OP_RET,
+            [OP_JUMP]                = &&do_OP_JUMP,
+            [OP_JUMP_IF_FALSE]       = &&do_OP_JUMP_IF_FALSE,
+            [OP_NOT]                 = &&do_OP_NOT,
+            [OP_AND]                 = &&do_OP_AND,
+            [OP_OR]                  = &&do_OP_OR,
+            [OP_EQUAL_INT]           = &&do_OP_EQUAL_INT,
+            [OP_EQUAL_FLOAT]         = &&do_OP_EQUAL_FLOAT,
+            [OP_EQUAL_BOOL]          = &&do_OP_EQUAL_BOOL,
+            [OP_EQUAL_STR]           = &&do_OP_EQUAL_STR,
+            [OP_LESS_INT]            = &&do_OP_LESS_INT,
+            [OP_LESS_FLOAT]          = &&do_OP_LESS_FLOAT,
+            [OP_GREATER_INT]         = &&do_OP_GREATER_INT,
+            [OP_GREATER_FLOAT]       = &&do_OP_GREATER_FLOAT,
+            [OP_LESS_EQUAL_INT]      = &&do_OP_LESS_EQUAL_INT,
+            [OP_LESS_EQUAL_FLOAT]    = &&do_OP_LESS_EQUAL_FLOAT,
+            [OP_GREATER_EQUAL_INT]   = &&do_OP_GREATER_EQUAL_INT,
+            [OP_GREATER_EQUAL_FLOAT] = &&do_OP_GREATER_EQUAL_FLOAT,
+            [OP_NEG_INT]             = &&do_OP_NEG_INT,
+            [OP_NEG_FLOAT]           = &&do_OP_NEG_FLOAT,
+            [OP_ADD_INT]             = &&do_OP_ADD_INT,
+            [OP_ADD_FLOAT]           = &&do_OP_ADD_FLOAT,
+            [OP_SUB_INT]             = &&do_OP_SUB_INT,
+            [OP_SUB_FLOAT]           = &&do_OP_SUB_FLOAT,
+            [OP_MUL_INT]             = &&do_OP_MUL_INT,
+            [OP_MUL_FLOAT]           = &&do_OP_MUL_FLOAT,
+            [OP_DIV_INT]             = &&do_OP_DIV_INT,
+            [OP_DIV_FLOAT]           = &&do_OP_DIV_FLOAT,
+            [OP_POP]                 = &&do_OP_POP,
+            [OP_HALT]                = &&do_OP_HALT,
+            [OP_NO_RETURN]           = &&do_OP_NO_RETURN
+
+    };
+#    pragma GCC diagnostic pop
+#endif
+
+    // verify_program() has already proven every jump target, operand index
+    // and stack effect, so the handlers below run without bounds or index
+    // checks. The instruction pointer lives in a local so it stays in a
+    // register across handlers, and so does the start of the running
+    // function, which jump targets are counted from
+    const uint8_t *ip    = vm->code + vm->pos;
+    CallFrame     *frame = current_frame(vm);
+    const uint8_t *body  = vm->code + frame->fn->start_ip;
 
-        switch (operation) {
+    for (;;) {
 
-            case OP_PUSH_CONST: {
+        switch ((Opcode)read_byte(&ip)) {
 
-                uint16_t indx = read_u16(vm);
+            VM_CASE(OP_PUSH_CONST): {
 
-                if (indx >= vm->const_count)
-                    error_invalid_const_index((ErrorLocation){0},
-                                              vm->const_count);
+                uint16_t indx = read_u16(&ip);
 
                 push(vm, vm->constants[indx]);
 
-            } break;
+            } VM_NEXT();
 
-            case OP_PRINT: {
+            VM_CASE(OP_PRINT): {
 
                 Value value = pop(vm);
 
@@ -1298,77 +1393,51 @@ void interpret(VM *vm) {
                     printf("void\n");
                 }
 
-            } break;
-
-            case OP_SET_GLOBAL: {
+            } VM_NEXT();
 
-                uint16_t var_indx = read_u16(vm);
+            VM_CASE(OP_SET_GLOBAL): {
 
-                if (var_indx >= vm->global_count)
-                    error_invalid_var_index((ErrorLocation){0},
-                                            vm->global_count);
+                uint16_t var_indx = read_u16(&ip);
 
                 vm->globals[var_indx] = pop(vm);
 
-            } break;
-
-            case OP_GET_GLOBAL: {
+            } VM_NEXT();
 
-                uint16_t var_indx = read_u16(vm);
+            VM_CASE(OP_GET_GLOBAL): {
 
-                if (var_indx >= vm->global_count)
-                    error_invalid_var_index((ErrorLocation){0},
-                                            vm->global_count);
+                uint16_t var_indx = read_u16(&ip);
 
                 push(vm, vm->globals[var_indx]);
 
-            } break;
-
-            case OP_SET_LOCAL: {
-
-                uint16_t   var_indx = read_u16(vm);
-                CallFrame *frame    = current_frame(vm);
-
-                if (!frame || var_indx >= frame->fn->local_count)
-                    error_invalid_var_index((ErrorLocation){0},
-                                            frame ? frame->fn->local_count : 0);
+            } VM_NEXT();
 
-                frame->locals[var_indx] = pop(vm);
+            VM_CASE(OP_SET_LOCAL): {
 
-            } break;
+                uint16_t var_indx = read_u16(&ip);
 
-            case OP_GET_LOCAL: {
+                vm->stack[frame->base + var_indx] = pop(vm);
 
-                uint16_t   var_indx = read_u16(vm);
-                CallFrame *frame    = current_frame(vm);
+            } VM_NEXT();
 
-                if (!frame || var_indx >= frame->fn->local_count)
-                    error_invalid_var_index((ErrorLocation){0},
-                                            frame ? frame->fn->local_count : 0);
+            VM_CASE(OP_GET_LOCAL): {
 
-                push(vm, frame->locals[var_indx]);
+                uint16_t var_indx = read_u16(&ip);
 
-            } break;
+                push(vm, vm->stack[frame->base + var_indx]);
 
-            case OP_CALL: {
+            } VM_NEXT();
 
-                uint16_t fn_indx = read_u16(vm);
+            VM_CASE(OP_CALL): {
 
-                if (fn_indx >= vm->func_count)
-                    error_invalid_opcode((ErrorLocation){0}, fn_indx);
+                uint16_t     fn_indx = read_u16(&ip);
+                FunctionDef *fn      = &vm->functions[fn_indx];
 
-                FunctionDef *fn = &vm->functions[fn_indx];
+                // The arguments are already in place as the first locals
+                size_t base = vm->stack_count - fn->param_count;
 
-                Value *locals = calloc(fn->local_count, sizeof(Value));
-
-                if (fn->local_count && !locals)
-                    error_oom();
-                zero_locals(locals, fn->local_count);
-
-                for (size_t i = 0; i < fn->param_count; i++) {
-
-                    locals[fn->param_count - 1 - i] = pop(vm);
-                }
+                // Only reallocates when recursion left the stack unbounded
+                reserve_stack(vm, base + fn->local_count + fn->max_stack);
+                push_locals(vm, fn->local_count - fn->param_count);
 
                 if (vm->frame_count + 1 > vm->frame_cap) {
 
@@ -1386,325 +1455,329 @@ void interpret(VM *vm) {
 
                 vm->frames[vm->frame_count++] =
                         (CallFrame){.fn        = fn,
-                                    .locals    = locals,
-                                    .return_ip = vm->pos};
+                                    .base      = base,
+                                    .return_ip = (size_t)(ip - vm->code)};
 
-                vm->pos = fn->start_ip;
+                frame = current_frame(vm);
+                body  = vm->code + fn->start_ip;
+                ip    = body;
 
-            } break;
+            } VM_NEXT();
 
-            case OP_RET: {
+            VM_CASE(OP_RET): {
 
-                CallFrame *frame = current_frame(vm);
+                bool  returns_value = frame->fn->return_type != TOK_VOID_T;
+                Value ret           = {.type = VAL_VOID};
 
-                if (!frame)
-                    error_invalid_opcode((ErrorLocation){0}, operation);
-
-                Value ret = {.type = VAL_VOID};
-
-                if (frame->fn->return_type != TOK_VOID_T)
+                if (returns_value)
                     ret = pop(vm);
 
-                free(frame->locals);
+                // Dropping the window releases the locals and arguments
+                vm->stack_count = frame->base;
                 vm->frame_count--;
 
-                if (vm->frame_count == 0)
+                if (vm->frame_count == 0) {
+
+                    vm->pos = (size_t)(ip - vm->code);
                     return;
+                }
 
-                vm->pos = frame->return_ip;
+                ip    = vm->code + frame->return_ip;
+                frame = current_frame(vm);
+                body  = vm->code + frame->fn->start_ip;
 
-                if (frame->fn->return_type != TOK_VOID_T)
+                if (returns_value)
                     push(vm, ret);
 
-            } break;
+            } VM_NEXT();
 
-            case OP_POP: {
+            VM_CASE(OP_POP): {
 
                 pop(vm);
 
-            } break;
+            } VM_NEXT();
 
-            case OP_JUMP: {
+            VM_CASE(OP_JUMP): {
 
-                uint16_t target = read_u16(vm);
-                vm->pos         = target;
+                uint16_t target = read_u16(&ip);
+                ip              = body + target;
 
-            } break;
+            } VM_NEXT();
 
-            case OP_JUMP_IF_FALSE: {
+            VM_CASE(OP_JUMP_IF_FALSE): {
 
-                uint16_t target = read_u16(vm);
+                uint16_t target = read_u16(&ip);
                 Value    cond   = pop(vm);
 
-                if (cond.type == VAL_BOOLEAN && !cond.as.boolean) {
+                if (!cond.as.boolean)
+                    ip = body + target;
 
-                    vm->pos = target;
-                }
+            } VM_NEXT();
 
-            } break;
+            VM_CASE(OP_NOT): {
 
-            case OP_NOT: {
+                Value *v = top(vm);
 
-                Value v = pop(vm);
+                v->as.boolean = !v->as.boolean;
+                v->type       = VAL_BOOLEAN;
 
-                if (v.type != VAL_BOOLEAN)
-                    error_invalid_opcode((ErrorLocation){0}, OP_NOT);
+            } VM_NEXT();
 
-                push(vm,
-                     (Value){.type = VAL_BOOLEAN, .as.boolean = !v.as.boolean});
+            VM_CASE(OP_AND): {
 
-            } break;
+                Value  b = pop(vm);
+                Value *a = top(vm);
 
-            case OP_AND: {
+                a->as.boolean = a->as.boolean && b.as.boolean;
+                a->type       = VAL_BOOLEAN;
 
-                Value b = pop(vm);
-                Value a = pop(vm);
+            } VM_NEXT();
 
-                if (a.type != VAL_BOOLEAN || b.type != VAL_BOOLEAN)
-                    error_invalid_opcode((ErrorLocation){0}, OP_AND);
+            VM_CASE(OP_OR): {
 
-                push(vm,
-                     (Value){.type       = VAL_BOOLEAN,
-                             .as.boolean = a.as.boolean && b.as.boolean});
+                Value  b = pop(vm);
+                Value *a = top(vm);
 
-            } break;
+                a->as.boolean = a->as.boolean || b.as.boolean;
+                a->type       = VAL_BOOLEAN;
 
-            case OP_OR: {
+            } VM_NEXT();
 
-                Value b = pop(vm);
-                Value a = pop(vm);
+            VM_CASE(OP_EQUAL_INT): {
 
-                if (a.type != VAL_BOOLEAN || b.type != VAL_BOOLEAN)
-                    error_invalid_opcode((ErrorLocation){0}, OP_OR);
+                Value  b = pop(vm);
+                Value *a = top(vm);
 
-                push(vm,
-                     (Value){.type       = VAL_BOOLEAN,
-                             .as.boolean = a.as.boolean || b.as.boolean});
+                a->as.boolean = a->as.integer == b.as.integer;
+                a->type       = VAL_BOOLEAN;
 
-            } break;
+            } VM_NEXT();
 
-            case OP_EQUAL: {
+            VM_CASE(OP_EQUAL_FLOAT): {
 
-                Value b      = pop(vm);
-                Value a      = pop(vm);
-                bool  result = false;
+                Value  b = pop(vm);
+                Value *a = top(vm);
 
-                if (a.type == b.type) {
+                a->as.boolean = a->as.floating == b.as.floating;
+                a->type       = VAL_BOOLEAN;
 
-                    if (a.type == VAL_INTEGER)
-                        result = a.as.integer == b.as.integer;
-                    else if (a.type == VAL_FLOAT)
-                        result = a.as.floating == b.as.floating;
-                    else if (a.type == VAL_BOOLEAN)
-                        result = a.as.boolean == b.as.boolean;
-                    else if (a.type == VAL_STRING)
-                        result = strcmp(a.as.str, b.as.str) == 0;
+            } VM_NEXT();
 
-                } else {
+            VM_CASE(OP_EQUAL_BOOL): {
 
-                    error_invalid_opcode((ErrorLocation){0}, OP_EQUAL);
-                }
+                Value  b = pop(vm);
+                Value *a = top(vm);
 
-                push(vm, (Value){.type = VAL_BOOLEAN, .as.boolean = result});
+                a->as.boolean = a->as.boolean == b.as.boolean;
+                a->type       = VAL_BOOLEAN;
 
-            } break;
+            } VM_NEXT();
 
-            case OP_LESS: {
+            VM_CASE(OP_EQUAL_STR): {
 
-                Value b = pop(vm);
-                Value a = pop(vm);
+                Value  b = pop(vm);
+                Value *a = top(vm);
 
-                if (a.type == VAL_INTEGER && b.type == VAL_INTEGER) {
-                    push(vm,
-                         (Value){.type       = VAL_BOOLEAN,
-                                 .as.boolean = a.as.integer < b.as.integer});
-                } else if (a.type == VAL_FLOAT && b.type == VAL_FLOAT) {
-                    push(vm,
-                         (Value){.type       = VAL_BOOLEAN,
-                                 .as.boolean = a.as.floating < b.as.floating});
-                } else {
-                    error_invalid_opcode((ErrorLocation){0}, OP_LESS);
-                }
+                a->as.boolean = strcmp(a->as.str, b.as.str) == 0;
+                a->type       = VAL_BOOLEAN;
 
-            } break;
+            } VM_NEXT();
 
-            case OP_GREATER: {
+            VM_CASE(OP_LESS_INT): {
 
-                Value b = pop(vm);
-                Value a = pop(vm);
+                Value  b = pop(vm);
+                Value *a = top(vm);
 
-                if (a.type == VAL_INTEGER && b.type == VAL_INTEGER) {
-                    push(vm,
-                         (Value){.type       = VAL_BOOLEAN,
-                                 .as.boolean = a.as.integer > b.as.integer});
-                } else if (a.type == VAL_FLOAT && b.type == VAL_FLOAT) {
-                    push(vm,
-                         (Value){.type       = VAL_BOOLEAN,
-                                 .as.boolean = a.as.floating > b.as.floating});
-                } else {
-                    error_invalid_opcode((ErrorLocation){0}, OP_GREATER);
-                }
+                a->as.boolean = a->as.integer < b.as.integer;
+                a->type       = VAL_BOOLEAN;
 
-            } break;
+            } VM_NEXT();
 
-            case OP_LESS_EQUAL: {
+            VM_CASE(OP_LESS_FLOAT): {
 
-                Value b = pop(vm);
-                Value a = pop(vm);
+                Value  b = pop(vm);
+                Value *a = top(vm);
 
-                if (a.type == VAL_INTEGER && b.type == VAL_INTEGER) {
-                    push(vm,
-                         (Value){.type       = VAL_BOOLEAN,
-                                 .as.boolean = a.as.integer <= b.as.integer});
-                } else if (a.type == VAL_FLOAT && b.type == VAL_FLOAT) {
-                    push(vm,
-                         (Value){.type       = VAL_BOOLEAN,
-                                 .as.boolean = a.as.floating <= b.as.floating});
-                } else {
-                    error_invalid_opcode((ErrorLocation){0}, OP_LESS_EQUAL);
-                }
+                a->as.boolean = a->as.floating < b.as.floating;
+                a->type       = VAL_BOOLEAN;
 
-            } break;
+            } VM_NEXT();
 
-            case OP_GREATER_EQUAL: {
+            VM_CASE(OP_GREATER_INT): {
 
-                Value b = pop(vm);
-                Value a = pop(vm);
+                Value  b = pop(vm);
+                Value *a = top(vm);
 
-                if (a.type == VAL_INTEGER && b.type == VAL_INTEGER) {
-                    push(vm,
-                         (Value){.type       = VAL_BOOLEAN,
-                                 .as.boolean = a.as.integer >= b.as.integer});
-                } else if (a.type == VAL_FLOAT && b.type == VAL_FLOAT) {
-                    push(vm,
-                         (Value){.type       = VAL_BOOLEAN,
-                                 .as.boolean = a.as.floating >= b.as.floating});
-                } else {
-                    error_invalid_opcode((ErrorLocation){0}, OP_GREATER_EQUAL);
-                }
+                a->as.boolean = a->as.integer > b.as.integer;
+                a->type       = VAL_BOOLEAN;
 
-            } break;
+            } VM_NEXT();
 
-            case OP_NEG: {
+            VM_CASE(OP_GREATER_FLOAT): {
 
-                Value v = pop(vm);
+                Value  b = pop(vm);
+                Value *a = top(vm);
 
-                if (v.type == VAL_INTEGER) {
-                    push(vm,
-                         (Value){.type       = VAL_INTEGER,
-                                 .as.integer = -v.as.integer});
-                } else if (v.type == VAL_FLOAT) {
-                    push(vm,
-                         (Value){.type        = VAL_FLOAT,
-                                 .as.floating = -v.as.floating});
-                } else {
-                    error_invalid_opcode((ErrorLocation){0}, OP_NEG);
-                }
+                a->as.boolean = a->as.floating > b.as.floating;
+                a->type       = VAL_BOOLEAN;
 
-            } break;
+            } VM_NEXT();
 
-            case OP_ADD: {
+            VM_CASE(OP_LESS_EQUAL_INT): {
 
-                Value b = pop(vm);
-                Value a = pop(vm);
+                Value  b = pop(vm);
+                Value *a = top(vm);
 
-                if (a.type == VAL_INTEGER && b.type == VAL_INTEGER) {
+                a->as.boolean = a->as.integer <= b.as.integer;
+                a->type       = VAL_BOOLEAN;
 
-                    push(vm,
-                         (Value){.type       = VAL_INTEGER,
-                                 .as.integer = a.as.integer + b.as.integer});
+            } VM_NEXT();
 
-                } else if (a.type == VAL_FLOAT && b.type == VAL_FLOAT) {
+            VM_CASE(OP_LESS_EQUAL_FLOAT): {
 
-                    push(vm,
-                         (Value){.type        = VAL_FLOAT,
-                                 .as.floating = a.as.floating + b.as.floating});
+                Value  b = pop(vm);
+                Value *a = top(vm);
 
-                } else {
+                a->as.boolean = a->as.floating <= b.as.floating;
+                a->type       = VAL_BOOLEAN;
 
-                    error_invalid_opcode((ErrorLocation){0}, OP_ADD);
-                }
+            } VM_NEXT();
 
-            } break;
+            VM_CASE(OP_GREATER_EQUAL_INT): {
 
-            case OP_SUB: {
+                Value  b = pop(vm);
+                Value *a = top(vm);
 
-                Value b = pop(vm);
-                Value a = pop(vm);
+                a->as.boolean = a->as.integer >= b.as.integer;
+                a->type       = VAL_BOOLEAN;
 
-                if (a.type == VAL_INTEGER && b.type == VAL_INTEGER) {
+            } VM_NEXT();
 
-                    push(vm,
-                         (Value){.type       = VAL_INTEGER,
-                                 .as.integer = a.as.integer - b.as.integer});
+            VM_CASE(OP_GREATER_EQUAL_FLOAT): {
 
-                } else if (a.type == VAL_FLOAT && b.type == VAL_FLOAT) {
+                Value  b = pop(vm);
+                Value *a = top(vm);
 
-                    push(vm,
-                         (Value){.type        = VAL_FLOAT,
-                                 .as.floating = a.as.floating - b.as.floating});
+                a->as.boolean = a->as.floating >= b.as.floating;
+                a->type       = VAL_BOOLEAN;
 
-                } else {
+            } VM_NEXT();
 
-                    error_invalid_opcode((ErrorLocation){0}, OP_SUB);
-                }
+            VM_CASE(OP_NEG_INT): {
 
-            } break;
+                Value *v = top(vm);
 
-            case OP_MUL: {
+                v->as.integer = -v->as.integer;
+                v->type       = VAL_INTEGER;
 
-                Value b = pop(vm);
-                Value a = pop(vm);
+            } VM_NEXT();
 
-                if (a.type == VAL_INTEGER && b.type == VAL_INTEGER) {
+            VM_CASE(OP_NEG_FLOAT): {
 
-                    push(vm,
-                         (Value){.type       = VAL_INTEGER,
-                                 .as.integer = a.as.integer * b.as.integer});
+                Value *v = top(vm);
 
-                } else if (a.type == VAL_FLOAT && b.type == VAL_FLOAT) {
+                v->as.floating = -v->as.floating;
+                v->type        = VAL_FLOAT;
 
-                    push(vm,
-                         (Value){.type        = VAL_FLOAT,
-                                 .as.floating = a.as.floating * b.as.floating});
+            } VM_NEXT();
 
-                } else {
+            VM_CASE(OP_ADD_INT): {
 
-                    error_invalid_opcode((ErrorLocation){0}, OP_MUL);
-                }
+                Value  b = pop(vm);
+                Value *a = top(vm);
 
-            } break;
+                a->as.integer = a->as.integer + b.as.integer;
+                a->type       = VAL_INTEGER;
 
-            case OP_DIV: {
+            } VM_NEXT();
 
-                Value b = pop(vm);
-                Value a = pop(vm);
+            VM_CASE(OP_ADD_FLOAT): {
 
-                if (a.type == VAL_INTEGER && b.type == VAL_INTEGER) {
+                Value  b = pop(vm);
+                Value *a = top(vm);
 
-                    push(vm,
-                         (Value){.type       = VAL_INTEGER,
-                                 .as.integer = a.as.integer / b.as.integer});
+                a->as.floating = a->as.floating + b.as.floating;
+                a->type        = VAL_FLOAT;
 
-                } else if (a.type == VAL_FLOAT && b.type == VAL_FLOAT) {
+            } VM_NEXT();
 
-                    push(vm,
-                         (Value){.type        = VAL_FLOAT,
-                                 .as.floating = a.as.floating / b.as.floating});
+            VM_CASE(OP_SUB_INT): {
 
-                } else {
+                Value  b = pop(vm);
+                Value *a = top(vm);
 
-                    error_invalid_opcode((ErrorLocation){0}, OP_DIV);
-                }
+                a->as.integer = a->as.integer - b.as.integer;
+                a->type       = VAL_INTEGER;
+
+            } VM_NEXT();
+
+            VM_CASE(OP_SUB_FLOAT): {
+
+                Value  b = pop(vm);
+                Value *a = top(vm);
+
+                a->as.floating = a->as.floating - b.as.floating;
+                a->type        = VAL_FLOAT;
+
+            } VM_NEXT();
+
+            VM_CASE(OP_MUL_INT): {
+
+                Value  b = pop(vm);
+                Value *a = top(vm);
+
+                a->as.integer = a->as.integer * b.as.integer;
+                a->type       = VAL_INTEGER;
+
+            } VM_NEXT();
+
+            VM_CASE(OP_MUL_FLOAT): {
+
+                Value  b = pop(vm);
+                Value *a = top(vm);
+
+                a->as.floating = a->as.floating * b.as.floating;
+                a->type        = VAL_FLOAT;
+
+            } VM_NEXT();
 
-            } break;
+            VM_CASE(OP_DIV_INT): {
 
-            case OP_HALT:
+                Value  b = pop(vm);
+                Value *a = top(vm);
+
+                a->as.integer = a->as.integer / b.as.integer;
+                a->type       = VAL_INTEGER;
+
+            } VM_NEXT();
+
+            VM_CASE(OP_DIV_FLOAT): {
+
+                Value  b = pop(vm);
+                Value *a = top(vm);
+
+                a->as.floating = a->as.floating / b.as.floating;
+                a->type        = VAL_FLOAT;
+
+            } VM_NEXT();
+
+            VM_CASE(OP_HALT): {
+
+                vm->pos = (size_t)(ip - vm->code);
                 return;
-                break;
+            }
+
+            VM_CASE(OP_NO_RETURN): {
+
+                error_missing_return((ErrorLocation){0}, frame->fn->name);
+            }
 
             default:
-                error_invalid_opcode((ErrorLocation){0}, operation);
+#if COMPUTED_GOTO
+            do_invalid:
+#endif
+                error_invalid_opcode((ErrorLocation){0},
+                                     ip[-1]);
         }
     }
 }
@@ -5,7 +5,9 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include "arena.h"
 #include "parser.h"
+#include "symbols.h"
 
 typedef enum {
 
@@ -22,18 +24,31 @@ typedef enum {
     OP_NOT,
     OP_AND,
     OP_OR,
-    OP_EQUAL,
-    OP_LESS,
-    OP_GREATER,
-    OP_LESS_EQUAL,
-    OP_GREATER_EQUAL,
-    OP_NEG,
-    OP_ADD,
-    OP_SUB,
-    OP_MUL,
-    OP_DIV,
+    OP_EQUAL_INT,
+    OP_EQUAL_FLOAT,
+    OP_EQUAL_BOOL,
+    OP_EQUAL_STR,
+    OP_LESS_INT,
+    OP_LESS_FLOAT,
+    OP_GREATER_INT,
+    OP_GREATER_FLOAT,
+    OP_LESS_EQUAL_INT,
+    OP_LESS_EQUAL_FLOAT,
+    OP_GREATER_EQUAL_INT,
+    OP_GREATER_EQUAL_FLOAT,
+    OP_NEG_INT,
+    OP_NEG_FLOAT,
+    OP_ADD_INT,
+    OP_ADD_FLOAT,
+    OP_SUB_INT,
+    OP_SUB_FLOAT,
+    OP_MUL_INT,
+    OP_MUL_FLOAT,
+    OP_DIV_INT,
+    OP_DIV_FLOAT,
     OP_POP,
-    OP_HALT
+    OP_HALT,
+    OP_NO_RETURN
 
 } Opcode;
 
@@ -74,11 +89,38 @@ typedef struct {
     size_t     local_count;
     size_t     local_cap;
     size_t     start_ip;
+    size_t     max_stack; // Operand stack high-water mark above the locals
+    size_t    *callees;   // Indices of every function called from the body
+    size_t     callee_count;
+    size_t     callee_cap;
+    bool       compiled; // Checked and emitted, unless lazy and never called
 
 } FunctionDef;
 
+/* An expression being walked and how many of its operands are done */
 typedef struct {
 
+    AstExpression *expression;
+    size_t         next;
+
+} ExprFrame;
+
+/* A block being walked, how many of its statements are done, and the if or
+ * while it belongs to along with the jumps waiting on its end */
+typedef struct {
+
+    AstBlock     *block;
+    size_t        next;
+    AstStatement *owner;
+    size_t        jumps[2];
+    bool          loops; // The owner is a while, jumping back at the end
+
+} BlockFrame;
+
+typedef struct {
+
+    Arena *arena; // Owns names, side tables and string constants
+
     uint8_t *code;
     size_t   code_len;
     size_t   code_cap;
@@ -87,19 +129,80 @@ typedef struct {
     size_t const_count;
     size_t const_cap;
 
+    // Open-addressed index over the pool, slot holds constant index + 1
+    size_t *const_slots;
+    size_t  const_slot_cap;
+    size_t  const_dupes; // Literals that reused an existing constant
+
     char     **global_names;
     TokenType *global_types;
     size_t     global_count;
     size_t     global_cap;
 
+    // Name to slot indices, locals only cover the function being checked
+    SymbolTable global_index;
+    SymbolTable function_index;
+    SymbolTable local_index;
+
+    // Functions already reported as undefined, whose later calls pass
+    SymbolTable undefined_index;
+
     FunctionDef entry;
 
     FunctionDef *functions;
     size_t       func_count;
     size_t       func_cap;
 
+    // Functions queued for checking, every one in declaration order or,
+    // with lazily parsed bodies, only those called as calls are found
+    size_t *pending;
+    size_t  pending_count;
+
+    // Compiling in one pass, reads on for names declared further down. The
+    // first miss clears it, as every declaration left is then known
+    Parser *ahead;
+
+    // Checking a whole program, goes on past an error to report the next
+    bool recover;
+
+    // Declarations were lost to a syntax error, so a name that isn't found
+    // may be one of them and is taken as untyped rather than reported
+    bool lost;
+
+    size_t stack_depth; // Running operand depth while emitting a function
+    size_t fn_start;    // Its start_ip, which its jump targets count from
+
+    // Emitting functions apart to be linked into the program later, where
+    // in the code each constant index is, as it indexes this pool only
+    bool    apart;
+    size_t *fixups;
+    size_t  fixup_count;
+    size_t  fixup_cap;
+
+    // Pending nodes of the checker's and emitter's walks, on the heap so
+    // that nesting depth never grows the C stack
+    ExprFrame  *expr_stack;
+    size_t      expr_count;
+    size_t      expr_cap;
+    BlockFrame *block_stack;
+    size_t      block_count;
+    size_t      block_cap;
+
+    // Worst-case stack slots and call frames for the whole program, or 0
+    // when recursion reachable from entry leaves them unbounded
+    size_t stack_size;
+    size_t frame_depth;
+
 } Emitter;
 
+/* The code of one function emitted apart, and its range of fixups */
+typedef struct {
+
+    size_t code_start, code_end;
+    size_t fixup_start, fixup_end;
+
+} CodeSpan;
+
 typedef struct {
 
     Value *stack;
@@ -127,8 +230,11 @@ typedef struct {
 
 } VM;
 
+void        init_emitter(Emitter *emitter, Arena *arena);
 void        emit_program(Emitter *emitter, AstProgram *program);
 void        free_emitter(Emitter *emitter);
+void        init_part(Emitter *part, const Emitter *program, Arena *arena);
+void        free_part(Emitter *part);
 void        init_vm(VM          *vm,
                     Value       *constants,
                     size_t       const_count,
@@ -137,9 +243,37 @@ void        init_vm(VM          *vm,
                     FunctionDef *functions,
                     size_t       func_count,
                     FunctionDef  entry_fn,
-                    size_t       global_count);
+                    TokenType   *global_types,
+                    size_t       global_count,
+                    size_t       stack_size,
+                    size_t       frame_depth);
 void        free_vm(VM *vm);
 void        interpret(VM *vm);
 const char *token_type_to_string(TokenType type);
 
+// Walking the AST on the emitter's stacks, for the checker and emitter
+void           push_expr_frame(Emitter *emitter, AstExpression *expression);
+BlockFrame    *push_block_frame(Emitter      *emitter,
+                                AstBlock     *block,
+                                AstStatement *owner);
+AstExpression *expression_operand(AstExpression *expression, size_t index);
+
+// Emitting statements as the parser hands them over, in one pass
+void emit_statement(Emitter      *emitter,
+                    FunctionDef  *current_fn,
+                    AstStatement *statement);
+void emit_else(Emitter *emitter);
+void emit_branch_end(Emitter *emitter);
+void begin_body(Emitter *emitter, FunctionDef *fn);
+void emit_body_end(Emitter *emitter, FunctionDef *fn);
+void bound_program(Emitter *emitter);
+
+// Emitting a body whole, into the program or apart and linked in after
+void emit_body(Emitter *emitter, FunctionDef *fn, AstBlock *body);
+void link_function(Emitter        *emitter,
+                   FunctionDef    *fn,
+                   const Emitter  *part,
+                   const CodeSpan *span,
+                   size_t         *map);
+
 #endif
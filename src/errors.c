@@ -19,6 +19,7 @@ typedef struct {
     const char *error_colour;
     const char *help_colour;
     char *(*suggest)(const char *line_text, ErrorLocation loc, va_list args);
+    bool        fatal;  // Ends the compile at once rather than being kept
 
 } ErrorInfo;
 
@@ -34,40 +35,93 @@ suggest_close_string(const char *line_text, ErrorLocation loc, va_list args);
 
 // clang-format off
 static const ErrorInfo ERROR_TABLE[] = {
-    { ERR_OOM, "Out of memory.", "Reduce memory usage or increase its capacity.", FG_RED_BOLD, FG_BLUE_BOLD, NULL },
-    { ERR_COMPLEXITY, "Program complexity exceeded.", "Reduce the number of nested frames and/or values.", FG_RED_BOLD, FG_BLUE_BOLD, NULL },
-    { ERR_OPEN_STR, "Unterminated string.", "Use a closing '\"' to end a string.", FG_RED_BOLD, FG_BLUE_BOLD, suggest_close_string },
-    { ERR_EXPECT_SYMBOL, "Expected %s.", "Add %s here.", FG_RED_BOLD, FG_BLUE_BOLD, suggest_insert_expected },
-    { ERR_EXPECT_EXPRESSION, "Expected expression.", "Provide an expression at this position.", FG_RED_BOLD, FG_BLUE_BOLD, NULL },
-    { ERR_EXPECT_STATEMENT, "Expected statement or declaration.", "Provide a statement or declaration here.", FG_RED_BOLD, FG_BLUE_BOLD, NULL },
-    { ERR_INVALID_TOK, "Unexpected token at global scope.", "Only 'entry' blocks or 'let' declarations are valid at global scope.", FG_RED_BOLD, FG_BLUE_BOLD, suggest_remove_span },
-    { ERR_MANY_ENTRY, "Duplicate entry block.", "Only one 'entry' block is allowed.", FG_RED_BOLD, FG_BLUE_BOLD, NULL },
-    { ERR_NO_ENTRY, "Missing entry block.", "Add an 'entry' block to define the program entrypoint.", FG_RED_BOLD, FG_BLUE_BOLD, NULL },
-    { ERR_TYPE_MISMATCH, "Type mismatch.", "Variable '%s' expects %s but got %s.", FG_RED_BOLD, FG_BLUE_BOLD, suggest_type_mismatch_fix },
-    { ERR_INVALID_OPCODE, "Unknown opcode '%d'.", "Unavailable (Internal Error).", FG_RED_BOLD, FG_PURPLE_BOLD, NULL },
-    { ERR_INVALID_VAR_INDEX, "Invalid variable index.", "Index out of range; maximum is %zu variables.", FG_RED_BOLD, FG_BLUE_BOLD, NULL },
-    { ERR_INVALID_CONST_INDEX, "Invalid constant index.", "Index out of range; maximum is %zu constants.", FG_RED_BOLD, FG_BLUE_BOLD, NULL },
-    { ERR_VM_POS_OOB, "VM pointer out of bounds.", "Unavailable (Internal Error).", FG_RED_BOLD, FG_PURPLE_BOLD, NULL },
-    { ERR_UNDEFINED_VAR, "Variable '%s' is undefined.", "Variables must be declared before use.", FG_RED_BOLD, FG_BLUE_BOLD, NULL },
-    { ERR_UNEXPECTED_IDENT, "Unexpected identifier '%s'.", "Use 'let %s: <type>' to declare or '%s = <expr>' to assign.", FG_RED_BOLD, FG_BLUE_BOLD, NULL },
-    { ERR_WRONG_VAR_INIT, "Variable initialization mismatch.", "Declared %zu variables but found %zu initializers.", FG_RED_BOLD, FG_BLUE_BOLD, NULL },
-    { ERR_MISSING_RETURN, "Missing return in function '%s'.", "Add a 'return' statement that matches the function's return type.", FG_RED_BOLD, FG_BLUE_BOLD, NULL },
-    { ERR_UNDEFINED_FUNC, "Function '%s' is undefined.", "Declare the function before calling it.", FG_RED_BOLD, FG_BLUE_BOLD, NULL },
-    { ERR_NO_ARGS, "Missing input file.", "Pass an input file path (<input_file.phase>).", FG_RED_BOLD, FG_BLUE_BOLD, NULL },
-    { ERR_INVALID_ARG, "Unknown argument '%s'.", "See all available arguments with 'phase --help'.", FG_RED_BOLD, FG_BLUE_BOLD, NULL },
-    { ERR_IO, "I/O error on argument '%s'.", "Ensure the input path exists and is readable.", FG_RED_BOLD, FG_BLUE_BOLD, NULL },
-    { ERR_NO_INPUT, "Input file '%s' not found.", "Use a valid input path (e.g. /path/to/file.phase).", FG_RED_BOLD, FG_BLUE_BOLD, NULL }
+    { ERR_OOM, "Out of memory.", "Reduce memory usage or increase its capacity.", FG_RED_BOLD, FG_BLUE_BOLD, NULL, true },
+    { ERR_COMPLEXITY, "Program complexity exceeded.", "Reduce the number of nested frames and/or values.", FG_RED_BOLD, FG_BLUE_BOLD, NULL, true },
+    { ERR_OPEN_STR, "Unterminated string.", "Use a closing '\"' to end a string.", FG_RED_BOLD, FG_BLUE_BOLD, suggest_close_string, true },
+    { ERR_EXPECT_SYMBOL, "Expected %s.", "Add %s here.", FG_RED_BOLD, FG_BLUE_BOLD, suggest_insert_expected, false },
+    { ERR_EXPECT_EXPRESSION, "Expected expression.", "Provide an expression at this position.", FG_RED_BOLD, FG_BLUE_BOLD, NULL, false },
+    { ERR_EXPECT_STATEMENT, "Expected statement or declaration.", "Provide a statement or declaration here.", FG_RED_BOLD, FG_BLUE_BOLD, NULL, false },
+    { ERR_INVALID_TOK, "Unexpected token at global scope.", "Only 'entry' blocks or 'let' declarations are valid at global scope.", FG_RED_BOLD, FG_BLUE_BOLD, suggest_remove_span, false },
+    { ERR_MANY_ENTRY, "Duplicate entry block.", "Only one 'entry' block is allowed.", FG_RED_BOLD, FG_BLUE_BOLD, NULL, false },
+    { ERR_NO_ENTRY, "Missing entry block.", "Add an 'entry' block to define the program entrypoint.", FG_RED_BOLD, FG_BLUE_BOLD, NULL, false },
+    { ERR_TYPE_MISMATCH, "Type mismatch.", "Variable '%s' expects %s but got %s.", FG_RED_BOLD, FG_BLUE_BOLD, suggest_type_mismatch_fix, false },
+    { ERR_INVALID_OPCODE, "Unknown opcode '%d'.", "Unavailable (Internal Error).", FG_RED_BOLD, FG_PURPLE_BOLD, NULL, true },
+    { ERR_INVALID_VAR_INDEX, "Invalid variable index.", "Index out of range; maximum is %zu variables.", FG_RED_BOLD, FG_BLUE_BOLD, NULL, true },
+    { ERR_INVALID_CONST_INDEX, "Invalid constant index.", "Index out of range; maximum is %zu constants.", FG_RED_BOLD, FG_BLUE_BOLD, NULL, true },
+    { ERR_VM_POS_OOB, "VM pointer out of bounds.", "Unavailable (Internal Error).", FG_RED_BOLD, FG_PURPLE_BOLD, NULL, true },
+    { ERR_UNDEFINED_VAR, "Variable '%s' is undefined.", "Variables must be declared before use.", FG_RED_BOLD, FG_BLUE_BOLD, NULL, false },
+    { ERR_UNEXPECTED_IDENT, "Unexpected identifier '%s'.", "Use 'let %s: <type>' to declare or '%s = <expr>' to assign.", FG_RED_BOLD, FG_BLUE_BOLD, NULL, false },
+    { ERR_WRONG_VAR_INIT, "Variable initialization mismatch.", "Declared %zu variables but found %zu initializers.", FG_RED_BOLD, FG_BLUE_BOLD, NULL, false },
+    { ERR_MISSING_RETURN, "Missing return in function '%s'.", "Add a 'return' statement that matches the function's return type.", FG_RED_BOLD, FG_BLUE_BOLD, NULL, false },
+    { ERR_UNDEFINED_FUNC, "Function '%s' is undefined.", "Declare the function before calling it.", FG_RED_BOLD, FG_BLUE_BOLD, NULL, false },
+    { ERR_INVALID_BYTECODE, "Invalid bytecode at offset %zu (%s).", "Unavailable (Internal Error).", FG_RED_BOLD, FG_PURPLE_BOLD, NULL, true },
+    { ERR_NO_ARGS, "Missing input file.", "Pass an input file path (<input_file.phase>).", FG_RED_BOLD, FG_BLUE_BOLD, NULL, true },
+    { ERR_INVALID_ARG, "Unknown argument '%s'.", "See all available arguments with 'phase --help'.", FG_RED_BOLD, FG_BLUE_BOLD, NULL, true },
+    { ERR_IO, "I/O error on argument '%s'.", "Ensure the input path exists and is readable.", FG_RED_BOLD, FG_BLUE_BOLD, NULL, true },
+    { ERR_NO_INPUT, "Input file '%s' not found.", "Use a valid input path (e.g. /path/to/file.phase).", FG_RED_BOLD, FG_BLUE_BOLD, NULL, true }
 };
 // clang-format on
 
-static const char *g_error_file = NULL;
+static const char   *g_error_file  = NULL;
+static const Source *g_error_lines = NULL;
 
-noreturn void exit_phase(unsigned int code) {
+/* An error kept to be reported along with the rest once a compile gives up */
+typedef struct {
+
+    const ErrorInfo *info;
+    ErrorLocation    loc;
+    char            *message;
+    char            *help;
+    char            *line_text;
+    char            *suggestion;
+    size_t           order;  // When it was raised, for errors at one place
+
+} Diagnostic;
+
+// Where this thread goes on an error instead of reporting it, if anywhere
+static _Thread_local jmp_buf *g_error_bail = NULL;
+
+// Where this thread goes after keeping an error a compile can go on past
+static _Thread_local jmp_buf *g_error_recover = NULL;
+
+// Where this thread goes after giving up instead of exiting
+static _Thread_local jmp_buf *g_error_catch = NULL;
+
+// Errors this thread has kept and not yet reported
+static _Thread_local Diagnostic *g_diagnostics     = NULL;
+static _Thread_local size_t      g_diagnostic_count = 0;
+static _Thread_local size_t      g_diagnostic_cap   = 0;
+static _Thread_local size_t      g_diagnostic_order = 0;
+
+// Work still running that has to be stopped before the process exits
+static void (*g_teardown)(void *) = NULL;
+static void  *g_teardown_arg      = NULL;
+
+static void print_diagnostic(const Diagnostic *diagnostic, const char *label);
+
+/* Print how the process ends, for exit codes 0 and 1 */
+void report_exit(unsigned int code) {
     if (code == 0) {
         fprintf(stderr, "\nProcess successfully exited with code %d.\n", code);
     } else if (code == 1) {
         fprintf(stderr, "\nProcess exited with code %d.\n", code);
-    } else if (code == 2) {
+    }
+}
+
+/* Have teardown(arg) run before the process exits, for a thread that can't
+ * be left running. teardown clears it before it could exit again itself,
+ * and NULL runs nothing */
+void exit_teardown(void (*teardown)(void *), void *arg) {
+
+    g_teardown     = teardown;
+    g_teardown_arg = arg;
+}
+
+noreturn void exit_phase(unsigned int code) {
+    if (g_teardown)
+        g_teardown(g_teardown_arg);
+    report_exit(code);
+    if (code == 2) {
         exit(0);
     }
     exit(code);
@@ -78,101 +132,202 @@ void error_set_source(const char *file) {
     g_error_file = file;
 }
 
-static const ErrorInfo *find_error_info(ErrorType code) {
+/* Diagnostics quote lines from the loaded source from here on */
+void error_set_lines(const Source *source) {
 
-    size_t count = sizeof(ERROR_TABLE) / sizeof(ERROR_TABLE[0]);
+    g_error_lines = source;
+}
 
-    for (size_t i = 0; i < count; i++) {
+/* Have errors raised on this thread jump to bail rather than be reported,
+ * for work whose first error may not be the one to report. NULL reports
+ * them again */
+void error_bail(jmp_buf *bail) {
 
-        if (ERROR_TABLE[i].code == code)
-            return &ERROR_TABLE[i];
-    }
+    g_error_bail = bail;
+}
 
-    return NULL;
+/* Have this thread jump to catch once it gives up rather than exit, for a
+ * process that outlives a failed compile or run. NULL exits again */
+void error_catch(jmp_buf *catch) {
+
+    g_error_catch = catch;
 }
 
-static ErrorLocation normalize_location(ErrorLocation loc) {
+/* Have errors that a compile can go on past kept on this thread and jump
+ * to recover, for a compiler looking for the next one. NULL gives up on
+ * them again. Returns the recovery point it replaces, for nested ones to
+ * restore */
+jmp_buf *error_recover(jmp_buf *recover) {
 
-    if (!loc.file)
-        loc.file = g_error_file;
-    if (loc.col_end < loc.col_start && loc.col_end != 0)
-        loc.col_end = loc.col_start;
+    jmp_buf *outer  = g_error_recover;
+    g_error_recover = recover;
 
-    return loc;
+    return outer;
 }
 
-static char *load_line_from_file(const char *path, int target_line) {
+/* How many errors this thread has kept and not yet reported */
+size_t error_count(void) {
 
-    if (!path || target_line <= 0)
-        return NULL;
+    return g_diagnostic_count;
+}
 
-    FILE *file = fopen(path, "r");
+static void free_diagnostic(Diagnostic *diagnostic) {
 
-    if (!file)
-        return NULL;
+    free(diagnostic->message);
+    free(diagnostic->help);
+    free(diagnostic->line_text);
+    free(diagnostic->suggestion);
+}
 
-    size_t cap          = 256;
-    size_t len          = 0;
-    char  *buffer       = malloc(cap);
-    int    current_line = 1;
-    int    ch;
+/* Forget the errors kept so far, for one that ends the compile on its own */
+static void drop_diagnostics(void) {
 
-    if (!buffer) {
+    for (size_t i = 0; i < g_diagnostic_count; i++)
+        free_diagnostic(&g_diagnostics[i]);
 
-        fclose(file);
-        return NULL;
+    g_diagnostic_count = 0;
+}
+
+/* Order errors by where they are in the source, those with no place last,
+ * and errors at one place by when they were raised */
+static int compare_diagnostics(const void *a, const void *b) {
+
+    const Diagnostic *left  = a;
+    const Diagnostic *right = b;
+
+    bool left_placed  = left->loc.line > 0;
+    bool right_placed = right->loc.line > 0;
+
+    if (left_placed != right_placed)
+        return left_placed ? -1 : 1;
+    if (left->loc.line != right->loc.line)
+        return left->loc.line < right->loc.line ? -1 : 1;
+    if (left->loc.col_start != right->loc.col_start)
+        return left->loc.col_start < right->loc.col_start ? -1 : 1;
+
+    return (left->order > right->order) - (left->order < right->order);
+}
+
+/* Report every error kept so far in source order, so a compile reports the
+ * same however its parts were ordered */
+static void report_diagnostics(void) {
+
+    size_t count = g_diagnostic_count;
+
+    qsort(g_diagnostics, count, sizeof(Diagnostic), compare_diagnostics);
+
+    for (size_t i = 0; i < count; i++) {
+
+        // Set apart from the error reported before it
+        if (i > 0)
+            fputc('\n', stderr);
+
+        print_diagnostic(&g_diagnostics[i], "Error");
+        free_diagnostic(&g_diagnostics[i]);
     }
 
-    while ((ch = fgetc(file)) != EOF) {
+    if (count > 1)
+        fprintf(stderr,
+                "\n%s%zu errors reported.%s\n",
+                FG_RED_BOLD,
+                count,
+                RESET);
 
-        if (current_line == target_line) {
+    g_diagnostic_count = 0;
+}
 
-            if (ch == '\n') {
+/* Go back to the catch if there is one, or exit */
+static noreturn void error_stop(void) {
 
-                buffer[len] = '\0';
-                fclose(file);
-                return buffer;
-            }
+    g_error_recover = NULL;
 
-            if (len + 1 >= cap) {
-                size_t new_cap  = cap ? cap * 2 : 32;
-                char  *temp_ptr = realloc(buffer, new_cap);
-                if (!temp_ptr) {
-                    free(buffer);
-                    fclose(file);
-                    error_oom();
-                }
+    if (g_error_catch)
+        longjmp(*g_error_catch, 1);
 
-                buffer = temp_ptr;
-                cap    = new_cap;
-            }
+    exit_phase(1);
+}
 
-            buffer[len++] = (char)ch;
-        }
+/* Give up, reporting every error kept so far */
+noreturn void error_fail(void) {
 
-        if (ch == '\n') {
+    report_diagnostics();
+    error_stop();
+}
 
-            if (current_line == target_line)
-                break;
-            current_line++;
+/* Go on from the recovery point after an error that was kept, or give up
+ * if there is none */
+noreturn void error_unwind(void) {
 
-            if (current_line > target_line)
-                break;
-        }
+    if (g_error_recover)
+        longjmp(*g_error_recover, 1);
+
+    error_fail();
+}
+
+/* Keep an error to report with the rest */
+static void keep_diagnostic(Diagnostic diagnostic) {
+
+    if (g_diagnostic_count == g_diagnostic_cap) {
+
+        size_t      cap  = g_diagnostic_cap ? g_diagnostic_cap * 2 : 8;
+        Diagnostic *grow = realloc(g_diagnostics, cap * sizeof(Diagnostic));
+
+        if (!grow)
+            error_oom();
+
+        g_diagnostics    = grow;
+        g_diagnostic_cap = cap;
     }
 
-    fclose(file);
+    diagnostic.order                     = g_diagnostic_order++;
+    g_diagnostics[g_diagnostic_count++] = diagnostic;
+}
+
+static const ErrorInfo *find_error_info(ErrorType code) {
+
+    size_t count = sizeof(ERROR_TABLE) / sizeof(ERROR_TABLE[0]);
 
-    if (current_line == target_line) {
+    for (size_t i = 0; i < count; i++) {
 
-        buffer[len] = '\0';
-        return buffer;
+        if (ERROR_TABLE[i].code == code)
+            return &ERROR_TABLE[i];
     }
 
-    free(buffer);
     return NULL;
 }
 
+static ErrorLocation normalize_location(ErrorLocation loc) {
+
+    if (!loc.file)
+        loc.file = g_error_file;
+    if (loc.col_end < loc.col_start && loc.col_end != 0)
+        loc.col_end = loc.col_start;
+
+    return loc;
+}
+
+/* Copy one line of the loaded source for a diagnostic to quote */
+static char *load_source_line(int target_line) {
+
+    if (!g_error_lines)
+        return NULL;
+
+    size_t      len  = 0;
+    const char *text = source_line(g_error_lines, target_line, &len);
+
+    if (!text)
+        return NULL;
+
+    char *buffer = malloc(len + 1);
+    if (!buffer)
+        error_oom();
+
+    memcpy(buffer, text, len);
+    buffer[len] = '\0';
+
+    return buffer;
+}
+
 static void print_source_snippet(const char   *line_text,
                                  ErrorLocation loc,
                                  const char   *bar_side) {
@@ -494,31 +649,67 @@ bool unicode_available(void) {
     return true;
 }
 
-static noreturn void error_emit(ErrorLocation loc, ErrorType code, ...) {
+/* Format into a new string, or NULL if there is no memory for it */
+static char *format_text(const char *fmt, va_list args) {
 
-    bool             unicode  = unicode_available();
-    const char      *bar_main = unicode ? "┏" : ">";
-    const char      *bar_sub  = unicode ? "┣" : ">";
-    const char      *bar_side = unicode ? "┃" : "|";
-    const ErrorInfo *info     = find_error_info(code);
+    va_list measure;
+    va_copy(measure, args);
+    int len = vsnprintf(NULL, 0, fmt, measure);
+    va_end(measure);
 
-    if (!info) {
+    if (len < 0)
+        return NULL;
 
-        fprintf(stderr,
-                "%s%s Fatal Error [%d]:%s Unknown error.\n",
-                FG_RED_BOLD,
-                bar_main,
-                code,
-                RESET);
-        fprintf(stderr,
-                "%s%s Help:%s Unavailable (INTERNAL ERROR).\n",
-                FG_PURPLE_BOLD,
-                bar_sub,
-                RESET);
-        exit_phase(1);
+    char *text = malloc((size_t)len + 1);
+
+    if (text)
+        vsnprintf(text, (size_t)len + 1, fmt, args);
+
+    return text;
+}
+
+/* Put together everything an error reports from its arguments */
+static Diagnostic describe_error(const ErrorInfo *info,
+                                 ErrorLocation    loc,
+                                 va_list          args) {
+
+    Diagnostic diagnostic = {.info = info, .loc = normalize_location(loc)};
+
+    if (diagnostic.loc.line > 0)
+        diagnostic.line_text = load_source_line(diagnostic.loc.line);
+
+    va_list args_msg;
+    va_copy(args_msg, args);
+    diagnostic.message = format_text(info->message_fmt, args_msg);
+    va_end(args_msg);
+
+    va_list args_help;
+    va_copy(args_help, args);
+    diagnostic.help = format_text(info->help_fmt, args_help);
+    va_end(args_help);
+
+    if (info->suggest && diagnostic.line_text) {
+
+        va_list args_suggest;
+        va_copy(args_suggest, args);
+        diagnostic.suggestion = info->suggest(
+                diagnostic.line_text, diagnostic.loc, args_suggest);
+        va_end(args_suggest);
     }
 
-    loc = normalize_location(loc);
+    return diagnostic;
+}
+
+/* Print an error under label, which tells one the compile went on past
+ * from one that ended it */
+static void print_diagnostic(const Diagnostic *diagnostic, const char *label) {
+
+    bool             unicode  = unicode_available();
+    const char      *bar_main = unicode ? "┏" : ">";
+    const char      *bar_sub  = unicode ? "┣" : ">";
+    const char      *bar_side = unicode ? "┃" : "|";
+    const ErrorInfo *info     = diagnostic->info;
+    ErrorLocation    loc      = diagnostic->loc;
 
     const char *file         = loc.file ? loc.file : "<unknown>";
     int         line         = loc.line > 0 ? loc.line : 0;
@@ -526,26 +717,14 @@ static noreturn void error_emit(ErrorLocation loc, ErrorType code, ...) {
     int         col_end      = loc.col_end > 0 ? loc.col_end : col_start;
     bool        has_location = line > 0;
 
-    char *line_text = NULL;
-    if (has_location)
-        line_text = load_line_from_file(loc.file, loc.line);
-
-    va_list args;
-    va_start(args, code);
-
-    va_list args_msg;
-    va_copy(args_msg, args);
-
     fprintf(stderr,
-            "%s%s Fatal Error [%d]:%s ",
+            "%s%s %s [%d]:%s %s\n",
             info->error_colour,
             bar_main,
+            label,
             info->code,
-            RESET);
-    vfprintf(stderr, info->message_fmt, args_msg);
-    fprintf(stderr, "\n");
-
-    va_end(args_msg);
+            RESET,
+            diagnostic->message ? diagnostic->message : "");
 
     if (has_location) {
 
@@ -559,60 +738,85 @@ static noreturn void error_emit(ErrorLocation loc, ErrorType code, ...) {
                 col_start,
                 col_end,
                 RESET);
-        print_source_snippet(line_text, loc, bar_side);
+        print_source_snippet(diagnostic->line_text, loc, bar_side);
     }
 
-    va_list args_help;
-    va_copy(args_help, args);
+    fprintf(stderr,
+            "%s%s Help:%s %s\n",
+            info->help_colour,
+            bar_sub,
+            RESET,
+            diagnostic->help ? diagnostic->help : "");
 
-    fprintf(stderr, "%s%s Help:%s ", info->help_colour, bar_sub, RESET);
-    vfprintf(stderr, info->help_fmt, args_help);
-    fprintf(stderr, "\n");
+    if (has_location && diagnostic->suggestion) {
 
-    va_end(args_help);
+        fprintf(stderr,
+                "%s%s Suggestion:%s\n",
+                info->help_colour,
+                bar_side,
+                RESET);
+        fprintf(stderr,
+                "%s%s%s %s- %s%s\n",
+                FG_BLUE_BOLD,
+                bar_side,
+                RESET,
+                FG_RED,
+                diagnostic->line_text,
+                RESET);
+        fprintf(stderr,
+                "%s%s%s %s+ %s%s\n",
+                FG_BLUE_BOLD,
+                bar_side,
+                RESET,
+                FG_GREEN,
+                diagnostic->suggestion,
+                RESET);
+    }
+}
 
-    char *suggested_line = NULL;
+/* Keep an error that a compile can go on past and go on, or report one that
+ * ends it at once, dropping those kept before it */
+static noreturn void error_emit(ErrorLocation loc, ErrorType code, ...) {
 
-    if (has_location && info->suggest && line_text) {
+    if (g_error_bail)
+        longjmp(*g_error_bail, 1);
 
-        va_list args_suggest;
-        va_copy(args_suggest, args);
-        suggested_line = info->suggest(line_text, loc, args_suggest);
-        va_end(args_suggest);
+    const ErrorInfo *info = find_error_info(code);
 
-        if (suggested_line) {
-
-            fprintf(stderr,
-                    "%s%s Suggestion:%s\n",
-                    info->help_colour,
-                    bar_side,
-                    RESET);
-            fprintf(stderr,
-                    "%s%s%s %s- %s%s\n",
-                    FG_BLUE_BOLD,
-                    bar_side,
-                    RESET,
-                    FG_RED,
-                    line_text,
-                    RESET);
-            fprintf(stderr,
-                    "%s%s%s %s+ %s%s\n",
-                    FG_BLUE_BOLD,
-                    bar_side,
-                    RESET,
-                    FG_GREEN,
-                    suggested_line,
-                    RESET);
-        }
+    if (!info) {
+
+        bool unicode = unicode_available();
+
+        drop_diagnostics();
+        fprintf(stderr,
+                "%s%s Fatal Error [%d]:%s Unknown error.\n",
+                FG_RED_BOLD,
+                unicode ? "┏" : ">",
+                code,
+                RESET);
+        fprintf(stderr,
+                "%s%s Help:%s Unavailable (INTERNAL ERROR).\n",
+                FG_PURPLE_BOLD,
+                unicode ? "┣" : ">",
+                RESET);
+        error_stop();
     }
 
+    va_list args;
+    va_start(args, code);
+    Diagnostic diagnostic = describe_error(info, loc, args);
     va_end(args);
-    if (suggested_line)
-        free(suggested_line);
-    if (line_text)
-        free(line_text);
 
-    exit_phase(1);
+    if (info->fatal) {
+
+        drop_diagnostics();
+        print_diagnostic(&diagnostic, "Fatal Error");
+        free_diagnostic(&diagnostic);
+        error_stop();
+    }
+
+    keep_diagnostic(diagnostic);
+    error_unwind();
 }
 
 // Internal errors
@@ -678,6 +882,9 @@ void error_missing_return(ErrorLocation loc, const char *name) {
 void error_undefined_func(ErrorLocation loc, const char *name) {
     error_emit(loc, ERR_UNDEFINED_FUNC, name);
 }
+void error_invalid_bytecode(size_t offset, const char *reason) {
+    error_emit((ErrorLocation){0}, ERR_INVALID_BYTECODE, offset, reason);
+}
 
 // CLI errors
 void error_no_args(void) {
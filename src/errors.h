@@ -1,10 +1,13 @@
 #ifndef ERRORS_H
 #define ERRORS_H
 
+#include <setjmp.h>
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdnoreturn.h>
 
+#include "source.h"
+
 typedef struct {
 
     const char *file;
@@ -36,6 +39,7 @@ typedef enum {
     ERR_UNEXPECTED_IDENT,
     ERR_MISSING_RETURN,
     ERR_UNDEFINED_FUNC,
+    ERR_INVALID_BYTECODE,
 
     // CLI errors
     ERR_NO_ARGS = 200,
@@ -68,12 +72,22 @@ noreturn void error_undefined_var(ErrorLocation loc, const char *name);
 noreturn void error_unexpected_ident(ErrorLocation loc, const char *name);
 noreturn void error_missing_return(ErrorLocation loc, const char *name);
 noreturn void error_undefined_func(ErrorLocation loc, const char *name);
+noreturn void error_invalid_bytecode(size_t offset, const char *reason);
 noreturn void error_no_args(void);
 noreturn void error_invalid_arg(const char *arg);
 noreturn void error_io(const char *arg);
 noreturn void error_ifnf(const char *name);
 void          error_set_source(const char *file);
+void          error_set_lines(const Source *source);
+void          error_bail(jmp_buf *bail);
+void          error_catch(jmp_buf *catch);
+jmp_buf      *error_recover(jmp_buf *recover);
+size_t        error_count(void);
+noreturn void error_fail(void);
+noreturn void error_unwind(void);
 bool          unicode_available(void);
+void          report_exit(unsigned int code);
+void          exit_teardown(void (*teardown)(void *), void *arg);
 noreturn void exit_phase(unsigned int code);
 
 #endif
@@ -1,74 +1,226 @@
 #include "lexer.h"
 
+#include <errno.h>
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
 
-/* Create a token with a type, lexeme, line, and column range for error
- * reporting */
-static Token make_token(TokenType type,
-                        char     *lexeme,
-                        int       line,
-                        int       col_start,
-                        int       col_end,
-                        bool      heap_allocated) {
+#include "scan.h"
+
+// Wherever POSIX is, large sources are lexed in chunks on worker threads
+// and a stream is read without waiting for a full window
+#ifdef _POSIX_C_SOURCE
+#    define LEX_POSIX 1
+#    include <pthread.h>
+#    include <unistd.h>
+#endif
+
+// Starting size of a stream's window, which only grows for a longer line
+#define LEX_WINDOW ((size_t)64 * 1024)
+
+/* Create a token covering the source from offset to the current position,
+ * with its lexeme given separately since a string literal's differs */
+static Token make_token(Lexer      *lexer,
+                        TokenType   type,
+                        size_t      offset,
+                        const char *lexeme,
+                        size_t      length) {
+
+    return (Token){.type   = type,
+                   .offset = lexer->base + offset,
+                   .span   = lexer->pos - offset,
+                   .start  = lexeme,
+                   .length = length};
+}
+
+/* Create a token whose lexeme is exactly the source it covers */
+static Token lexeme_token(Lexer *lexer, TokenType type, size_t offset) {
+
+    return make_token(
+            lexer, type, offset, lexer->src + offset, lexer->pos - offset);
+}
+
+/* Error location for span bytes at offset, found through the line index
+ * only once something has gone wrong */
+static ErrorLocation locate(Lexer *lexer, size_t offset, size_t span) {
+
+    SourceSpan at =
+            source_span(lexer->source, lexer->base + offset, span, NULL);
 
-    return (Token){.type           = type,
-                   .lexeme         = lexeme,
-                   .line           = line,
-                   .column_start   = col_start,
-                   .column_end     = col_end,
-                   .heap_allocated = heap_allocated};
+    return (ErrorLocation){.file      = lexer->file_path,
+                           .line      = at.line,
+                           .col_start = at.column_start,
+                           .col_end   = at.column_end};
 }
 
+/* Reads past the end give a NUL, so the source needs no sentinel and can be
+ * a read-only mapping of the file */
 static char peek(Lexer *lexer) {
-    return lexer->src[lexer->pos];
+    return lexer->pos < lexer->len ? lexer->src[lexer->pos] : '\0';
 }
 
 static char peek_2(Lexer *lexer) {
 
     char c = peek(lexer);
 
-    return c ? lexer->src[lexer->pos + 1] : '\0';
+    return c && lexer->pos + 1 < lexer->len ? lexer->src[lexer->pos + 1]
+                                              : '\0';
 }
 
 static char advance_lexer(Lexer *lexer) {
 
     char c = peek(lexer);
 
-    if (c) {
-
+    if (c)
         lexer->pos++;
-        lexer->column++;
 
-        if (c == '\n') {
+    return c;
+}
+
+/* Most whitespace and identifier runs are only a few bytes, shorter than a
+ * call into the vector scanners costs, so they are first walked inline */
+#define SHORT_RUN 8
+
+static bool is_space(char c) {
+
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+static bool is_ident_part(char c) {
+
+    return c == '_' || (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') ||
+           (c >= '0' && c <= '9');
+}
+
+static size_t spaces_end(Lexer *lexer, size_t pos) {
+
+    for (size_t i = 0; i < SHORT_RUN; i++, pos++) {
+
+        if (pos == lexer->len || !is_space(lexer->src[pos]))
+            return pos;
+    }
+
+    return scan_spaces(lexer->src, lexer->len, pos);
+}
+
+static size_t ident_end(Lexer *lexer, size_t pos) {
+
+    for (size_t i = 0; i < SHORT_RUN; i++, pos++) {
+
+        if (pos == lexer->len || !is_ident_part(lexer->src[pos]))
+            return pos;
+    }
+
+    return scan_ident(lexer->src, lexer->len, pos);
+}
+
+/* Read up to size bytes of the stream, as many as are ready */
+static size_t read_stream(Lexer *lexer, char *into, size_t size) {
+
+#ifdef LEX_POSIX
+    ssize_t got;
+
+    do
+        got = read(fileno(lexer->stream), into, size);
+    while (got < 0 && errno == EINTR);
+
+    if (got < 0)
+        error_io(lexer->file_path);
+
+    return (size_t)got;
+#else
+    size_t got = fread(into, 1, size, lexer->stream);
 
-            lexer->line++;
-            lexer->column = 1;
+    if (got == 0 && ferror(lexer->stream))
+        error_io(lexer->file_path);
+
+    return got;
+#endif
+}
+
+/* Make the window hold the whole line at pos, or the rest of the stream.
+ * No token crosses a line break, so none is ever cut by the window's edge.
+ * Lexed text is kept for diagnostics to quote until the window fills, and
+ * the window only grows for a line longer than half of it */
+static void refill(Lexer *lexer) {
+
+    for (;;) {
+
+        if (lexer->len == lexer->cap) {
+
+            size_t keep = lexer->len - lexer->pos;
+
+            memmove(lexer->window, lexer->window + lexer->pos, keep);
+            lexer->base += lexer->pos;
+            lexer->pos   = 0;
+            lexer->len   = keep;
+
+            if (keep > lexer->cap / 2) {
+
+                size_t new_cap  = lexer->cap * 2;
+                char  *temp_ptr = realloc(lexer->window, new_cap);
+                if (!temp_ptr)
+                    error_oom();
+
+                lexer->window = temp_ptr;
+                lexer->cap    = new_cap;
+            }
+        }
+
+        char  *fresh = lexer->window + lexer->len;
+        size_t got   = read_stream(lexer, fresh, lexer->cap - lexer->len);
+
+        source_append(lexer->source, fresh, lexer->base + lexer->len, got);
+        lexer->len += got;
+
+        if (got == 0) {
+
+            lexer->safe    = lexer->len;
+            lexer->drained = true;
+            break;
+        }
+
+        size_t last = got;
+
+        while (last > 0 && fresh[last - 1] != '\n')
+            last--;
+
+        if (last > 0) {
+
+            lexer->safe = (size_t)(fresh + last - lexer->window);
+            break;
         }
     }
 
-    return c;
+    lexer->src = lexer->window;
+
+    lexer->source->text = lexer->window;
+    lexer->source->base = lexer->base;
+    lexer->source->len  = lexer->len;
 }
 
 static void ignore_ws_or_comment(Lexer *lexer) {
 
     for (;;) {
 
+        // Everything from here to the next token must be in the window
+        if (lexer->pos >= lexer->safe && lexer->stream && !lexer->drained)
+            refill(lexer);
+
         char c = peek(lexer);
 
-        while (c == ' ' || c == '\t' || c == '\r') {
+        if (is_space(c)) {
 
-            advance_lexer(lexer);
+            lexer->pos = spaces_end(lexer, lexer->pos + 1);
             c = peek(lexer);
         }
 
+        // A comment takes its line break with it
         if (c == '-' && peek_2(lexer) == '-') {
 
-            while (c && c != '\n')
-                c = advance_lexer(lexer);
-
+            lexer->pos = scan_line(lexer->src, lexer->len, lexer->pos);
+            advance_lexer(lexer);
             continue;
         }
 
@@ -81,258 +233,229 @@ static int is_ident_start(char c) {
     return (c == '_') || (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z');
 }
 
-static int is_ident_part(char c) {
-
-    return is_ident_start(c) || (c >= '0' && c <= '9');
-}
-
 /* Check if a character is a digit */
 static bool is_digit(char c) {
 
     return c >= '0' && c <= '9';
 }
 
-static Token lex_ident_or_kw(Lexer *lexer) {
+/* Confirm a keyword candidate whose length and first character already
+ * match, comparing only the remaining bytes */
+static TokenType
+match_keyword(const char *lexeme, const char *keyword, TokenType type) {
 
-    int    line      = lexer->line;
-    int    col_start = lexer->column;
-    size_t start     = lexer->pos;
+    size_t len = strlen(keyword);
 
-    advance_lexer(lexer);
+    return memcmp(lexeme + 1, keyword + 1, len - 1) == 0 ? type : TOK_VARIABLE;
+}
 
-    while (is_ident_part(peek(lexer)))
-        advance_lexer(lexer);
+/* Classify an identifier with a switch on its length and then its first
+ * character, so an identifier is compared against one keyword at most */
+static TokenType keyword_type(const char *lexeme, size_t len) {
 
-    size_t end     = lexer->pos;
-    size_t len     = end - start;
-    int    col_end = col_start + (int)len - 1;
+    switch (len) {
 
-    char *lexeme = malloc(len + 1);
+        case 2:
+            switch (lexeme[0]) {
 
-    if (!lexeme)
-        error_oom();
+                case 'i':
+                    return match_keyword(lexeme, "if", TOK_IF);
+                case 'o':
+                    return match_keyword(lexeme, "or", TOK_OR);
+            }
+            break;
+
+        case 3:
+            switch (lexeme[0]) {
+
+                case 'a':
+                    return match_keyword(lexeme, "and", TOK_AND);
+                case 'i':
+                    return match_keyword(lexeme, "int", TOK_INTEGER_T);
+                case 'l':
+                    return match_keyword(lexeme, "let", TOK_LET);
+                case 'n':
+                    return match_keyword(lexeme, "not", TOK_NOT);
+                case 'o':
+                    return match_keyword(lexeme, "out", TOK_OUT);
+                case 's':
+                    return match_keyword(lexeme, "str", TOK_STRING_T);
+            }
+            break;
+
+        case 4:
+            switch (lexeme[0]) {
+
+                case 'b':
+                    return match_keyword(lexeme, "bool", TOK_BOOLEAN_T);
+                case 'e':
+                    return match_keyword(lexeme, "else", TOK_ELSE);
+                case 'f':
+                    return match_keyword(lexeme, "func", TOK_FUNC);
+                case 't':
+                    return match_keyword(lexeme, "true", TOK_BOOLEAN_LIT);
+                case 'v':
+                    return match_keyword(lexeme, "void", TOK_VOID_T);
+            }
+            break;
+
+        case 5:
+            switch (lexeme[0]) {
+
+                case 'e':
+                    return match_keyword(lexeme, "entry", TOK_ENTRY);
+                case 'f':
+                    if (lexeme[1] == 'l')
+                        return match_keyword(lexeme, "float", TOK_FLOAT_T);
+                    return match_keyword(lexeme, "false", TOK_BOOLEAN_LIT);
+                case 'w':
+                    return match_keyword(lexeme, "while", TOK_WHILE);
+            }
+            break;
 
-    memcpy(lexeme, lexer->src + start, len);
-    lexeme[len] = '\0';
-
-    if (strcmp(lexeme, "entry") == 0)
-        return make_token(TOK_ENTRY, lexeme, line, col_start, col_end, true);
-    if (strcmp(lexeme, "func") == 0)
-        return make_token(TOK_FUNC, lexeme, line, col_start, col_end, true);
-    if (strcmp(lexeme, "return") == 0)
-        return make_token(TOK_RETURN, lexeme, line, col_start, col_end, true);
-    if (strcmp(lexeme, "out") == 0)
-        return make_token(TOK_OUT, lexeme, line, col_start, col_end, true);
-    if (strcmp(lexeme, "if") == 0)
-        return make_token(TOK_IF, lexeme, line, col_start, col_end, true);
-    if (strcmp(lexeme, "else") == 0)
-        return make_token(TOK_ELSE, lexeme, line, col_start, col_end, true);
-    if (strcmp(lexeme, "while") == 0)
-        return make_token(TOK_WHILE, lexeme, line, col_start, col_end, true);
-    if (strcmp(lexeme, "and") == 0)
-        return make_token(TOK_AND, lexeme, line, col_start, col_end, true);
-    if (strcmp(lexeme, "or") == 0)
-        return make_token(TOK_OR, lexeme, line, col_start, col_end, true);
-    if (strcmp(lexeme, "not") == 0)
-        return make_token(TOK_NOT, lexeme, line, col_start, col_end, true);
-    if (strcmp(lexeme, "while") == 0)
-        return make_token(TOK_WHILE, lexeme, line, col_start, col_end, true);
-    if (strcmp(lexeme, "let") == 0)
-        return make_token(TOK_LET, lexeme, line, col_start, col_end, true);
-    if (strcmp(lexeme, "void") == 0)
-        return make_token(TOK_VOID_T, lexeme, line, col_start, col_end, true);
-    if (strcmp(lexeme, "int") == 0)
-        return make_token(TOK_INTEGER_T,
-                          lexeme,
-                          line,
-                          col_start,
-                          col_end,
-                          true);
-    if (strcmp(lexeme, "str") == 0)
-        return make_token(TOK_STRING_T, lexeme, line, col_start, col_end, true);
-    if (strcmp(lexeme, "float") == 0)
-        return make_token(TOK_FLOAT_T, lexeme, line, col_start, col_end, true);
-    if (strcmp(lexeme, "bool") == 0)
-        return make_token(TOK_BOOLEAN_T,
-                          lexeme,
-                          line,
-                          col_start,
-                          col_end,
-                          true);
-    if (strcmp(lexeme, "true") == 0)
-        return make_token(TOK_BOOLEAN_LIT,
-                          lexeme,
-                          line,
-                          col_start,
-                          col_end,
-                          true);
-    if (strcmp(lexeme, "false") == 0)
-        return make_token(TOK_BOOLEAN_LIT,
-                          lexeme,
-                          line,
-                          col_start,
-                          col_end,
-                          true);
-
-    return make_token(TOK_VARIABLE, lexeme, line, col_start, col_end, true);
+        case 6:
+            switch (lexeme[0]) {
+
+                case 'r':
+                    return match_keyword(lexeme, "return", TOK_RETURN);
+            }
+            break;
+    }
+
+    return TOK_VARIABLE;
 }
 
-static Token lex_string(Lexer *lexer) {
+static Token lex_ident_or_kw(Lexer *lexer) {
 
-    int    line      = lexer->line;
-    int    col_start = lexer->column;
-    size_t start_pos = lexer->pos;
-    char   quote     = lexer->src[start_pos];
+    size_t start = lexer->pos;
 
-    advance_lexer(lexer);
+    lexer->pos = ident_end(lexer, start + 1);
 
-    char  *lexeme     = malloc(64);
-    size_t lexeme_len = 0;
-    size_t lexeme_cap = 64;
+    TokenType type = keyword_type(lexer->src + start, lexer->pos - start);
 
-    if (!lexeme)
-        error_oom();
+    return lexeme_token(lexer, type, start);
+}
 
-    for (;;) {
+/* Decode the escapes in a string literal's raw contents into the arena. An
+ * unknown escape becomes a lone backslash */
+static const char *
+decode_string(Lexer *lexer, const char *raw, size_t raw_len, size_t *len_out) {
 
-        char c = peek(lexer);
+    char  *decoded = arena_alloc(lexer->arena, raw_len + 1);
+    size_t len     = 0;
 
-        if (c == '\0') {
+    for (size_t i = 0; i < raw_len; i++) {
 
-            error_open_str((ErrorLocation){.file      = lexer->file_path,
-                                           .line      = line,
-                                           .col_start = col_start,
-                                           .col_end   = col_start});
-        }
+        if (raw[i] != '\\') {
 
-        if (c == '\n') {
+            decoded[len++] = raw[i];
+            continue;
+        }
 
-            int span_end = lexeme_len > 0 ? col_start + (int)lexeme_len - 1
-                                          : col_start;
-            error_open_str((ErrorLocation){.file      = lexer->file_path,
-                                           .line      = line,
-                                           .col_start = col_start,
-                                           .col_end   = span_end});
+        switch (raw[++i]) {
+
+            case 'n':
+                decoded[len++] = '\n';
+                break;
+            case 't':
+                decoded[len++] = '\t';
+                break;
+            case 'r':
+                decoded[len++] = '\r';
+                break;
+            case '\\':
+                decoded[len++] = '\\';
+                break;
+            case '"':
+                decoded[len++] = '"';
+                break;
+            case '\'':
+                decoded[len++] = '\'';
+                break;
+
+            default:
+                decoded[len++] = '\\';
+                break;
         }
+    }
 
-        if (c == quote)
-            break;
+    decoded[len] = '\0';
+    *len_out     = len;
 
-        if (c == '\\') {
+    return decoded;
+}
 
-            advance_lexer(lexer);
+/* Report a string left open. A lexer with somewhere to bail to goes there
+ * instead, leaving the report to whoever can tell it is the first error */
+static noreturn void open_string(Lexer *lexer, size_t offset, size_t span) {
 
-            char next_c = peek(lexer);
+    if (lexer->bail)
+        longjmp(*lexer->bail, 1);
 
-            if (next_c == '\0') {
+    error_open_str(locate(lexer, offset, span));
+}
 
-                error_open_str((ErrorLocation){.file      = lexer->file_path,
-                                               .line      = line,
-                                               .col_start = col_start,
-                                               .col_end   = col_start});
-            }
-            if (next_c == '\n') {
+/* Scan a string literal, its lexeme is the slice between the quotes unless
+ * it holds escapes, which are decoded into a copy */
+static Token lex_string(Lexer *lexer) {
 
-                error_open_str((ErrorLocation){.file      = lexer->file_path,
-                                               .line      = line,
-                                               .col_start = col_start,
-                                               .col_end   = col_start});
-            }
+    size_t start_pos = lexer->pos;
+    char   quote     = lexer->src[start_pos];
 
-            char escaped_char;
+    advance_lexer(lexer);
 
-            switch (next_c) {
+    size_t content_pos = lexer->pos;
+    size_t lexeme_len  = 0; // Characters once escapes are decoded
+    bool   has_escape  = false;
 
-                case 'n':
-                    escaped_char = '\n';
-                    break;
-                case 't':
-                    escaped_char = '\t';
-                    break;
-                case 'r':
-                    escaped_char = '\r';
-                    break;
-                case '\\':
-                    escaped_char = '\\';
-                    break;
-                case '"':
-                    escaped_char = '"';
-                    break;
-                case '\'':
-                    escaped_char = '\'';
-                    break;
-
-                default:
-                    escaped_char = '\\';
-                    advance_lexer(lexer);
-
-                    if (lexeme_len + 1 >= lexeme_cap) {
-                        size_t new_cap  = lexeme_cap ? lexeme_cap * 2 : 32;
-                        char  *temp_ptr = realloc(lexeme, new_cap);
-                        if (!temp_ptr) {
-                            free(lexeme);
-                            error_oom();
-                        }
-
-                        lexeme     = temp_ptr;
-                        lexeme_cap = new_cap;
-                    }
-
-                    lexeme[lexeme_len++] = escaped_char;
-                    continue;
-            }
+    for (;;) {
 
-            advance_lexer(lexer);
+        // Plain characters up to the next quote, backslash or line end
+        size_t run_end = scan_string(lexer->src, lexer->len, lexer->pos, quote);
 
-            if (lexeme_len + 1 >= lexeme_cap) {
-                size_t new_cap  = lexeme_cap ? lexeme_cap * 2 : 32;
-                char  *temp_ptr = realloc(lexeme, new_cap);
-                if (!temp_ptr) {
-                    free(lexeme);
-                    error_oom();
-                }
+        lexeme_len += run_end - lexer->pos;
+        lexer->pos  = run_end;
 
-                lexeme     = temp_ptr;
-                lexeme_cap = new_cap;
-            }
+        char c = peek(lexer);
 
-            lexeme[lexeme_len++] = escaped_char;
+        if (c == '\0')
+            open_string(lexer, start_pos, 1);
 
-        } else {
+        if (c == '\n')
+            open_string(lexer, start_pos, lexeme_len);
 
-            advance_lexer(lexer);
+        if (c == quote)
+            break;
 
-            if (lexeme_len + 1 >= lexeme_cap) {
-                size_t new_cap  = lexeme_cap ? lexeme_cap * 2 : 32;
-                char  *temp_ptr = realloc(lexeme, new_cap);
-                if (!temp_ptr) {
-                    free(lexeme);
-                    error_oom();
-                }
+        // Only a backslash is left, which always takes the next character
+        advance_lexer(lexer);
 
-                lexeme     = temp_ptr;
-                lexeme_cap = new_cap;
-            }
+        char next_c = peek(lexer);
 
-            lexeme[lexeme_len++] = c;
-        }
+        if (next_c == '\0' || next_c == '\n')
+            open_string(lexer, start_pos, 1);
+
+        advance_lexer(lexer);
+
+        has_escape = true;
+        lexeme_len++;
     }
 
-    lexeme[lexeme_len] = '\0';
+    const char *lexeme = lexer->src + content_pos;
+    size_t      length = lexer->pos - content_pos;
 
-    advance_lexer(lexer);
+    if (has_escape)
+        lexeme = decode_string(lexer, lexeme, length, &length);
 
-    int col_end = col_start + (int)(lexer->pos - start_pos) - 1;
+    advance_lexer(lexer);
 
-    return make_token(TOK_STRING_LIT, lexeme, line, col_start, col_end, true);
+    return make_token(lexer, TOK_STRING_LIT, start_pos, lexeme, length);
 }
 
 static Token lex_number(Lexer *lexer) {
 
-    int    line      = lexer->line;
-    int    col_start = lexer->column;
-    size_t start     = lexer->pos;
-    bool   is_float  = false;
+    size_t start    = lexer->pos;
+    bool   is_float = false;
 
     while (is_digit(peek(lexer)))
         advance_lexer(lexer);
@@ -346,191 +469,155 @@ static Token lex_number(Lexer *lexer) {
             advance_lexer(lexer);
     }
 
-    size_t end     = lexer->pos;
-    size_t len     = end - start;
-    int    col_end = col_start + (int)len - 1;
-    char  *lexeme  = malloc(len + 1);
+    TokenType type = is_float ? TOK_FLOAT_LIT : TOK_INTEGER_LIT;
+
+    return lexeme_token(lexer, type, start);
+}
+
+/* Consume the next character when it is the expected one */
+static bool match_char(Lexer *lexer, char expected) {
+
+    if (peek(lexer) != expected)
+        return false;
 
-    if (!lexeme)
+    advance_lexer(lexer);
+
+    return true;
+}
+
+Lexer init_lexer(Source *source, const char *file_path, Arena *arena) {
+
+    return (Lexer){.src       = source->text,
+                   .len       = source->len,
+                   .pos       = 0,
+                   .source    = source,
+                   .file_path = file_path,
+                   .arena     = arena,
+                   .bail      = NULL,
+                   .stream    = NULL,
+                   .safe      = source->len};
+}
+
+/* Lex a source as it is read from stream, which the lexer takes over, with
+ * only a window of it in memory. source starts empty and is indexed as the
+ * stream arrives */
+Lexer init_stream_lexer(Source     *source,
+                        FILE       *stream,
+                        const char *file_path,
+                        Arena      *arena) {
+
+    char *window = malloc(LEX_WINDOW);
+    if (!window)
         error_oom();
 
-    memcpy(lexeme, lexer->src + start, len);
+    init_source(source, NULL, 0);
+
+    return (Lexer){.src       = window,
+                   .len       = 0,
+                   .pos       = 0,
+                   .source    = source,
+                   .file_path = file_path,
+                   .arena     = arena,
+                   .bail      = NULL,
+                   .stream    = stream,
+                   .window    = window,
+                   .cap       = LEX_WINDOW,
+                   .base      = 0,
+                   .safe      = 0,
+                   .drained   = false};
+}
 
-    lexeme[len]    = '\0';
-    TokenType type = is_float ? TOK_FLOAT_LIT : TOK_INTEGER_LIT;
+/* Release a stream lexer's window and stream. The source stops quoting
+ * lines from the window with it */
+void free_lexer(Lexer *lexer) {
+
+    if (!lexer->stream)
+        return;
+
+    fclose(lexer->stream);
+    free(lexer->window);
 
-    return make_token(type, lexeme, line, col_start, col_end, true);
+    lexer->source->text = NULL;
+    lexer->source->len  = 0;
+    lexer->stream       = NULL;
+    lexer->window       = NULL;
 }
 
 Token next_token(Lexer *lexer) {
 
     ignore_ws_or_comment(lexer);
 
-    char c = peek(lexer);
+    size_t start = lexer->pos;
+    char   c     = peek(lexer);
 
-    switch (c) {
-
-        case '\0':
-            return make_token(TOK_EOF,
-                              NULL,
-                              lexer->line,
-                              lexer->column,
-                              lexer->column,
-                              false);
-        case '\n': {
-            int line = lexer->line;
-            int col  = lexer->column;
-            advance_lexer(lexer);
-            return make_token(TOK_NEWLINE, "\\n", line, col, col, false);
-        }
-        case '{': {
-            int col = lexer->column;
-            advance_lexer(lexer);
-            return make_token(TOK_LBRACE, "{", lexer->line, col, col, false);
-        }
-        case '}': {
-            int col = lexer->column;
-            advance_lexer(lexer);
-            return make_token(TOK_RBRACE, "}", lexer->line, col, col, false);
-        }
-        case '(': {
-            int col = lexer->column;
-            advance_lexer(lexer);
-            return make_token(TOK_LPAREN, "(", lexer->line, col, col, false);
-        }
-        case ')': {
-            int col = lexer->column;
-            advance_lexer(lexer);
-            return make_token(TOK_RPAREN, ")", lexer->line, col, col, false);
-        }
-        case ',': {
-            int col = lexer->column;
-            advance_lexer(lexer);
-            return make_token(TOK_COMMA, ",", lexer->line, col, col, false);
-        }
-        case ':': {
-            int col = lexer->column;
-            advance_lexer(lexer);
-            return make_token(TOK_COLON, ":", lexer->line, col, col, false);
-        }
-        case '=': {
-            int col = lexer->column;
-            advance_lexer(lexer);
-            if (peek(lexer) == '=') {
-                advance_lexer(lexer);
-                return make_token(TOK_EQUAL_EQUAL,
-                                  "==",
-                                  lexer->line,
-                                  col,
-                                  col + 1,
-                                  false);
-            }
-            return make_token(TOK_ASSIGN, "=", lexer->line, col, col, false);
-        }
-        case '+': {
-            int col = lexer->column;
-            advance_lexer(lexer);
-            if (peek(lexer) == '=') {
-                advance_lexer(lexer);
-                return make_token(TOK_PLUS_EQ,
-                                  "+=",
-                                  lexer->line,
-                                  col,
-                                  col + 1,
-                                  false);
-            }
-            return make_token(TOK_ADD, "+", lexer->line, col, col, false);
-        }
-        case '-': {
-            int col = lexer->column;
-            advance_lexer(lexer);
-            if (peek(lexer) == '=') {
-                advance_lexer(lexer);
-                return make_token(TOK_MINUS_EQ,
-                                  "-=",
-                                  lexer->line,
-                                  col,
-                                  col + 1,
-                                  false);
-            }
-            return make_token(TOK_SUBTRACT, "-", lexer->line, col, col, false);
-        }
-        case '*': {
-            int col = lexer->column;
-            advance_lexer(lexer);
-            if (peek(lexer) == '=') {
-                advance_lexer(lexer);
-                return make_token(TOK_STAR_EQ,
-                                  "*=",
-                                  lexer->line,
-                                  col,
-                                  col + 1,
-                                  false);
-            }
-            return make_token(TOK_MULTIPLY, "*", lexer->line, col, col, false);
-        }
-        case '/': {
-            int col = lexer->column;
-            advance_lexer(lexer);
-            if (peek(lexer) == '=') {
-                advance_lexer(lexer);
-                return make_token(TOK_SLASH_EQ,
-                                  "/=",
-                                  lexer->line,
-                                  col,
-                                  col + 1,
-                                  false);
-            }
-            return make_token(TOK_DIVIDE, "/", lexer->line, col, col, false);
-        }
-        case '!': {
-            int col = lexer->column;
-            advance_lexer(lexer);
-            return make_token(TOK_BANG, "!", lexer->line, col, col, false);
-        }
-        case '<': {
-            int col = lexer->column;
-            advance_lexer(lexer);
-            if (peek(lexer) == '=') {
-                advance_lexer(lexer);
-                return make_token(TOK_LESS_EQUAL,
-                                  "<=",
-                                  lexer->line,
-                                  col,
-                                  col + 1,
-                                  false);
-            }
-            return make_token(TOK_LESS, "<", lexer->line, col, col, false);
-        }
-        case '>': {
-            int col = lexer->column;
-            advance_lexer(lexer);
-            if (peek(lexer) == '=') {
-                advance_lexer(lexer);
-                return make_token(TOK_GREATER_EQUAL,
-                                  ">=",
-                                  lexer->line,
-                                  col,
-                                  col + 1,
-                                  false);
-            }
-            return make_token(TOK_GREATER, ">", lexer->line, col, col, false);
-        }
-        case '"':
-            return lex_string(lexer);
-        case '\'':
-            return lex_string(lexer);
-    }
+    if (c == '\0')
+        return lexeme_token(lexer, TOK_EOF, start);
 
+    if (c == '"' || c == '\'')
+        return lex_string(lexer);
     if (is_ident_start(c))
         return lex_ident_or_kw(lexer);
     if (is_digit(c))
         return lex_number(lexer);
 
-    int col = lexer->column;
     advance_lexer(lexer);
 
-    return make_token(TOK_UNKNOWN, NULL, lexer->line, col, col, false);
+    switch (c) {
+
+        case '\n':
+            return lexeme_token(lexer, TOK_NEWLINE, start);
+        case '{':
+            return lexeme_token(lexer, TOK_LBRACE, start);
+        case '}':
+            return lexeme_token(lexer, TOK_RBRACE, start);
+        case '(':
+            return lexeme_token(lexer, TOK_LPAREN, start);
+        case ')':
+            return lexeme_token(lexer, TOK_RPAREN, start);
+        case ',':
+            return lexeme_token(lexer, TOK_COMMA, start);
+        case ':':
+            return lexeme_token(lexer, TOK_COLON, start);
+        case '!':
+            return lexeme_token(lexer, TOK_BANG, start);
+        case '=':
+            if (match_char(lexer, '='))
+                return lexeme_token(lexer, TOK_EQUAL_EQUAL, start);
+            return lexeme_token(lexer, TOK_ASSIGN, start);
+        case '+':
+            if (match_char(lexer, '='))
+                return lexeme_token(lexer, TOK_PLUS_EQ, start);
+            return lexeme_token(lexer, TOK_ADD, start);
+        case '-':
+            if (match_char(lexer, '='))
+                return lexeme_token(lexer, TOK_MINUS_EQ, start);
+            return lexeme_token(lexer, TOK_SUBTRACT, start);
+        case '*':
+            if (match_char(lexer, '='))
+                return lexeme_token(lexer, TOK_STAR_EQ, start);
+            return lexeme_token(lexer, TOK_MULTIPLY, start);
+        case '/':
+            if (match_char(lexer, '='))
+                return lexeme_token(lexer, TOK_SLASH_EQ, start);
+            return lexeme_token(lexer, TOK_DIVIDE, start);
+        case '<':
+            if (match_char(lexer, '='))
+                return lexeme_token(lexer, TOK_LESS_EQUAL, start);
+            return lexeme_token(lexer, TOK_LESS, start);
+        case '>':
+            if (match_char(lexer, '='))
+                return lexeme_token(lexer, TOK_GREATER_EQUAL, start);
+            return lexeme_token(lexer, TOK_GREATER, start);
+    }
+
+    return lexeme_token(lexer, TOK_UNKNOWN, start);
+}
+
+/* Continue lexing from offset in the source, to lex part of it again. A
+ * stream can only go back as far as the start of its window */
+void seek_lexer(Lexer *lexer, size_t offset) {
+
+    lexer->pos = offset - lexer->base;
 }
 
 /* Get token type name for displaying in token mode */
@@ -593,3 +680,368 @@ const char *get_token_name(TokenType type) {
 
     return "INVALID";
 }
+
+/* Resize one of the token buffer's arrays, failing the compile if it can't */
+static void *resize_array(void *items, size_t cap, size_t elem_size) {
+
+    void *temp_ptr = realloc(items, cap * elem_size);
+    if (!temp_ptr)
+        error_oom();
+
+    return temp_ptr;
+}
+
+static void push_decoded(TokenBuffer *tokens, size_t index, Token token) {
+
+    if (tokens->decoded_count + 1 > tokens->decoded_cap) {
+
+        size_t new_cap = tokens->decoded_cap ? tokens->decoded_cap * 2 : 16;
+
+        tokens->decoded     = resize_array(tokens->decoded,
+                                       new_cap,
+                                       sizeof(DecodedString));
+        tokens->decoded_cap = new_cap;
+    }
+
+    tokens->decoded[tokens->decoded_count++] = (DecodedString){
+            .index = index, .text = token.start, .length = token.length};
+}
+
+static void push_token(TokenBuffer *tokens, Token token, size_t line) {
+
+    if (tokens->count + 1 > tokens->cap) {
+
+        size_t new_cap = tokens->cap ? tokens->cap * 2 : 256;
+
+        tokens->types = resize_array(tokens->types, new_cap, sizeof(uint8_t));
+        tokens->offsets =
+                resize_array(tokens->offsets, new_cap, sizeof(uint32_t));
+        tokens->lengths =
+                resize_array(tokens->lengths, new_cap, sizeof(uint32_t));
+        tokens->lines = resize_array(tokens->lines, new_cap, sizeof(uint32_t));
+        tokens->cap   = new_cap;
+    }
+
+    size_t index = tokens->count++;
+
+    tokens->types[index]   = (uint8_t)token.type;
+    tokens->offsets[index] = (uint32_t)token.offset;
+    tokens->lengths[index] = (uint32_t)token.span;
+    tokens->lines[index]   = (uint32_t)line;
+
+    // Every other lexeme can be found again from the offset
+    if (token.type == TOK_STRING_LIT &&
+        token.start != tokens->source->text + token.offset + 1)
+        push_decoded(tokens, index, token);
+}
+
+/* Lex the rest of the source into tokens. Decoded strings stay in the
+ * lexer's arena and lexemes point into its source, so both must outlive
+ * the buffer */
+void lex_tokens(Lexer *lexer, TokenBuffer *tokens) {
+
+    // Offsets and lengths are kept in 32 bits
+    if (lexer->len > UINT32_MAX)
+        error_complexity();
+
+    *tokens = (TokenBuffer){.source = lexer->source};
+
+    // The first lookup searches, a chunk's lexer starts mid-source
+    size_t line_hint = SIZE_MAX;
+
+    for (;;) {
+
+        Token token = next_token(lexer);
+
+        source_span(lexer->source, token.offset, token.span, &line_hint);
+        push_token(tokens, token, line_hint);
+
+        if (token.type == TOK_EOF)
+            break;
+    }
+}
+
+/* Below this many bytes a chunk costs more to hand to a thread than to lex */
+#define MIN_CHUNK ((size_t)256 * 1024)
+
+typedef struct {
+
+    Lexer       lexer; // Bounded to the chunk, allocating from arena
+    Arena       arena;
+    TokenBuffer tokens;
+    jmp_buf     bail;
+    bool        failed;
+
+} LexChunk;
+
+static void *lex_chunk(void *arg) {
+
+    LexChunk *chunk = arg;
+
+    chunk->lexer.arena = &chunk->arena;
+    chunk->lexer.bail  = &chunk->bail;
+
+    if (setjmp(chunk->bail))
+        chunk->failed = true;
+    else
+        lex_tokens(&chunk->lexer, &chunk->tokens);
+
+    return NULL;
+}
+
+static size_t online_cpus(void) {
+
+#ifdef LEX_POSIX
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+
+    return count > 0 ? (size_t)count : 1;
+#else
+    return 1;
+#endif
+}
+
+/* Lex every chunk, all but the first on threads of their own. Without
+ * threads, or if one can't be started, chunks are lexed here instead */
+static void lex_chunks(LexChunk *chunks, size_t count) {
+
+#ifdef LEX_POSIX
+    pthread_t *threads = calloc(count, sizeof(pthread_t));
+    bool      *started = calloc(count, sizeof(bool));
+    if (!threads || !started)
+        error_oom();
+
+    for (size_t i = 1; i < count; i++)
+        started[i] =
+                pthread_create(&threads[i], NULL, lex_chunk, &chunks[i]) == 0;
+
+    lex_chunk(&chunks[0]);
+
+    for (size_t i = 1; i < count; i++) {
+
+        if (started[i])
+            pthread_join(threads[i], NULL);
+        else
+            lex_chunk(&chunks[i]);
+    }
+
+    free(threads);
+    free(started);
+#else
+    for (size_t i = 0; i < count; i++)
+        lex_chunk(&chunks[i]);
+#endif
+}
+
+/* Append a chunk's tokens up to, not including, its EOF */
+static void append_chunk(TokenBuffer *tokens, const TokenBuffer *chunk) {
+
+    size_t count = chunk->count - 1;
+    size_t base  = tokens->count;
+
+    memcpy(tokens->types + base, chunk->types, count * sizeof(uint8_t));
+    memcpy(tokens->offsets + base, chunk->offsets, count * sizeof(uint32_t));
+    memcpy(tokens->lengths + base, chunk->lengths, count * sizeof(uint32_t));
+    memcpy(tokens->lines + base, chunk->lines, count * sizeof(uint32_t));
+
+    tokens->count += count;
+
+    for (size_t i = 0; i < chunk->decoded_count; i++) {
+
+        DecodedString decoded = chunk->decoded[i];
+        Token         token   = {.type   = TOK_STRING_LIT,
+                                 .start  = decoded.text,
+                                 .length = decoded.length};
+
+        push_decoded(tokens, base + decoded.index, token);
+    }
+}
+
+/* Lex like lex_tokens(), splitting a large source into one chunk per job,
+ * or per CPU when jobs is 0. Strings and comments never cross a line break,
+ * so every line starts the lexer afresh and chunks end just after one.
+ * Offsets and lines already index the whole source, so the chunks' tokens
+ * are joined as they are. If any chunk fails, the source is lexed again in
+ * one piece, which reports the first error exactly as before */
+void lex_tokens_parallel(Lexer *lexer, TokenBuffer *tokens, size_t jobs) {
+
+    size_t begin = lexer->pos;
+    size_t size  = lexer->len - begin;
+    size_t count = jobs ? jobs : online_cpus();
+
+    if (count > size / MIN_CHUNK)
+        count = size / MIN_CHUNK;
+
+    if (count < 2 || lexer->len > UINT32_MAX) {
+
+        lex_tokens(lexer, tokens);
+        return;
+    }
+
+    // Pick the scanners now, rather than have every thread race to
+    scan_impl_name();
+
+    LexChunk *chunks = calloc(count, sizeof(LexChunk));
+    if (!chunks)
+        error_oom();
+
+    size_t start = begin;
+
+    for (size_t i = 0; i < count; i++) {
+
+        size_t end = lexer->len;
+
+        if (i + 1 < count) {
+
+            size_t target = begin + size / count * (i + 1);
+            if (target < start)
+                target = start;
+
+            const char *nl =
+                    memchr(lexer->src + target, '\n', lexer->len - target);
+
+            end = nl ? (size_t)(nl - lexer->src) + 1 : lexer->len;
+        }
+
+        chunks[i].lexer     = *lexer;
+        chunks[i].lexer.pos = start;
+        chunks[i].lexer.len = end;
+        start               = end;
+    }
+
+    lex_chunks(chunks, count);
+
+    size_t total  = 0;
+    size_t used   = 0;
+    bool   failed = false;
+
+    // A NUL ends the source early, so nothing after its chunk counts
+    while (used < count) {
+
+        LexChunk *chunk = &chunks[used++];
+
+        if (chunk->failed) {
+
+            failed = true;
+            break;
+        }
+
+        size_t eof  = chunk->tokens.count - 1;
+        total      += eof;
+
+        if (chunk->tokens.offsets[eof] < chunk->lexer.len)
+            break;
+    }
+
+    if (!failed) {
+
+        *tokens = (TokenBuffer){.source = lexer->source,
+                                .cap    = total + 1};
+
+        tokens->types   = resize_array(NULL, total + 1, sizeof(uint8_t));
+        tokens->offsets = resize_array(NULL, total + 1, sizeof(uint32_t));
+        tokens->lengths = resize_array(NULL, total + 1, sizeof(uint32_t));
+        tokens->lines   = resize_array(NULL, total + 1, sizeof(uint32_t));
+
+        for (size_t i = 0; i < used; i++)
+            append_chunk(tokens, &chunks[i].tokens);
+
+        // The EOF is the last chunk's, at the end or at its NUL
+        const TokenBuffer *last = &chunks[used - 1].tokens;
+        size_t             eof  = last->count - 1;
+
+        push_token(tokens, token_at(last, eof), last->lines[eof]);
+
+        lexer->pos = chunks[used - 1].lexer.pos;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+
+        if (failed)
+            arena_free(&chunks[i].arena);
+        else
+            arena_adopt(lexer->arena, &chunks[i].arena);
+
+        free_tokens(&chunks[i].tokens);
+    }
+
+    free(chunks);
+
+    if (failed)
+        lex_tokens(lexer, tokens);
+}
+
+static const DecodedString *find_decoded(const TokenBuffer *tokens,
+                                         size_t             index) {
+
+    size_t low  = 0;
+    size_t high = tokens->decoded_count;
+
+    while (low < high) {
+
+        size_t mid = low + (high - low) / 2;
+
+        if (tokens->decoded[mid].index < index)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+
+    if (low < tokens->decoded_count && tokens->decoded[low].index == index)
+        return &tokens->decoded[low];
+
+    return NULL;
+}
+
+/* Rebuild the token at index as next_token() returned it */
+Token token_at(const TokenBuffer *tokens, size_t index) {
+
+    TokenType   type   = (TokenType)tokens->types[index];
+    size_t      offset = tokens->offsets[index];
+    size_t      span   = tokens->lengths[index];
+    const char *start  = tokens->source->text + offset;
+    size_t      length = span;
+
+    if (type == TOK_STRING_LIT) {
+
+        const DecodedString *decoded = find_decoded(tokens, index);
+
+        if (decoded) {
+
+            start  = decoded->text;
+            length = decoded->length;
+
+        } else {
+
+            start  += 1;
+            length -= 2;
+        }
+    }
+
+    return (Token){.type   = type,
+                   .offset = offset,
+                   .span   = span,
+                   .start  = start,
+                   .length = length};
+}
+
+/* Locate the token at index, its stored line makes this O(1) */
+SourceSpan token_span(const TokenBuffer *tokens, size_t index) {
+
+    size_t line = tokens->lines[index];
+
+    return source_span(tokens->source,
+                       tokens->offsets[index],
+                       tokens->lengths[index],
+                       &line);
+}
+
+void free_tokens(TokenBuffer *tokens) {
+
+    free(tokens->types);
+    free(tokens->offsets);
+    free(tokens->lengths);
+    free(tokens->lines);
+    free(tokens->decoded);
+
+    *tokens = (TokenBuffer){0};
+}
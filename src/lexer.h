@@ -1,10 +1,15 @@
 #ifndef LEXER_H
 #define LEXER_H
 
+#include <setjmp.h>
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
 
+#include "arena.h"
 #include "errors.h"
+#include "source.h"
 
 typedef enum {
 
@@ -56,28 +61,85 @@ typedef enum {
 
 } TokenType;
 
+/* A token covers span bytes of the source from offset, and the source's line
+ * index gives its line and columns. The lexeme is a slice of the source that
+ * is not terminated. String literals point at their contents between the
+ * quotes, or at a decoded copy in the arena when they contain escapes */
 typedef struct {
 
-    TokenType type;
-    char     *lexeme;
-    int       line;
-    int       column_start;
-    int       column_end;
-    bool      heap_allocated;
+    TokenType   type;
+    size_t      offset;
+    size_t      span;
+    const char *start;
+    size_t      length;
 
 } Token;
 
 typedef struct {
 
-    const char *src;
+    const char *src; // The source's text, not NUL-terminated
+    size_t      len;
     size_t      pos;
-    int         line;
-    int         column;
+    Source     *source;
     const char *file_path;
+    Arena      *arena; // Owns decoded string literals
+    jmp_buf    *bail;  // Taken on an error instead of reporting it, if set
+
+    // A streamed source is read into window as lexing goes, and src is the
+    // window. Positions are within it, base is its offset in the source
+    // and every line before safe is complete
+    FILE  *stream;
+    char  *window;
+    size_t cap;
+    size_t base;
+    size_t safe;
+    bool   drained;
 
 } Lexer;
 
+// A string literal whose lexeme had escapes decoded into a copy
+typedef struct {
+
+    size_t      index; // Of the token in the buffer
+    const char *text;
+    size_t      length;
+
+} DecodedString;
+
+/* The whole token stream lexed up front into parallel arrays, so tokens can
+ * be indexed instead of pulled one at a time. A token's lexeme is the source
+ * it covers, or for a string literal the slice inside its quotes, unless the
+ * string is listed in decoded. Only a lexer over a loaded source, not a
+ * stream, can fill one */
+typedef struct {
+
+    const Source *source;
+    uint8_t      *types;   // TokenType of each token
+    uint32_t     *offsets; // First source byte
+    uint32_t     *lengths; // Source bytes covered, quotes included
+    uint32_t     *lines;   // Line of the first byte, counted from 0
+    size_t        count;   // Every token through the closing EOF
+    size_t        cap;
+
+    DecodedString *decoded; // In token order
+    size_t         decoded_count, decoded_cap;
+
+} TokenBuffer;
+
+Lexer       init_lexer(Source *source, const char *file_path, Arena *arena);
+Lexer       init_stream_lexer(Source     *source,
+                              FILE       *stream,
+                              const char *file_path,
+                              Arena      *arena);
+void        free_lexer(Lexer *lexer);
 Token       next_token(Lexer *lexer);
+void        seek_lexer(Lexer *lexer, size_t offset);
 const char *get_token_name(TokenType type);
 
+void       lex_tokens(Lexer *lexer, TokenBuffer *tokens);
+void       lex_tokens_parallel(Lexer *lexer, TokenBuffer *tokens, size_t jobs);
+Token      token_at(const TokenBuffer *tokens, size_t index);
+SourceSpan token_span(const TokenBuffer *tokens, size_t index);
+void       free_tokens(TokenBuffer *tokens);
+
 #endif
@@ -3,9 +3,19 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "checker.h"
 #include "codegen.h"
 #include "colours.h"
 #include "errors.h"
+#include "verifier.h"
+#include "watch.h"
+
+// Regular source files are mapped rather than read wherever POSIX is
+#ifdef _POSIX_C_SOURCE
+#    define PHASE_MMAP 1
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#endif
 
 static void indent(int n) {
     for (int i = 0; i < n; i++)
@@ -18,12 +28,93 @@ static void set_branch_glyph(bool unicode) {
     branch_glyph = unicode ? "╰" : ">";
 }
 
-static void print_block(AstBlock *block, int ind);
-static void print_expression(AstExpression *expression, int ind);
-static void print_statement(AstStatement *statement, int ind);
-static void print_declaration(AstDeclaration *declare, int ind);
+/* A node still to be printed, or a line naming the block that follows */
+typedef enum {
+
+    PRINT_EXPRESSION,
+    PRINT_STATEMENT,
+    PRINT_BLOCK,
+    PRINT_LABEL
+
+} PrintKind;
+
+typedef struct {
+
+    PrintKind kind;
+    int       ind;
+
+    union {
+
+        AstExpression *expression;
+        AstStatement  *statement;
+        AstBlock      *block;
+        const char    *label;
+
+    } node;
+
+} PrintItem;
+
+/* Nodes waiting to be printed, the next on top. Each node prints its own
+ * line and pushes its children in reverse, so however deep the source
+ * nests, the tree is printed in order without recursing */
+typedef struct {
+
+    PrintItem *items;
+    size_t     count;
+    size_t     cap;
+
+} PrintStack;
+
+static void push_item(PrintStack *stack, PrintItem item) {
 
-static void print_expression(AstExpression *expression, int ind) {
+    if (stack->count + 1 > stack->cap) {
+
+        size_t new_cap  = stack->cap ? stack->cap * 2 : 64;
+        void  *temp_ptr = realloc(stack->items, new_cap * sizeof(PrintItem));
+        if (!temp_ptr) {
+            free(stack->items);
+            error_oom();
+        }
+
+        stack->items = temp_ptr;
+        stack->cap   = new_cap;
+    }
+
+    stack->items[stack->count++] = item;
+}
+
+static void
+push_expression(PrintStack *stack, AstExpression *expression, int ind) {
+
+    push_item(stack,
+              (PrintItem){.kind            = PRINT_EXPRESSION,
+                          .ind             = ind,
+                          .node.expression = expression});
+}
+
+static void
+push_statement(PrintStack *stack, AstStatement *statement, int ind) {
+
+    push_item(stack,
+              (PrintItem){.kind           = PRINT_STATEMENT,
+                          .ind            = ind,
+                          .node.statement = statement});
+}
+
+static void push_block(PrintStack *stack, AstBlock *block, int ind) {
+
+    push_item(stack,
+              (PrintItem){.kind = PRINT_BLOCK, .ind = ind, .node.block = block});
+}
+
+static void push_label(PrintStack *stack, const char *label, int ind) {
+
+    push_item(stack,
+              (PrintItem){.kind = PRINT_LABEL, .ind = ind, .node.label = label});
+}
+
+static void
+print_expression(PrintStack *stack, AstExpression *expression, int ind) {
 
     switch (expression->tag) {
 
@@ -103,10 +194,8 @@ static void print_expression(AstExpression *expression, int ind) {
                    expression->call.func_name,
                    RESET);
 
-            for (size_t i = 0; i < expression->call.arg_count; i++) {
-
-                print_expression(expression->call.args[i], ind + 6);
-            }
+            for (size_t i = expression->call.arg_count; i > 0; i--)
+                push_expression(stack, expression->call.args[i - 1], ind + 6);
 
         } break;
 
@@ -124,8 +213,8 @@ static void print_expression(AstExpression *expression, int ind) {
                    : expression->binary.op == TOK_DIVIDE   ? "/"
                                                            : "?",
                    RESET);
-            print_expression(expression->binary.left, ind + 6);
-            print_expression(expression->binary.right, ind + 6);
+            push_expression(stack, expression->binary.right, ind + 6);
+            push_expression(stack, expression->binary.left, ind + 6);
 
         } break;
 
@@ -142,13 +231,14 @@ static void print_expression(AstExpression *expression, int ind) {
                            ? "!"
                            : "-",
                    RESET);
-            print_expression(expression->unary.expr, ind + 6);
+            push_expression(stack, expression->unary.expr, ind + 6);
 
         } break;
     }
 }
 
-static void print_statement(AstStatement *statement, int ind) {
+static void
+print_statement(PrintStack *stack, AstStatement *statement, int ind) {
 
     switch (statement->tag) {
 
@@ -156,7 +246,7 @@ static void print_statement(AstStatement *statement, int ind) {
 
             indent(ind);
             printf("%s STATEMENT (%sOUT%s)\n", branch_glyph, FG_CYAN, RESET);
-            print_expression(statement->out.expression, ind + 6);
+            push_expression(stack, statement->out.expression, ind + 6);
 
         } break;
 
@@ -170,7 +260,7 @@ static void print_statement(AstStatement *statement, int ind) {
                    FG_PURPLE,
                    statement->assign.var_name,
                    RESET);
-            print_expression(statement->assign.expression, ind + 6);
+            push_expression(stack, statement->assign.expression, ind + 6);
 
         } break;
 
@@ -204,10 +294,10 @@ static void print_statement(AstStatement *statement, int ind) {
 
             printf("]\n");
 
-            for (size_t i = 0; i < statement->var_decl.init_count; i++) {
-
-                print_expression(statement->var_decl.init_exprs[i], ind + 6);
-            }
+            for (size_t i = statement->var_decl.init_count; i > 0; i--)
+                push_expression(stack,
+                                statement->var_decl.init_exprs[i - 1],
+                                ind + 6);
 
         } break;
 
@@ -216,7 +306,7 @@ static void print_statement(AstStatement *statement, int ind) {
             indent(ind);
             printf("%s STATEMENT (%sRETURN%s)\n", branch_glyph, FG_CYAN, RESET);
             if (statement->ret.expression)
-                print_expression(statement->ret.expression, ind + 6);
+                push_expression(stack, statement->ret.expression, ind + 6);
 
         } break;
 
@@ -224,7 +314,7 @@ static void print_statement(AstStatement *statement, int ind) {
 
             indent(ind);
             printf("%s STATEMENT (%sEXPR%s)\n", branch_glyph, FG_CYAN, RESET);
-            print_expression(statement->expr.expression, ind + 6);
+            push_expression(stack, statement->expr.expression, ind + 6);
 
         } break;
 
@@ -232,40 +322,73 @@ static void print_statement(AstStatement *statement, int ind) {
 
             indent(ind);
             printf("%s STATEMENT (%sIF%s)\n", branch_glyph, FG_CYAN, RESET);
-            print_expression(statement->if_stmt.condition, ind + 6);
-            indent(ind + 6);
-            printf("%s THEN\n", branch_glyph);
-            print_block(statement->if_stmt.then_block, ind + 6);
 
             if (statement->if_stmt.else_block) {
 
-                indent(ind + 6);
-                printf("%s ELSE\n", branch_glyph);
-                print_block(statement->if_stmt.else_block, ind + 6);
+                push_block(stack, statement->if_stmt.else_block, ind + 6);
+                push_label(stack, "ELSE", ind + 6);
             }
 
+            push_block(stack, statement->if_stmt.then_block, ind + 6);
+            push_label(stack, "THEN", ind + 6);
+            push_expression(stack, statement->if_stmt.condition, ind + 6);
+
         } break;
 
         case STM_WHILE: {
 
             indent(ind);
             printf("%s STATEMENT (%sWHILE%s)\n", branch_glyph, FG_CYAN, RESET);
-            print_expression(statement->if_stmt.condition, ind + 6);
-            indent(ind + 6);
-            printf("%s BODY\n", branch_glyph);
-            print_block(statement->if_stmt.then_block, ind + 6);
+            push_block(stack, statement->if_stmt.then_block, ind + 6);
+            push_label(stack, "BODY", ind + 6);
+            push_expression(stack, statement->if_stmt.condition, ind + 6);
 
         } break;
     }
 }
 
+/* Print a block and everything nested in it off one stack */
 static void print_block(AstBlock *block, int ind) {
 
-    indent(ind);
-    printf("%s BLOCK\n", branch_glyph);
+    PrintStack stack = {0};
+
+    push_block(&stack, block, ind);
+
+    while (stack.count > 0) {
+
+        PrintItem item = stack.items[--stack.count];
+
+        switch (item.kind) {
+
+            case PRINT_EXPRESSION:
+                print_expression(&stack, item.node.expression, item.ind);
+                break;
+
+            case PRINT_STATEMENT:
+                print_statement(&stack, item.node.statement, item.ind);
+                break;
+
+            case PRINT_BLOCK: {
+
+                indent(item.ind);
+                printf("%s BLOCK\n", branch_glyph);
+
+                AstBlock *block = item.node.block;
+
+                for (size_t i = block->len; i > 0; i--)
+                    push_statement(
+                            &stack, block->statements[i - 1], item.ind + 6);
+
+            } break;
 
-    for (size_t i = 0; i < block->len; i++)
-        print_statement(block->statements[i], ind + 6);
+            case PRINT_LABEL:
+                indent(item.ind);
+                printf("%s %s\n", branch_glyph, item.node.label);
+                break;
+        }
+    }
+
+    free(stack.items);
 }
 
 static void print_declaration(AstDeclaration *declare, int ind) {
@@ -376,28 +499,38 @@ static void print_program(AstProgram *program) {
     exit_phase(2);
 }
 
-static void display_tokens(Lexer *lexer) {
+static void print_token(Token token, SourceSpan at) {
 
-    for (;;) {
+    printf("%d | ", at.line); // Display line num
+    printf("%s%s%s",
+           FG_CYAN,
+           get_token_name(token.type),
+           RESET); // Display token type
+
+    if (token.type == TOK_NEWLINE)
+        printf(" %s'\\n'%s", FG_PURPLE, RESET);
+    else if (token.type != TOK_EOF && token.type != TOK_UNKNOWN)
+        printf(" %s'%.*s'%s",
+               FG_PURPLE,
+               (int)token.length,
+               token.start,
+               RESET); // Display the lexeme
 
-        Token token = next_token(lexer);
+    printf("\n");
+}
 
-        printf("%d | ", token.line); // Display line num
-        printf("%s%s%s",
-               FG_CYAN,
-               get_token_name(token.type),
-               RESET); // Display token type
+static void display_tokens(Lexer *lexer) {
 
-        if (token.lexeme)
-            printf(" %s'%s'%s",
-                   FG_PURPLE,
-                   token.lexeme,
-                   RESET); // Display the lexeme
+    size_t line_hint = 0;
+
+    for (;;) {
+
+        Token      token = next_token(lexer);
+        SourceSpan at    = source_span(
+                lexer->source, token.offset, token.span, &line_hint);
 
-        printf("\n");
+        print_token(token, at);
 
-        if (token.lexeme && token.heap_allocated)
-            free(token.lexeme);
         if (token.type == TOK_EOF)
             break;
     }
@@ -405,6 +538,38 @@ static void display_tokens(Lexer *lexer) {
     exit_phase(2);
 }
 
+/* Dump a token buffer that has already been lexed, from its arrays */
+static void display_token_buffer(const TokenBuffer *tokens) {
+
+    for (size_t i = 0; i < tokens->count; i++)
+        print_token(token_at(tokens, i), token_span(tokens, i));
+
+    exit_phase(2);
+}
+
+/* Summarise what the compiler produced, on stderr so program output stays
+ * clean */
+static void print_stats(const Emitter *emitter) {
+
+    fprintf(stderr, "%sCompile stats%s\n", FG_BLUE_BOLD, RESET);
+    fprintf(stderr,
+            "  Constants:    %zu (%zu duplicates removed)\n",
+            emitter->const_count,
+            emitter->const_dupes);
+    fprintf(stderr, "  Globals:      %zu\n", emitter->global_count);
+    size_t compiled = 0;
+
+    for (size_t i = 0; i < emitter->func_count; i++)
+        if (emitter->functions[i].compiled)
+            compiled++;
+
+    fprintf(stderr,
+            "  Functions:    %zu (%zu compiled)\n",
+            emitter->func_count,
+            compiled);
+    fprintf(stderr, "  Bytecode:     %zu bytes\n", emitter->code_len);
+}
+
 static void help_flag() {
 
     printf("Usage: %s./phase <input.phase>%s\n\n", FG_BLUE_BOLD, RESET);
@@ -421,26 +586,73 @@ static void help_flag() {
     printf("  %s--loud,   -l%s        Print a success message on exit.\n",
            FG_BLUE_BOLD,
            RESET);
+    printf("  %s--stats,  -s%s        Print compile statistics to stderr.\n",
+           FG_BLUE_BOLD,
+           RESET);
+    printf("  %s--check,  -c%s        Compile a source without running it.\n",
+           FG_BLUE_BOLD,
+           RESET);
+    printf("  %s--batch,  -b%s        Lex the whole source before parsing.\n",
+           FG_BLUE_BOLD,
+           RESET);
+    printf("  %s--lazy,   -z%s        Only compile functions reachable from "
+           "entry.\n",
+           FG_BLUE_BOLD,
+           RESET);
+    printf("  %s--direct, -d%s        Emit bytecode while parsing, without an "
+           "AST.\n",
+           FG_BLUE_BOLD,
+           RESET);
+    printf("  %s--overlap, -o%s       Lex on a second thread while parsing.\n",
+           FG_BLUE_BOLD,
+           RESET);
+    printf("  %s--parallel, -p%s      Compile function bodies across the "
+           "CPUs.\n",
+           FG_BLUE_BOLD,
+           RESET);
+    printf("  %s--watch,  -w%s        Recompile and run the source whenever it "
+           "changes.\n",
+           FG_BLUE_BOLD,
+           RESET);
 
     exit_phase(2);
 }
 
-int main(int argc, char **argv) {
+/* Regular files are mapped read-only rather than copied. Returns NULL for
+ * anything that cannot be, such as pipes, empty files or platforms without
+ * mmap, which are read by read_source() instead */
+static char *map_source(FILE *input_file, size_t *len_out) {
 
-    bool token_mode = false;
-    bool ast_mode   = false;
-    bool loud_mode  = false;
-    set_branch_glyph(unicode_available());
+#ifdef PHASE_MMAP
+    int         fd = fileno(input_file);
+    struct stat info;
 
-    if (argc < 2)
-        error_no_args();
-    error_set_source(argv[1]);
-    if ((strcmp(argv[1], "--help") == 0) || (strcmp(argv[1], "-h") == 0))
-        help_flag();
+    if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode) || info.st_size <= 0)
+        return NULL;
 
-    FILE *input_file = fopen(argv[1], "r");
-    if (!input_file)
-        error_ifnf(argv[1]);
+    size_t len  = (size_t)info.st_size;
+    void  *text = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (text == MAP_FAILED)
+        return NULL;
+
+    // The lexer walks the file once, front to back
+    posix_madvise(text, len, POSIX_MADV_SEQUENTIAL);
+
+    *len_out = len;
+
+    return text;
+#else
+    (void)input_file;
+    (void)len_out;
+
+    return NULL;
+#endif
+}
+
+/* Read an input that couldn't be mapped into a heap buffer, for --batch
+ * which needs the whole source. The lexer is bounded by the length so the
+ * buffer is not terminated */
+static char *read_source(FILE *input_file, const char *path, size_t *len_out) {
 
     const size_t CHUNK_SIZE = 4096;
     size_t       file_len   = 0;
@@ -489,20 +701,143 @@ int main(int argc, char **argv) {
     if (ferror(input_file) != 0) {
         free(file_content);
         fclose(input_file);
-        error_io(argv[1]);
+        error_io(path);
     }
 
-    // Sanitize realloc
-    char *temp_ptr = realloc(file_content, file_len + 1);
-    if (!temp_ptr) {
-        free(file_content);
-        fclose(input_file);
+    *len_out = file_len;
+
+    return file_content;
+}
+
+/* Verify and run a program compiled from a watched source. Errors, at run
+ * time as well, are reported and the watch goes on */
+static void run_watched(Emitter *emitter,
+                        size_t   compiled,
+                        bool     stats_mode,
+                        bool     check_mode,
+                        bool     loud_mode) {
+
+    jmp_buf catch;
+
+    VM *vm = calloc(1, sizeof(VM));
+    if (!vm)
         error_oom();
+
+    if (setjmp(catch)) {
+
+        error_catch(NULL);
+        report_exit(1);
+        free_vm(vm);
+        free(vm);
+        return;
+    }
+
+    error_catch(&catch);
+
+    verify_program(emitter);
+
+    if (stats_mode) {
+
+        print_stats(emitter);
+        fprintf(stderr, "  Recompiled:   %zu bodies\n", compiled);
+    }
+
+    if (!check_mode) {
+
+        init_vm(vm,
+                emitter->constants,
+                emitter->const_count,
+                emitter->code,
+                emitter->code_len,
+                emitter->functions,
+                emitter->func_count,
+                emitter->entry,
+                emitter->global_types,
+                emitter->global_count,
+                emitter->stack_size,
+                emitter->frame_depth);
+
+        interpret(vm);
+    }
+
+    error_catch(NULL);
+    free_vm(vm);
+    free(vm);
+
+    if (loud_mode)
+        printf("\n%sPROGRAM EXECUTED%s\n", FG_GREEN_BOLD, RESET);
+
+    // The program's output goes before the exit message, piped or not
+    fflush(stdout);
+    report_exit(0);
+}
+
+/* Compile and run the source at path, then again after every change to it
+ * for as long as it can be watched */
+static noreturn void
+watch_file(const char *path, bool stats_mode, bool check_mode, bool loud_mode) {
+
+    Watch *watch = open_watch(path);
+
+    for (;;) {
+
+        size_t   compiled = 0;
+        Emitter *program  = compile_watched(watch, &compiled);
+
+        if (program)
+            run_watched(program, compiled, stats_mode, check_mode, loud_mode);
+
+        printf("\n%sWatching %s for changes...%s\n", FG_BLUE_BOLD, path, RESET);
+        fflush(stdout);
+
+        if (!wait_for_change(watch))
+            exit_phase(0);
+    }
+}
+
+static void release_source(char *text, size_t len, bool mapped) {
+
+#ifdef PHASE_MMAP
+    if (mapped) {
+        munmap(text, len);
+        return;
     }
+#else
+    (void)len;
+    (void)mapped;
+#endif
+
+    free(text);
+}
+
+int main(int argc, char **argv) {
+
+    bool token_mode    = false;
+    bool ast_mode      = false;
+    bool loud_mode     = false;
+    bool stats_mode    = false;
+    bool check_mode    = false;
+    bool batch_mode    = false;
+    bool lazy_mode     = false;
+    bool direct_mode   = false;
+    bool overlap_mode  = false;
+    bool parallel_mode = false;
+    bool watch_mode    = false;
+    set_branch_glyph(unicode_available());
+
+    if (argc < 2)
+        error_no_args();
+    error_set_source(argv[1]);
+    if ((strcmp(argv[1], "--help") == 0) || (strcmp(argv[1], "-h") == 0))
+        help_flag();
 
-    file_content           = temp_ptr;
-    file_content[file_len] = '\0';
-    fclose(input_file);
+    FILE *input_file = fopen(argv[1], "r");
+    if (!input_file)
+        error_ifnf(argv[1]);
+
+    size_t file_len     = 0;
+    char  *file_content = map_source(input_file, &file_len);
+    bool   file_mapped  = file_content != NULL;
 
     for (int i = 2; i < argc; i++) {
 
@@ -525,58 +860,210 @@ int main(int argc, char **argv) {
 
             loud_mode = true;
 
+        } else if ((strcmp(argv[i], "--stats") == 0) ||
+                   (strcmp(argv[i], "-s") == 0)) {
+
+            stats_mode = true;
+
+        } else if ((strcmp(argv[i], "--check") == 0) ||
+                   (strcmp(argv[i], "-c") == 0)) {
+
+            check_mode = true;
+
+        } else if ((strcmp(argv[i], "--batch") == 0) ||
+                   (strcmp(argv[i], "-b") == 0)) {
+
+            batch_mode = true;
+
+        } else if ((strcmp(argv[i], "--lazy") == 0) ||
+                   (strcmp(argv[i], "-z") == 0)) {
+
+            lazy_mode = true;
+
+        } else if ((strcmp(argv[i], "--direct") == 0) ||
+                   (strcmp(argv[i], "-d") == 0)) {
+
+            direct_mode = true;
+
+        } else if ((strcmp(argv[i], "--overlap") == 0) ||
+                   (strcmp(argv[i], "-o") == 0)) {
+
+            overlap_mode = true;
+
+        } else if ((strcmp(argv[i], "--parallel") == 0) ||
+                   (strcmp(argv[i], "-p") == 0)) {
+
+            parallel_mode = true;
+
+        } else if ((strcmp(argv[i], "--watch") == 0) ||
+                   (strcmp(argv[i], "-w") == 0)) {
+
+            watch_mode = true;
+
         } else {
 
             error_invalid_arg(argv[i]);
         }
     }
 
-    Lexer lexer = {.src       = file_content,
-                   .pos       = 0,
-                   .line      = 1,
-                   .column    = 1,
-                   .file_path = argv[1]};
+    // A watched source is read again on every change, and compiled from
+    // what the watch keeps between them
+    if (watch_mode && !token_mode && !ast_mode) {
+
+        release_source(file_content, file_len, file_mapped);
+        fclose(input_file);
+        watch_file(argv[1], stats_mode, check_mode, loud_mode);
+    }
+
+    // Lines are located from this index, and diagnostics quote the buffer
+    Source source;
+    Lexer  lexer;
+
+    // Tokens, the AST and the checker's tables all live here until exit
+    Arena arena = {0};
+
+    // Anything that can't be mapped, like a pipe, is lexed as it is read
+    // with only a window of it in memory, unless --batch wants it all,
+    // --lazy, --direct and --parallel may need to read parts of it again
+    // or --overlap lexes it on another thread
+    if (file_mapped || batch_mode || lazy_mode || direct_mode ||
+        overlap_mode || parallel_mode) {
+
+        if (!file_mapped)
+            file_content = read_source(input_file, argv[1], &file_len);
+
+        fclose(input_file);
+
+        init_source(&source, file_content, file_len);
+        lexer = init_lexer(&source, argv[1], &arena);
+
+    } else {
+
+        lexer = init_stream_lexer(&source, input_file, argv[1], &arena);
+    }
+
+    error_set_lines(&source);
+
+    // With --batch every token is lexed into arrays before parsing starts,
+    // large sources in chunks across the CPUs
+    TokenBuffer tokens = {0};
+    if (batch_mode)
+        lex_tokens_parallel(&lexer, &tokens, 0);
 
     if (token_mode) {
 
-        display_tokens(&lexer);
-        free(file_content);
+        if (batch_mode)
+            display_token_buffer(&tokens);
+        else
+            display_tokens(&lexer);
+        free_tokens(&tokens);
+        free_lexer(&lexer);
+        arena_free(&arena);
+        free_source(&source);
+        release_source(file_content, file_len, file_mapped);
     }
 
-    Parser      parser  = init_parser(&lexer);
-    AstProgram *program = parse_program(&parser);
+    // With --lazy, function bodies are only parsed if the checker finds a
+    // call to them, and an AST dump wants them all. With --direct the
+    // program is checked and emitted as it is parsed, and no AST is kept.
+    // --parallel compiles every body, so both of those come first
+    direct_mode   = direct_mode && !ast_mode;
+    parallel_mode = parallel_mode && !ast_mode && !direct_mode && !lazy_mode;
+
+    // With --overlap the lexer runs on a thread of its own, up to a ring of
+    // tokens ahead of the parser. --batch has every token already, and
+    // --direct and --parallel read ahead of where they parse, which a
+    // ring can't go back from
+    TokenRing *ring = NULL;
+    if (overlap_mode && !batch_mode && !direct_mode && !parallel_mode)
+        ring = start_token_ring(&lexer);
+
+    Parser      parser  = init_parser(&lexer,
+                                    batch_mode ? &tokens : NULL,
+                                    ring,
+                                    lazy_mode && !ast_mode && !direct_mode);
+    Emitter     emitter = {0};
+    AstProgram *program = NULL;
+
+    // Syntax errors are all reported where the whole AST is parsed on this
+    // thread, the other modes stop at the first
+    parser.recover = !direct_mode && !parallel_mode;
+
+    if (direct_mode)
+        compile_program(&emitter, &parser, &arena);
+    else if (parallel_mode)
+        compile_parallel(&emitter, &parser, &arena, 0);
+    else
+        program = parse_program(&parser);
+
+    // The ring has been through the whole source, and any skipped body is
+    // lexed again from the lexer itself
+    stop_token_ring(ring);
+    parser.ring = NULL;
+
+    // Nothing in the AST points into the token buffer or the parser, which
+    // are kept while skipped bodies may still be parsed
+    if (!program || !program->deferred) {
+
+        free_parser(&parser);
+        free_tokens(&tokens);
+    }
 
     if (ast_mode) {
 
+        // What a syntax error lost is gone, the rest still parsed
+        if (error_count())
+            error_fail();
+
         print_program(program);
-        free_program(program);
-        free_token(&parser.look);
-        free(file_content);
+        free_lexer(&lexer);
+        arena_free(&arena);
+        free_source(&source);
+        release_source(file_content, file_len, file_mapped);
     }
 
     if (!token_mode && !ast_mode) {
 
-        Emitter emitter = {0};
-        emit_program(&emitter, program);
+        if (program) {
+
+            check_program(&emitter, program, &arena);
+            emit_program(&emitter, program);
+        }
+
+        verify_program(&emitter);
 
-        VM vm = {0};
-        init_vm(&vm,
-                emitter.constants,
-                emitter.const_count,
-                emitter.code,
-                emitter.code_len,
-                emitter.functions,
-                emitter.func_count,
-                emitter.entry,
-                emitter.global_count);
+        free_parser(&parser);
+        free_tokens(&tokens);
 
-        interpret(&vm);
+        if (stats_mode)
+            print_stats(&emitter);
+
+        if (!check_mode) {
+
+            VM vm = {0};
+            init_vm(&vm,
+                    emitter.constants,
+                    emitter.const_count,
+                    emitter.code,
+                    emitter.code_len,
+                    emitter.functions,
+                    emitter.func_count,
+                    emitter.entry,
+                    emitter.global_types,
+                    emitter.global_count,
+                    emitter.stack_size,
+                    emitter.frame_depth);
+
+            interpret(&vm);
+
+            free_vm(&vm);
+        }
 
-        free_vm(&vm);
         free_emitter(&emitter);
-        free_program(program);
-        free_token(&parser.look);
-        free(file_content);
+        free_lexer(&lexer);
+        arena_free(&arena);
+        free_source(&source);
+        release_source(file_content, file_len, file_mapped);
 
         if (loud_mode)
             printf("\n%sPROGRAM EXECUTED%s\n", FG_GREEN_BOLD, RESET);
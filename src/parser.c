@@ -3,49 +3,136 @@
 #include <stdlib.h>
 #include <string.h>
 
-#define DEPTH_LIMIT 256
+/* Read the next token and locate it. Tokens arrive in source order, so the
+ * line index lookup only ever walks forward from the previous line. A token
+ * buffer or a ring has already located them, and stays on its EOF once
+ * reached */
+static void advance_parser(Parser *parser) {
+
+    if (parser->tokens) {
+
+        parser->look = token_at(parser->tokens, parser->next);
+        parser->at   = token_span(parser->tokens, parser->next);
+
+        if (parser->look.type != TOK_EOF)
+            parser->next++;
+
+        return;
+    }
+
+    if (parser->ring) {
 
-Parser init_parser(Lexer *lexer) {
-    Parser parser = {.lexer = lexer, .look = next_token(lexer), .depth = 0};
+        parser->look = ring_next(parser->ring, &parser->at);
+        return;
+    }
+
+    parser->look = next_token(parser->lexer);
+    parser->at   = source_span(parser->lexer->source,
+                             parser->look.offset,
+                             parser->look.span,
+                             &parser->line_hint);
+}
+
+Parser init_parser(Lexer             *lexer,
+                   const TokenBuffer *tokens,
+                   TokenRing         *ring,
+                   bool               lazy) {
+    Parser parser = {.lexer     = lexer,
+                     .tokens    = tokens,
+                     .ring      = ring,
+                     .line_hint = 0,
+                     .lazy      = lazy,
+                     .nodes     = lexer->arena};
+
+    advance_parser(&parser);
 
     return parser;
 }
 
-static void vector_push(void ***items, size_t *len, size_t *cap, void *item) {
+/* Zeroed storage for an AST node, owned by the parser's node arena */
+static void *new_node(Parser *parser, size_t size) {
+
+    return arena_alloc(parser->nodes, size);
+}
+
+/* Copy the current lexeme into the lexer's arena, tokens only hold a slice
+ * of the source and names need to be terminated. Declared names and string
+ * literals go here, as the checker and constant pool keep them */
+static char *copy_lexeme(Parser *parser) {
 
-    if (*len + 1 > *cap) {
+    return arena_strndup(parser->lexer->arena,
+                         parser->look.start,
+                         parser->look.length);
+}
 
-        size_t new_cap  = *cap ? *cap * 2 : 8;
-        void **temp_ptr = realloc(*items, new_cap * sizeof(void *));
-        if (!temp_ptr) {
-            free(*items);
-            error_oom();
-        }
+/* Copy a name that is only looked up, which can go with the nodes */
+static char *copy_reference(Parser *parser) {
 
-        *items = temp_ptr;
-        *cap   = new_cap;
-    }
+    return arena_strndup(parser->nodes,
+                         parser->look.start,
+                         parser->look.length);
+}
 
-    (*items)[(*len)++] = item;
+/* The current numeric lexeme terminated for atoi() and atof(), in buffer
+ * when it fits. The source may be a mapping with nothing after the last
+ * digit, and a float could otherwise read an exponent past the slice */
+static const char *
+terminate_number(Parser *parser, char *buffer, size_t size) {
+
+    if (parser->look.length >= size)
+        return copy_reference(parser);
+
+    memcpy(buffer, parser->look.start, parser->look.length);
+    buffer[parser->look.length] = '\0';
+
+    return buffer;
 }
 
-static AstBlock      *parse_block(Parser *parser);
-static AstExpression *parse_expression(Parser *parser);
-static AstStatement  *parse_statement(Parser *parser);
-static void           free_block(AstBlock *block);
+/* Double an arena-backed array of elem_size items, all AST storage lives in
+ * the node arena and is released with it */
+static void *
+grow_array(Parser *parser, void *items, size_t *cap, size_t elem_size) {
 
-void free_token(Token *token) {
+    size_t new_cap = *cap ? *cap * 2 : 4;
 
-    if (token->lexeme && token->heap_allocated)
-        free(token->lexeme);
+    items = arena_grow(parser->nodes,
+                       items,
+                       *cap * elem_size,
+                       new_cap * elem_size);
+    *cap  = new_cap;
+
+    return items;
 }
 
-static void advance_parser(Parser *parser) {
+static void vector_push(Parser *parser,
+                        void ***items,
+                        size_t *len,
+                        size_t *cap,
+                        void   *item) {
 
-    if (parser->look.type != TOK_EOF)
-        free_token(&parser->look);
+    if (*len + 1 > *cap)
+        *items = grow_array(parser, *items, cap, sizeof(void *));
 
-    parser->look = next_token(parser->lexer);
+    (*items)[(*len)++] = item;
+}
+
+/* Make room for one more item on one of the parser's heap stacks */
+static void *
+reserve_stack(void *items, size_t count, size_t *cap, size_t elem_size) {
+
+    if (count + 1 <= *cap)
+        return items;
+
+    size_t new_cap  = *cap ? *cap * 2 : 16;
+    void  *temp_ptr = realloc(items, new_cap * elem_size);
+    if (!temp_ptr) {
+        free(items);
+        error_oom();
+    }
+
+    *cap = new_cap;
+
+    return temp_ptr;
 }
 
 static bool match(Parser *parser, TokenType t_type) {
@@ -66,9 +153,9 @@ static void expect(Parser *parser, TokenType t_type, const char *message) {
     if (!match(parser, t_type)) {
 
         ErrorLocation loc = {.file      = parser->lexer->file_path,
-                             .line      = parser->look.line,
-                             .col_start = parser->look.column_start,
-                             .col_end   = parser->look.column_end};
+                             .line      = parser->at.line,
+                             .col_start = parser->at.column_start,
+                             .col_end   = parser->at.column_end};
         error_expect_symbol(loc, message);
     }
 }
@@ -84,7 +171,7 @@ parse_type_annotation(Parser *parser, bool allow_void, int *col_end_out) {
         TokenType var_type = parser->look.type;
 
         if (col_end_out)
-            *col_end_out = parser->look.column_end;
+            *col_end_out = parser->at.column_end;
 
         advance_parser(parser);
 
@@ -92,49 +179,200 @@ parse_type_annotation(Parser *parser, bool allow_void, int *col_end_out) {
     }
 
     ErrorLocation loc = {.file      = parser->lexer->file_path,
-                         .line      = parser->look.line,
-                         .col_start = parser->look.column_start,
-                         .col_end   = parser->look.column_end};
+                         .line      = parser->at.line,
+                         .col_start = parser->at.column_start,
+                         .col_end   = parser->at.column_end};
     error_expect_symbol(loc, "type name");
 
     return TOK_UNKNOWN;
 }
 
-static AstExpression *parse_primary(Parser *parser);
-static AstExpression *parse_unary(Parser *parser);
-static AstExpression *parse_factor(Parser *parser);
-static AstExpression *parse_term(Parser *parser);
-static AstExpression *parse_comparison(Parser *parser);
-static AstExpression *parse_equality(Parser *parser);
-static AstExpression *parse_logic_and(Parser *parser);
-static AstExpression *parse_logic_or(Parser *parser);
+/* How tightly each binary operator binds, from loosest to tightest. Every
+ * level is left-associative, and prefix operators bind tighter than all */
+typedef enum {
+
+    PREC_NONE,
+    PREC_OR,
+    PREC_AND,
+    PREC_EQUALITY,
+    PREC_COMPARISON,
+    PREC_TERM,
+    PREC_FACTOR,
+    PREC_UNARY
+
+} Precedence;
+
+static const Precedence binary_precedence[TOK_UNKNOWN + 1] = {
+
+        [TOK_OR]            = PREC_OR,
+        [TOK_AND]           = PREC_AND,
+        [TOK_EQUAL_EQUAL]   = PREC_EQUALITY,
+        [TOK_LESS]          = PREC_COMPARISON,
+        [TOK_GREATER]       = PREC_COMPARISON,
+        [TOK_LESS_EQUAL]    = PREC_COMPARISON,
+        [TOK_GREATER_EQUAL] = PREC_COMPARISON,
+        [TOK_ADD]           = PREC_TERM,
+        [TOK_SUBTRACT]      = PREC_TERM,
+        [TOK_MULTIPLY]      = PREC_FACTOR,
+        [TOK_DIVIDE]        = PREC_FACTOR
+
+};
+
+/* An operator or bracket whose operands are still being parsed. A call
+ * collects its arguments here until the closing parenthesis */
+typedef enum {
+
+    PENDING_PREFIX,
+    PENDING_BINARY,
+    PENDING_GROUP,
+    PENDING_CALL
+
+} PendingKind;
+
+typedef struct PendingOp {
+
+    PendingKind     kind;
+    TokenType       op;
+    int             line;
+    int             column_start;
+    char           *name;
+    AstExpression **args;
+    size_t          arg_count;
+    size_t          arg_cap;
+
+} PendingOp;
+
+/* Push an operator of the given kind at the current token */
+static PendingOp *push_op(Parser *parser, PendingKind kind) {
+
+    if (parser->op_count == parser->op_cap)
+        parser->ops = reserve_stack(parser->ops,
+                                    parser->op_count,
+                                    &parser->op_cap,
+                                    sizeof(*parser->ops));
+
+    PendingOp *op = &parser->ops[parser->op_count++];
+
+    op->kind         = kind;
+    op->op           = parser->look.type;
+    op->line         = parser->at.line;
+    op->column_start = parser->at.column_start;
+    op->args         = NULL;
+    op->arg_count    = 0;
+    op->arg_cap      = 0;
+
+    return op;
+}
 
-static AstExpression *parse_expression(Parser *parser) {
-    // Increase program depth and
-    // check if it exceeds the
-    // complexity limit
-    parser->depth++;
-    if (parser->depth > DEPTH_LIMIT)
-        error_complexity();
-
-    return parse_logic_or(parser);
+static void push_operand(Parser *parser, AstExpression *operand) {
+
+    if (parser->operand_count == parser->operand_cap)
+        parser->operands = reserve_stack(parser->operands,
+                                         parser->operand_count,
+                                         &parser->operand_cap,
+                                         sizeof(*parser->operands));
+
+    parser->operands[parser->operand_count++] = operand;
+}
+
+static AstExpression *pop_operand(Parser *parser) {
+
+    return parser->operands[--parser->operand_count];
+}
+
+/* Whether the operator on top of the stack takes its operands before an
+ * operator of prec is pushed. Prefix operators bind tighter than any binary
+ * one and every binary level is left-associative, PREC_NONE closes them all
+ * down to the nearest bracket */
+static bool reduces_before(const Parser *parser, size_t base, Precedence prec) {
+
+    if (parser->op_count == base)
+        return false;
+
+    const PendingOp *top = &parser->ops[parser->op_count - 1];
+
+    if (top->kind == PENDING_PREFIX)
+        return true;
+
+    return top->kind == PENDING_BINARY && binary_precedence[top->op] >= prec;
+}
+
+/* Fold the prefix or binary operator on top of the stack and its operands
+ * into one node, which becomes an operand itself */
+static void reduce_op(Parser *parser) {
+
+    const PendingOp *op    = &parser->ops[--parser->op_count];
+    AstExpression   *right = pop_operand(parser);
+    AstExpression   *node  = new_node(parser, sizeof(*node));
+
+    node->line         = op->line;
+    node->column_start = op->column_start;
+    node->column_end   = right->column_end;
+
+    if (op->kind == PENDING_PREFIX) {
+
+        node->tag        = EXP_UNARY;
+        node->unary.expr = right;
+        node->unary.op   = op->op;
+
+    } else {
+
+        node->tag          = EXP_BINARY;
+        node->binary.left  = pop_operand(parser);
+        node->binary.right = right;
+        node->binary.op    = op->op;
+    }
+
+    push_operand(parser, node);
+}
+
+/* Close a call at its ')' once every argument has been parsed */
+static AstExpression *finish_call(Parser         *parser,
+                                  char           *name,
+                                  int             line,
+                                  int             col_start,
+                                  AstExpression **args,
+                                  size_t          arg_count) {
+
+    if (parser->look.type != TOK_RPAREN) {
+
+        ErrorLocation loc = {.file      = parser->lexer->file_path,
+                             .line      = parser->at.line,
+                             .col_start = parser->at.column_start,
+                             .col_end   = parser->at.column_end};
+        error_expect_symbol(loc, "')'");
+    }
+
+    int col_end = parser->at.column_end;
+    expect(parser, TOK_RPAREN, "')'");
+
+    AstExpression *expression = new_node(parser, sizeof(*expression));
+
+    expression->tag            = EXP_CALL;
+    expression->line           = line;
+    expression->column_start   = col_start;
+    expression->column_end     = col_end;
+    expression->call.func_name = name;
+    expression->call.args      = args;
+    expression->call.arg_count = arg_count;
+
+    return expression;
 }
 
+/* A literal, variable or call without arguments. A call with arguments
+ * is left open on the operator stack instead and NULL returned, its first
+ * argument being the next operand */
 static AstExpression *parse_primary(Parser *parser) {
 
     if (parser->look.type == TOK_STRING_LIT) {
 
-        AstExpression *expression = calloc(1, sizeof(*expression));
-
-        if (!expression)
-            error_oom();
+        AstExpression *expression = new_node(parser, sizeof(*expression));
 
-        expression->tag          = EXP_STRING;
-        expression->line         = parser->look.line;
-        expression->column_start = parser->look.column_start;
-        expression->column_end   = parser->look.column_end;
-        expression->str_lit.value =
-                strdup(parser->look.lexeme ? parser->look.lexeme : "");
+        expression->tag           = EXP_STRING;
+        expression->line          = parser->at.line;
+        expression->column_start  = parser->at.column_start;
+        expression->column_end    = parser->at.column_end;
+        expression->str_lit.value = copy_lexeme(parser);
 
         advance_parser(parser);
 
@@ -143,17 +381,15 @@ static AstExpression *parse_primary(Parser *parser) {
 
     if (parser->look.type == TOK_INTEGER_LIT) {
 
-        AstExpression *expression = calloc(1, sizeof(*expression));
-
-        if (!expression)
-            error_oom();
+        AstExpression *expression = new_node(parser, sizeof(*expression));
 
         expression->tag          = EXP_INTEGER;
-        expression->line         = parser->look.line;
-        expression->column_start = parser->look.column_start;
-        expression->column_end   = parser->look.column_end;
+        expression->line         = parser->at.line;
+        expression->column_start = parser->at.column_start;
+        expression->column_end   = parser->at.column_end;
+        char digits[64];
         expression->int_lit.value =
-                atoi(parser->look.lexeme ? parser->look.lexeme : "0");
+                atoi(terminate_number(parser, digits, sizeof(digits)));
 
         advance_parser(parser);
 
@@ -162,17 +398,15 @@ static AstExpression *parse_primary(Parser *parser) {
 
     if (parser->look.type == TOK_FLOAT_LIT) {
 
-        AstExpression *expression = calloc(1, sizeof(*expression));
-
-        if (!expression)
-            error_oom();
+        AstExpression *expression = new_node(parser, sizeof(*expression));
 
         expression->tag          = EXP_FLOAT;
-        expression->line         = parser->look.line;
-        expression->column_start = parser->look.column_start;
-        expression->column_end   = parser->look.column_end;
+        expression->line         = parser->at.line;
+        expression->column_start = parser->at.column_start;
+        expression->column_end   = parser->at.column_end;
+        char digits[64];
         expression->float_lit.value =
-                atof(parser->look.lexeme ? parser->look.lexeme : "0.0");
+                atof(terminate_number(parser, digits, sizeof(digits)));
 
         advance_parser(parser);
 
@@ -181,16 +415,13 @@ static AstExpression *parse_primary(Parser *parser) {
 
     if (parser->look.type == TOK_BOOLEAN_LIT) {
 
-        AstExpression *expression = calloc(1, sizeof(*expression));
-
-        if (!expression)
-            error_oom();
+        AstExpression *expression = new_node(parser, sizeof(*expression));
 
         expression->tag            = EXP_BOOLEAN;
-        expression->line           = parser->look.line;
-        expression->column_start   = parser->look.column_start;
-        expression->column_end     = parser->look.column_end;
-        expression->bool_lit.value = strcmp(parser->look.lexeme, "true") == 0;
+        expression->line           = parser->at.line;
+        expression->column_start   = parser->at.column_start;
+        expression->column_end     = parser->at.column_end;
+        expression->bool_lit.value = parser->look.start[0] == 't';
 
         advance_parser(parser);
 
@@ -199,10 +430,10 @@ static AstExpression *parse_primary(Parser *parser) {
 
     if (parser->look.type == TOK_VARIABLE) {
 
-        int   line         = parser->look.line;
-        int   col_start    = parser->look.column_start;
-        int   name_col_end = parser->look.column_end;
-        char *name = strdup(parser->look.lexeme ? parser->look.lexeme : "");
+        int   line         = parser->at.line;
+        int   col_start    = parser->at.column_start;
+        int   name_col_end = parser->at.column_end;
+        char *name         = copy_reference(parser);
 
         advance_parser(parser);
 
@@ -210,66 +441,19 @@ static AstExpression *parse_primary(Parser *parser) {
 
             advance_parser(parser);
 
-            AstExpression **args      = NULL;
-            size_t          arg_count = 0;
-            size_t          arg_cap   = 0;
-
-            if (parser->look.type != TOK_RPAREN) {
-
-                do {
-
-                    if (arg_count + 1 > arg_cap) {
-
-                        size_t new_cap = arg_cap ? arg_cap * 2 : 4;
-                        void  *temp_ptr =
-                                realloc(args,
-                                        new_cap * sizeof(AstExpression *));
-                        if (!temp_ptr) {
-                            free(args);
-                            error_oom();
-                        }
-
-                        args    = temp_ptr;
-                        arg_cap = new_cap;
-                    }
-
-                    args[arg_count++] = parse_expression(parser);
-
-                } while (match(parser, TOK_COMMA));
-            }
-
-            if (parser->look.type != TOK_RPAREN) {
-
-                ErrorLocation loc = {.file      = parser->lexer->file_path,
-                                     .line      = parser->look.line,
-                                     .col_start = parser->look.column_start,
-                                     .col_end   = parser->look.column_end};
-                error_expect_symbol(loc, "')'");
-            }
-
-            int col_end = parser->look.column_end;
-            expect(parser, TOK_RPAREN, "')'");
-
-            AstExpression *expression = calloc(1, sizeof(*expression));
+            if (parser->look.type == TOK_RPAREN)
+                return finish_call(parser, name, line, col_start, NULL, 0);
 
-            if (!expression)
-                error_oom();
+            PendingOp *call = push_op(parser, PENDING_CALL);
 
-            expression->tag            = EXP_CALL;
-            expression->line           = line;
-            expression->column_start   = col_start;
-            expression->column_end     = col_end;
-            expression->call.func_name = name;
-            expression->call.args      = args;
-            expression->call.arg_count = arg_count;
+            call->line         = line;
+            call->column_start = col_start;
+            call->name         = name;
 
-            return expression;
+            return NULL;
         }
 
-        AstExpression *expression = calloc(1, sizeof(*expression));
-
-        if (!expression)
-            error_oom();
+        AstExpression *expression = new_node(parser, sizeof(*expression));
 
         expression->tag           = EXP_VARIABLE;
         expression->line          = line;
@@ -280,248 +464,106 @@ static AstExpression *parse_primary(Parser *parser) {
         return expression;
     }
 
-    if (parser->look.type == TOK_LPAREN) {
-
-        advance_parser(parser);
-        AstExpression *expression = parse_expression(parser);
-        expect(parser, TOK_RPAREN, "')'");
-
-        return expression;
-    }
-
     ErrorLocation loc = {.file      = parser->lexer->file_path,
-                         .line      = parser->look.line,
-                         .col_start = parser->look.column_start,
-                         .col_end   = parser->look.column_end};
+                         .line      = parser->at.line,
+                         .col_start = parser->at.column_start,
+                         .col_end   = parser->at.column_end};
     error_expect_symbol(loc, "expression");
 
     return NULL;
 }
 
-static AstExpression *parse_unary(Parser *parser) {
-
-    if (parser->look.type == TOK_BANG || parser->look.type == TOK_NOT ||
-        parser->look.type == TOK_SUBTRACT) {
-
-        TokenType op        = parser->look.type;
-        int       line      = parser->look.line;
-        int       col_start = parser->look.column_start;
-        advance_parser(parser);
-        AstExpression *operand = parse_unary(parser);
-
-        AstExpression *un = calloc(1, sizeof(*un));
-
-        if (!un)
-            error_oom();
-
-        un->tag          = EXP_UNARY;
-        un->line         = line;
-        un->column_start = col_start;
-        un->column_end   = operand->column_end;
-        un->unary.expr   = operand;
-        un->unary.op     = op;
-
-        return un;
-    }
-
-    return parse_primary(parser);
-}
-static AstExpression *parse_factor(Parser *parser) {
-
-    AstExpression *left = parse_unary(parser);
-
-    while (parser->look.type == TOK_MULTIPLY ||
-           parser->look.type == TOK_DIVIDE) {
-
-        TokenType op        = parser->look.type;
-        int       line      = parser->look.line;
-        int       col_start = parser->look.column_start;
-        advance_parser(parser);
-        AstExpression *right = parse_unary(parser);
-
-        AstExpression *bin = calloc(1, sizeof(*bin));
-
-        if (!bin)
-            error_oom();
-
-        bin->tag          = EXP_BINARY;
-        bin->line         = line;
-        bin->column_start = col_start;
-        bin->column_end   = right->column_end;
-        bin->binary.left  = left;
-        bin->binary.right = right;
-        bin->binary.op    = op;
-
-        left = bin;
-    }
-
-    return left;
-}
-
-static AstExpression *parse_term(Parser *parser) {
-
-    AstExpression *left = parse_factor(parser);
-
-    while (parser->look.type == TOK_ADD || parser->look.type == TOK_SUBTRACT) {
-
-        TokenType op        = parser->look.type;
-        int       line      = parser->look.line;
-        int       col_start = parser->look.column_start;
-        advance_parser(parser);
-        AstExpression *right = parse_factor(parser);
-
-        AstExpression *bin = calloc(1, sizeof(*bin));
-
-        if (!bin)
-            error_oom();
-
-        bin->tag          = EXP_BINARY;
-        bin->line         = line;
-        bin->column_start = col_start;
-        bin->column_end   = right->column_end;
-        bin->binary.left  = left;
-        bin->binary.right = right;
-        bin->binary.op    = op;
-
-        left = bin;
-    }
-
-    return left;
-}
-
-static AstExpression *parse_comparison(Parser *parser) {
-
-    AstExpression *left = parse_term(parser);
-
-    while (parser->look.type == TOK_LESS || parser->look.type == TOK_GREATER ||
-           parser->look.type == TOK_LESS_EQUAL ||
-           parser->look.type == TOK_GREATER_EQUAL) {
-
-        TokenType op        = parser->look.type;
-        int       line      = parser->look.line;
-        int       col_start = parser->look.column_start;
-        advance_parser(parser);
-        AstExpression *right = parse_term(parser);
-
-        AstExpression *bin = calloc(1, sizeof(*bin));
-
-        if (!bin)
-            error_oom();
-
-        bin->tag          = EXP_BINARY;
-        bin->line         = line;
-        bin->column_start = col_start;
-        bin->column_end   = right->column_end;
-        bin->binary.left  = left;
-        bin->binary.right = right;
-        bin->binary.op    = op;
-
-        left = bin;
-    }
-
-    return left;
-}
-
-static AstExpression *parse_equality(Parser *parser) {
-
-    AstExpression *left = parse_comparison(parser);
-
-    while (parser->look.type == TOK_EQUAL_EQUAL) {
-
-        TokenType op        = parser->look.type;
-        int       line      = parser->look.line;
-        int       col_start = parser->look.column_start;
-        advance_parser(parser);
-        AstExpression *right = parse_comparison(parser);
+/* Parse an expression by operator precedence without recursing. Prefix
+ * operators, open parentheses and calls wait on the operator stack while
+ * their operands are parsed, and each binary operator first reduces the
+ * ones before it that bind at least as tightly. A ')' or ',' reduces down
+ * to the bracket it belongs to, and any other token ends the expression */
+static AstExpression *parse_expression(Parser *parser) {
 
-        AstExpression *bin = calloc(1, sizeof(*bin));
+    size_t op_base = parser->op_count;
 
-        if (!bin)
-            error_oom();
+    for (;;) {
 
-        bin->tag          = EXP_BINARY;
-        bin->line         = line;
-        bin->column_start = col_start;
-        bin->column_end   = right->column_end;
-        bin->binary.left  = left;
-        bin->binary.right = right;
-        bin->binary.op    = op;
+        if (parser->look.type == TOK_BANG || parser->look.type == TOK_NOT ||
+            parser->look.type == TOK_SUBTRACT) {
 
-        left = bin;
-    }
+            push_op(parser, PENDING_PREFIX);
+            advance_parser(parser);
+            continue;
+        }
 
-    return left;
-}
+        if (parser->look.type == TOK_LPAREN) {
 
-static AstExpression *parse_logic_and(Parser *parser) {
+            push_op(parser, PENDING_GROUP);
+            advance_parser(parser);
+            continue;
+        }
 
-    AstExpression *left = parse_equality(parser);
+        AstExpression *operand = parse_primary(parser);
+        if (!operand)
+            continue;
 
-    while (parser->look.type == TOK_AND) {
+        push_operand(parser, operand);
 
-        TokenType op        = parser->look.type;
-        int       line      = parser->look.line;
-        int       col_start = parser->look.column_start;
-        advance_parser(parser);
-        AstExpression *right = parse_equality(parser);
+        // Close brackets for as long as the token after an operand is one
+        for (;;) {
 
-        AstExpression *bin = calloc(1, sizeof(*bin));
+            Precedence prec = binary_precedence[parser->look.type];
 
-        if (!bin)
-            error_oom();
+            while (reduces_before(parser, op_base, prec))
+                reduce_op(parser);
 
-        bin->tag          = EXP_BINARY;
-        bin->line         = line;
-        bin->column_start = col_start;
-        bin->column_end   = right->column_end;
-        bin->binary.left  = left;
-        bin->binary.right = right;
-        bin->binary.op    = op;
+            if (prec != PREC_NONE) {
 
-        left = bin;
-    }
+                push_op(parser, PENDING_BINARY);
+                advance_parser(parser);
+                break;
+            }
 
-    return left;
-}
+            if (parser->op_count == op_base)
+                return pop_operand(parser);
 
-static AstExpression *parse_logic_or(Parser *parser) {
+            PendingOp *top = &parser->ops[parser->op_count - 1];
 
-    AstExpression *left = parse_logic_and(parser);
+            if (top->kind == PENDING_GROUP) {
 
-    while (parser->look.type == TOK_OR) {
+                expect(parser, TOK_RPAREN, "')'");
+                parser->op_count--;
+                continue;
+            }
 
-        TokenType op        = parser->look.type;
-        int       line      = parser->look.line;
-        int       col_start = parser->look.column_start;
-        advance_parser(parser);
-        AstExpression *right = parse_logic_and(parser);
+            if (top->arg_count + 1 > top->arg_cap)
+                top->args = grow_array(parser,
+                                       top->args,
+                                       &top->arg_cap,
+                                       sizeof(*top->args));
 
-        AstExpression *bin = calloc(1, sizeof(*bin));
+            top->args[top->arg_count++] = pop_operand(parser);
 
-        if (!bin)
-            error_oom();
+            if (match(parser, TOK_COMMA))
+                break;
 
-        bin->tag          = EXP_BINARY;
-        bin->line         = line;
-        bin->column_start = col_start;
-        bin->column_end   = right->column_end;
-        bin->binary.left  = left;
-        bin->binary.right = right;
-        bin->binary.op    = op;
+            AstExpression *call = finish_call(parser,
+                                              top->name,
+                                              top->line,
+                                              top->column_start,
+                                              top->args,
+                                              top->arg_count);
 
-        left = bin;
+            parser->op_count--;
+            push_operand(parser, call);
+        }
     }
-
-    return left;
 }
 
+/* A statement other than an if or while, which parse_block() handles */
 static AstStatement *parse_statement(Parser *parser) {
 
     if (parser->look.type == TOK_OUT) {
 
-        int line      = parser->look.line;
-        int col_start = parser->look.column_start;
-        int col_end   = parser->look.column_end;
+        int line      = parser->at.line;
+        int col_start = parser->at.column_start;
+        int col_end   = parser->at.column_end;
 
         advance_parser(parser);
 
@@ -529,10 +571,7 @@ static AstStatement *parse_statement(Parser *parser) {
         AstExpression *expression = parse_expression(parser);
         expect(parser, TOK_RPAREN, "')'");
 
-        AstStatement *statement = calloc(1, sizeof(*statement));
-
-        if (!statement)
-            error_oom();
+        AstStatement *statement = new_node(parser, sizeof(*statement));
 
         statement->tag            = STM_OUT;
         statement->line           = line;
@@ -543,105 +582,11 @@ static AstStatement *parse_statement(Parser *parser) {
         return statement;
     }
 
-    if (parser->look.type == TOK_IF) {
-
-        int line      = parser->look.line;
-        int col_start = parser->look.column_start;
-
-        advance_parser(parser);
-
-        AstExpression *condition  = parse_expression(parser);
-        AstBlock      *then_block = parse_block(parser);
-
-        AstBlock *else_block = NULL;
-
-        if (parser->look.type == TOK_ELSE) {
-
-            advance_parser(parser);
-
-            if (parser->look.type == TOK_IF) {
-
-                AstStatement *nested_if = parse_statement(parser);
-
-                else_block = calloc(1, sizeof(*else_block));
-
-                if (!else_block)
-                    error_oom();
-
-                else_block->statements = malloc(sizeof(AstStatement *));
-
-                if (!else_block->statements)
-                    error_oom();
-
-                else_block->statements[0] = nested_if;
-                else_block->len           = 1;
-                else_block->cap           = 1;
-
-            } else {
-
-                else_block = parse_block(parser);
-            }
-        }
-
-        int col_end =
-                then_block
-                        ? then_block->len > 0
-                                  ? then_block->statements[then_block->len - 1]
-                                            ->column_end
-                                  : col_start
-                        : col_start;
-
-        AstStatement *statement = calloc(1, sizeof(*statement));
-
-        if (!statement)
-            error_oom();
-
-        statement->tag                = STM_IF;
-        statement->line               = line;
-        statement->column_start       = col_start;
-        statement->column_end         = col_end;
-        statement->if_stmt.condition  = condition;
-        statement->if_stmt.then_block = then_block;
-        statement->if_stmt.else_block = else_block;
-
-        return statement;
-    }
-
-    if (parser->look.type == TOK_WHILE) {
-
-        int line      = parser->look.line;
-        int col_start = parser->look.column_start;
-
-        advance_parser(parser);
-
-        AstExpression *condition = parse_expression(parser);
-        AstBlock      *body      = parse_block(parser);
-
-        int col_end = body && body->len > 0
-                              ? body->statements[body->len - 1]->column_end
-                              : col_start;
-
-        AstStatement *statement = calloc(1, sizeof(*statement));
-
-        if (!statement)
-            error_oom();
-
-        statement->tag                = STM_WHILE;
-        statement->line               = line;
-        statement->column_start       = col_start;
-        statement->column_end         = col_end;
-        statement->if_stmt.condition  = condition;
-        statement->if_stmt.then_block = body;
-        statement->if_stmt.else_block = NULL;
-
-        return statement;
-    }
-
     if (parser->look.type == TOK_RETURN) {
 
-        int line      = parser->look.line;
-        int col_start = parser->look.column_start;
-        int col_end   = parser->look.column_end;
+        int line      = parser->at.line;
+        int col_start = parser->at.column_start;
+        int col_end   = parser->at.column_end;
 
         advance_parser(parser);
 
@@ -654,10 +599,7 @@ static AstStatement *parse_statement(Parser *parser) {
             col_end    = expression->column_end;
         }
 
-        AstStatement *statement = calloc(1, sizeof(*statement));
-
-        if (!statement)
-            error_oom();
+        AstStatement *statement = new_node(parser, sizeof(*statement));
 
         statement->tag            = STM_RETURN;
         statement->line           = line;
@@ -670,10 +612,10 @@ static AstStatement *parse_statement(Parser *parser) {
 
     if (parser->look.type == TOK_VARIABLE) {
 
-        int   line      = parser->look.line;
-        int   col_start = parser->look.column_start;
-        int   col_end   = parser->look.column_end;
-        char *var_name = strdup(parser->look.lexeme ? parser->look.lexeme : "");
+        int   line      = parser->at.line;
+        int   col_start = parser->at.column_start;
+        int   col_end   = parser->at.column_end;
+        char *var_name  = copy_reference(parser);
         advance_parser(parser);
 
         TokenType compound_op = TOK_UNKNOWN;
@@ -699,20 +641,11 @@ static AstStatement *parse_statement(Parser *parser) {
 
                 do {
 
-                    if (arg_count + 1 > arg_cap) {
-
-                        size_t new_cap = arg_cap ? arg_cap * 2 : 4;
-                        void  *temp_ptr =
-                                realloc(args,
-                                        new_cap * sizeof(AstExpression *));
-                        if (!temp_ptr) {
-                            free(args);
-                            error_oom();
-                        }
-
-                        args    = temp_ptr;
-                        arg_cap = new_cap;
-                    }
+                    if (arg_count + 1 > arg_cap)
+                        args = grow_array(parser,
+                                          args,
+                                          &arg_cap,
+                                          sizeof(*args));
 
                     args[arg_count++] = parse_expression(parser);
 
@@ -722,19 +655,16 @@ static AstStatement *parse_statement(Parser *parser) {
             if (parser->look.type != TOK_RPAREN) {
 
                 ErrorLocation loc = {.file      = parser->lexer->file_path,
-                                     .line      = parser->look.line,
-                                     .col_start = parser->look.column_start,
-                                     .col_end   = parser->look.column_end};
+                                     .line      = parser->at.line,
+                                     .col_start = parser->at.column_start,
+                                     .col_end   = parser->at.column_end};
                 error_expect_symbol(loc, "')'");
             }
 
-            col_end = parser->look.column_end;
+            col_end = parser->at.column_end;
             expect(parser, TOK_RPAREN, "')'");
 
-            AstExpression *expr = calloc(1, sizeof(*expr));
-
-            if (!expr)
-                error_oom();
+            AstExpression *expr = new_node(parser, sizeof(*expr));
 
             expr->tag            = EXP_CALL;
             expr->line           = line;
@@ -744,10 +674,7 @@ static AstStatement *parse_statement(Parser *parser) {
             expr->call.args      = args;
             expr->call.arg_count = arg_count;
 
-            AstStatement *statement = calloc(1, sizeof(*statement));
-
-            if (!statement)
-                error_oom();
+            AstStatement *statement = new_node(parser, sizeof(*statement));
 
             statement->tag             = STM_EXPR;
             statement->line            = line;
@@ -761,9 +688,9 @@ static AstStatement *parse_statement(Parser *parser) {
         if (compound_op == TOK_UNKNOWN && parser->look.type != TOK_ASSIGN) {
 
             ErrorLocation loc = {.file      = parser->lexer->file_path,
-                                 .line      = parser->look.line,
-                                 .col_start = parser->look.column_start,
-                                 .col_end   = parser->look.column_end};
+                                 .line      = parser->at.line,
+                                 .col_start = parser->at.column_start,
+                                 .col_end   = parser->at.column_end};
 
             if (parser->look.type == TOK_COLON) {
 
@@ -786,21 +713,15 @@ static AstStatement *parse_statement(Parser *parser) {
 
         if (compound_op != TOK_UNKNOWN) {
 
-            AstExpression *lhs = calloc(1, sizeof(*lhs));
-
-            if (!lhs)
-                error_oom();
+            AstExpression *lhs = new_node(parser, sizeof(*lhs));
 
             lhs->tag           = EXP_VARIABLE;
             lhs->line          = line;
             lhs->column_start  = col_start;
             lhs->column_end    = col_end;
-            lhs->variable.name = strdup(var_name);
-
-            AstExpression *bin = calloc(1, sizeof(*bin));
+            lhs->variable.name = var_name;
 
-            if (!bin)
-                error_oom();
+            AstExpression *bin = new_node(parser, sizeof(*bin));
 
             bin->tag          = EXP_BINARY;
             bin->line         = line;
@@ -830,10 +751,7 @@ static AstStatement *parse_statement(Parser *parser) {
             expression = bin;
         }
 
-        AstStatement *statement = calloc(1, sizeof(*statement));
-
-        if (!statement)
-            error_oom();
+        AstStatement *statement = new_node(parser, sizeof(*statement));
 
         statement->tag               = STM_ASSIGN;
         statement->line              = line;
@@ -847,9 +765,9 @@ static AstStatement *parse_statement(Parser *parser) {
 
     if (parser->look.type == TOK_LET) {
 
-        int line      = parser->look.line;
-        int col_start = parser->look.column_start;
-        int col_end   = parser->look.column_end;
+        int line      = parser->at.line;
+        int col_start = parser->at.column_start;
+        int col_end   = parser->at.column_end;
 
         advance_parser(parser);
 
@@ -867,28 +785,19 @@ static AstStatement *parse_statement(Parser *parser) {
                 if (parser->look.type != TOK_VARIABLE) {
 
                     ErrorLocation loc = {.file      = parser->lexer->file_path,
-                                         .line      = parser->look.line,
-                                         .col_start = parser->look.column_start,
-                                         .col_end   = parser->look.column_end};
+                                         .line      = parser->at.line,
+                                         .col_start = parser->at.column_start,
+                                         .col_end   = parser->at.column_end};
                     error_expect_symbol(loc, "variable name");
                 }
 
-                if (var_count + 1 > var_cap) {
-
-                    size_t new_cap = var_cap ? var_cap * 2 : 4;
-                    void  *temp_ptr =
-                            realloc(var_names, new_cap * sizeof(char *));
-                    if (!temp_ptr) {
-                        free(var_names);
-                        error_oom();
-                    }
+                if (var_count + 1 > var_cap)
+                    var_names = grow_array(parser,
+                                           var_names,
+                                           &var_cap,
+                                           sizeof(*var_names));
 
-                    var_names = temp_ptr;
-                    var_cap   = new_cap;
-                }
-
-                var_names[var_count++] =
-                        strdup(parser->look.lexeme ? parser->look.lexeme : "");
+                var_names[var_count++] = copy_lexeme(parser);
                 advance_parser(parser);
 
             } while (match(parser, TOK_COMMA));
@@ -898,24 +807,19 @@ static AstStatement *parse_statement(Parser *parser) {
             // Single declaration
         } else if (parser->look.type == TOK_VARIABLE) {
 
-            var_names = malloc(sizeof(char *));
-
-            if (!var_names)
-                error_oom();
-
-            var_names[0] =
-                    strdup(parser->look.lexeme ? parser->look.lexeme : "");
-            var_count = 1;
-            var_cap   = 1;
+            var_names    = new_node(parser, sizeof(char *));
+            var_names[0] = copy_lexeme(parser);
+            var_count    = 1;
+            var_cap      = 1;
 
             advance_parser(parser);
 
         } else {
 
             ErrorLocation loc = {.file      = parser->lexer->file_path,
-                                 .line      = parser->look.line,
-                                 .col_start = parser->look.column_start,
-                                 .col_end   = parser->look.column_end};
+                                 .line      = parser->at.line,
+                                 .col_start = parser->at.column_start,
+                                 .col_end   = parser->at.column_end};
             error_expect_symbol(loc, "variable name or '('");
         }
 
@@ -937,20 +841,11 @@ static AstStatement *parse_statement(Parser *parser) {
 
                 do {
 
-                    if (init_count + 1 > init_cap) {
-
-                        size_t new_cap = init_cap ? init_cap * 2 : 4;
-                        void  *temp_ptr =
-                                realloc(init_exprs,
-                                        new_cap * sizeof(AstExpression *));
-                        if (!temp_ptr) {
-                            free(init_exprs);
-                            error_oom();
-                        }
-
-                        init_exprs = temp_ptr;
-                        init_cap   = new_cap;
-                    }
+                    if (init_count + 1 > init_cap)
+                        init_exprs = grow_array(parser,
+                                                init_exprs,
+                                                &init_cap,
+                                                sizeof(*init_exprs));
 
                     init_exprs[init_count++] = parse_expression(parser);
 
@@ -961,17 +856,13 @@ static AstStatement *parse_statement(Parser *parser) {
                 // Single initialization
             } else {
 
-                init_exprs = malloc(sizeof(AstExpression *));
-
-                if (!init_exprs)
-                    error_oom();
-
+                init_exprs    = new_node(parser, sizeof(AstExpression *));
                 init_exprs[0] = parse_expression(parser);
                 init_count    = 1;
             }
         }
 
-        AstStatement *statement = calloc(1, sizeof(*statement));
+        AstStatement *statement = new_node(parser, sizeof(*statement));
 
         statement->tag                 = STM_VAR_DECL;
         statement->line                = line;
@@ -987,35 +878,350 @@ static AstStatement *parse_statement(Parser *parser) {
     }
 
     ErrorLocation loc = {.file      = parser->lexer->file_path,
-                         .line      = parser->look.line,
-                         .col_start = parser->look.column_start,
-                         .col_end   = parser->look.column_end};
+                         .line      = parser->at.line,
+                         .col_start = parser->at.column_start,
+                         .col_end   = parser->at.column_end};
     error_expect_symbol(loc, "statement or declaration");
 
     return NULL;
 }
 
-static AstBlock *parse_block(Parser *parser) {
-    // Increase program depth and
-    // check if it exceeds the
-    // complexity limit
-    parser->depth++;
-    if (parser->depth > DEPTH_LIMIT)
-        error_complexity();
+/* Hand a finished statement to the sink. Nothing parsed so far is needed
+ * after it, so the nodes are dropped */
+static void sink_statement(Parser *parser, AstStatement *statement) {
+
+    parser->sink->statement(parser->sink->context, statement);
+    arena_reset(parser->nodes);
+}
+
+static void sink_otherwise(Parser *parser) {
+
+    if (parser->sink)
+        parser->sink->otherwise(parser->sink->context);
+}
+
+static void sink_close(Parser *parser) {
+
+    if (parser->sink)
+        parser->sink->close(parser->sink->context);
+}
+
+/* Bodies are only skipped with a sink while reading ahead */
+static void sink_declaration(Parser *parser, AstDeclaration *declaration) {
+
+    if (!parser->sink)
+        return;
+
+    if (parser->lazy)
+        parser->sink->ahead(parser->sink->context, declaration);
+    else
+        parser->sink->declaration(parser->sink->context, declaration);
+}
+
+/* A block being parsed and the if or while it belongs to, if any. An
+ * else-if has no block of its own and waits for the if that follows it */
+typedef enum {
+
+    OPEN_BLOCK,
+    OPEN_IF,
+    OPEN_ELSE,
+    OPEN_ELSE_IF,
+    OPEN_WHILE
+
+} OpenKind;
+
+typedef struct OpenBlock {
+
+    OpenKind       kind;
+    AstBlock      *block;
+    int            line;
+    int            column_start;
+    AstExpression *condition;
+    AstBlock      *then_block;
+
+} OpenBlock;
+
+static void push_open(Parser *parser, OpenBlock open) {
+
+    parser->open = reserve_stack(parser->open,
+                                 parser->open_count,
+                                 &parser->open_cap,
+                                 sizeof(*parser->open));
+
+    parser->open[parser->open_count++] = open;
+}
+
+/* Start the block of open at its '{'. A sink takes the statements, so
+ * the block is never built */
+static void open_block(Parser *parser, OpenBlock open) {
 
     expect(parser, TOK_LBRACE, "'{'");
-    AstBlock *block = calloc(1, sizeof(*block));
+
+    if (!parser->sink)
+        open.block = new_node(parser, sizeof(*open.block));
 
     while (parser->look.type == TOK_NEWLINE)
         advance_parser(parser);
 
-    while (parser->look.type != TOK_RBRACE) {
+    push_open(parser, open);
+}
+
+/* Read an if or while up to its condition and open its block */
+static void open_branch(Parser *parser) {
+
+    OpenBlock open = {.kind         = OPEN_WHILE,
+                      .line         = parser->at.line,
+                      .column_start = parser->at.column_start};
+
+    if (parser->look.type == TOK_IF)
+        open.kind = OPEN_IF;
+
+    advance_parser(parser);
+
+    open.condition = parse_expression(parser);
+    open_block(parser, open);
+
+    if (parser->sink) {
+
+        AstStatement *statement = new_node(parser, sizeof(*statement));
+
+        statement->tag                = open.kind == OPEN_IF ? STM_IF
+                                                             : STM_WHILE;
+        statement->line               = open.line;
+        statement->column_start       = open.column_start;
+        statement->column_end         = open.condition->column_end;
+        statement->if_stmt.condition  = open.condition;
+        statement->if_stmt.then_block = NULL;
+        statement->if_stmt.else_block = NULL;
+
+        parser->open[parser->open_count - 1].condition = NULL;
+        sink_statement(parser, statement);
+    }
+}
+
+static AstStatement *new_if(Parser          *parser,
+                            const OpenBlock *open,
+                            AstBlock        *else_block) {
+
+    AstBlock *then_block = open->then_block;
+
+    int col_end =
+            then_block
+                    ? then_block->len > 0
+                              ? then_block->statements[then_block->len - 1]
+                                        ->column_end
+                              : open->column_start
+                    : open->column_start;
+
+    AstStatement *statement = new_node(parser, sizeof(*statement));
+
+    statement->tag                = STM_IF;
+    statement->line               = open->line;
+    statement->column_start       = open->column_start;
+    statement->column_end         = col_end;
+    statement->if_stmt.condition  = open->condition;
+    statement->if_stmt.then_block = then_block;
+    statement->if_stmt.else_block = else_block;
+
+    return statement;
+}
+
+/* Finish the if or while whose block just ended at its '}'. An if followed
+ * by else opens the else block, or an else-if and the if after it, and
+ * gives NULL until that completes it */
+static AstStatement *close_branch(Parser *parser, OpenBlock open) {
+
+    if (open.kind == OPEN_WHILE) {
+
+        sink_close(parser);
+
+        AstBlock *body = open.block;
+
+        int col_end = body && body->len > 0
+                              ? body->statements[body->len - 1]->column_end
+                              : open.column_start;
+
+        AstStatement *statement = new_node(parser, sizeof(*statement));
+
+        statement->tag                = STM_WHILE;
+        statement->line               = open.line;
+        statement->column_start       = open.column_start;
+        statement->column_end         = col_end;
+        statement->if_stmt.condition  = open.condition;
+        statement->if_stmt.then_block = body;
+        statement->if_stmt.else_block = NULL;
+
+        return statement;
+    }
+
+    if (open.kind == OPEN_ELSE) {
+
+        sink_close(parser);
+        return new_if(parser, &open, open.block);
+    }
+
+    open.then_block = open.block;
+
+    if (parser->look.type != TOK_ELSE) {
+
+        sink_close(parser);
+        return new_if(parser, &open, NULL);
+    }
+
+    advance_parser(parser);
+    sink_otherwise(parser);
+
+    if (parser->look.type == TOK_IF) {
+
+        open.kind = OPEN_ELSE_IF;
+        push_open(parser, open);
+        open_branch(parser);
+
+    } else {
+
+        open.kind = OPEN_ELSE;
+        open_block(parser, open);
+    }
+
+    return NULL;
+}
+
+/* Go on after a syntax error in the body whose block is open at base - 1,
+ * from the next statement. Tokens are skipped past the line break ending
+ * the statement and any braces opened on the way, or up to a '}' that may
+ * close a block. The body is marked broken for the checker to pass by, and
+ * an else-if waiting on its if is dropped with it. False if the body runs
+ * on to the end of the source */
+static bool sync_statement(Parser *parser, size_t base) {
+
+    parser->op_count      = 0;
+    parser->operand_count = 0;
+
+    while (parser->open_count > base &&
+           parser->open[parser->open_count - 1].kind == OPEN_ELSE_IF)
+        parser->open_count--;
+
+    parser->open[base - 1].block->broken = true;
+
+    for (size_t depth = 0; parser->look.type != TOK_EOF;
+         advance_parser(parser)) {
+
+        if (parser->look.type == TOK_LBRACE) {
+
+            depth++;
+
+        } else if (parser->look.type == TOK_RBRACE) {
+
+            if (depth == 0)
+                return true;
+
+            depth--;
+
+        } else if (parser->look.type == TOK_NEWLINE && depth == 0) {
+
+            while (parser->look.type == TOK_NEWLINE)
+                advance_parser(parser);
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/* Parse a block and every block nested in it without recursing. Each if
+ * and while keeps its block open on the parser's stack until its '}', and
+ * a completed statement goes to the innermost block still open, or to the
+ * sink as soon as it ends. A recovering parser reports a syntax error and
+ * goes on with the next statement, and a body left open at the end of the
+ * source is given up to parse_program() */
+static AstBlock *parse_block(Parser *parser) {
 
-        AstStatement *statement = parse_statement(parser);
-        vector_push((void ***)&block->statements,
-                    &block->len,
-                    &block->cap,
-                    statement);
+    jmp_buf           recover;
+    jmp_buf *volatile outer = NULL;
+
+    open_block(parser, (OpenBlock){.kind = OPEN_BLOCK});
+
+    size_t base = parser->open_count;
+
+    if (parser->recover) {
+
+        outer = error_recover(&recover);
+
+        if (setjmp(recover) && !sync_statement(parser, base)) {
+
+            error_recover(outer);
+            error_unwind();
+        }
+    }
+
+    for (;;) {
+
+        AstStatement *statement;
+
+        if (parser->look.type == TOK_IF || parser->look.type == TOK_WHILE) {
+
+            open_branch(parser);
+            continue;
+        }
+
+        if (parser->look.type != TOK_RBRACE) {
+
+            statement = parse_statement(parser);
+
+        } else {
+
+            expect(parser, TOK_RBRACE, "'}'");
+
+            OpenBlock open = parser->open[--parser->open_count];
+
+            if (open.kind == OPEN_BLOCK) {
+
+                if (parser->recover)
+                    error_recover(outer);
+
+                sink_close(parser);
+                return open.block;
+            }
+
+            statement = close_branch(parser, open);
+            if (!statement)
+                continue;
+        }
+
+        // A finished if is the else block of any else-if waiting on it
+        while (parser->open[parser->open_count - 1].kind == OPEN_ELSE_IF) {
+
+            OpenBlock open = parser->open[--parser->open_count];
+
+            if (parser->sink) {
+
+                sink_close(parser);
+                continue;
+            }
+
+            AstBlock *else_block = new_node(parser, sizeof(*else_block));
+
+            else_block->statements = new_node(parser, sizeof(AstStatement *));
+
+            else_block->statements[0] = statement;
+            else_block->len           = 1;
+            else_block->cap           = 1;
+
+            statement = new_if(parser, &open, else_block);
+        }
+
+        AstBlock *block = parser->open[parser->open_count - 1].block;
+
+        // The sink has had an if or while piece by piece already
+        if (!parser->sink)
+            vector_push(parser,
+                        (void ***)&block->statements,
+                        &block->len,
+                        &block->cap,
+                        statement);
+        else if (statement->tag != STM_IF && statement->tag != STM_WHILE)
+            sink_statement(parser, statement);
 
         if (parser->look.type != TOK_RBRACE) {
 
@@ -1029,57 +1235,89 @@ static AstBlock *parse_block(Parser *parser) {
             } else {
 
                 ErrorLocation loc = {.file      = parser->lexer->file_path,
-                                     .line      = parser->look.line,
-                                     .col_start = parser->look.column_start,
-                                     .col_end   = parser->look.column_end};
+                                     .line      = parser->at.line,
+                                     .col_start = parser->at.column_start,
+                                     .col_end   = parser->at.column_end};
                 error_expect_symbol(loc, "newline or end of block");
             }
         }
     }
-
-    expect(parser, TOK_RBRACE, "'}'");
-
-    return block;
 }
 
 static AstDeclaration *parse_entry_decl(Parser *parser) {
 
-    int line      = parser->look.line;
-    int col_start = parser->look.column_start;
-    int col_end   = parser->look.column_end;
+    int line      = parser->at.line;
+    int col_start = parser->at.column_start;
+    int col_end   = parser->at.column_end;
 
     expect(parser, TOK_ENTRY, "'entry'");
 
-    AstBlock       *block       = parse_block(parser);
-    AstDeclaration *declaration = calloc(1, sizeof(*declaration));
+    AstDeclaration *declaration = new_node(parser, sizeof(*declaration));
 
     declaration->tag          = DEC_ENTRY;
     declaration->line         = line;
     declaration->column_start = col_start;
     declaration->column_end   = col_end;
-    declaration->entry.block  = block;
+
+    sink_declaration(parser, declaration);
+
+    // A sink has taken the body, and its nodes are gone with it
+    AstBlock *block = parse_block(parser);
+    if (parser->sink)
+        return NULL;
+
+    declaration->entry.block = block;
 
     return declaration;
 }
 
+/* Step over a function body by matching braces alone, returning where its
+ * '{' is so parse_function_body() can come back to it. Nothing inside is
+ * parsed, so only lexical errors and a missing '}' are found now */
+static size_t skip_body(Parser *parser) {
+
+    size_t body_at = parser->tokens ? parser->next - 1 : parser->look.offset;
+
+    expect(parser, TOK_LBRACE, "'{'");
+
+    for (size_t depth = 1; depth > 0; advance_parser(parser)) {
+
+        if (parser->look.type == TOK_EOF) {
+
+            ErrorLocation loc = {.file      = parser->lexer->file_path,
+                                 .line      = parser->at.line,
+                                 .col_start = parser->at.column_start,
+                                 .col_end   = parser->at.column_end};
+            error_expect_symbol(loc, "'}'");
+        }
+
+        if (parser->look.type == TOK_LBRACE)
+            depth++;
+        else if (parser->look.type == TOK_RBRACE)
+            depth--;
+    }
+
+    return body_at;
+}
+
 static AstDeclaration *parse_func_decl(Parser *parser) {
 
-    int line      = parser->look.line;
-    int col_start = parser->look.column_start;
-    int col_end   = parser->look.column_end;
+    int line      = parser->at.line;
+    int col_start = parser->at.column_start;
+    int col_end   = parser->at.column_end;
 
     expect(parser, TOK_FUNC, "'func'");
 
     if (parser->look.type != TOK_VARIABLE) {
 
         ErrorLocation loc = {.file      = parser->lexer->file_path,
-                             .line      = parser->look.line,
-                             .col_start = parser->look.column_start,
-                             .col_end   = parser->look.column_end};
+                             .line      = parser->at.line,
+                             .col_start = parser->at.column_start,
+                             .col_end   = parser->at.column_end};
         error_expect_symbol(loc, "function name");
     }
 
-    char *name = strdup(parser->look.lexeme ? parser->look.lexeme : "");
+    char *name = copy_lexeme(parser);
     advance_parser(parser);
 
     expect(parser, TOK_LPAREN, "'('");
@@ -1095,30 +1333,22 @@ static AstDeclaration *parse_func_decl(Parser *parser) {
             if (parser->look.type != TOK_VARIABLE) {
 
                 ErrorLocation loc = {.file      = parser->lexer->file_path,
-                                     .line      = parser->look.line,
-                                     .col_start = parser->look.column_start,
-                                     .col_end   = parser->look.column_end};
+                                     .line      = parser->at.line,
+                                     .col_start = parser->at.column_start,
+                                     .col_end   = parser->at.column_end};
                 error_expect_symbol(loc, "parameter name");
             }
 
-            if (param_count + 1 > param_cap) {
-
-                size_t new_cap  = param_cap ? param_cap * 2 : 4;
-                void  *temp_ptr = realloc(params, new_cap * sizeof(AstParam));
-                if (!temp_ptr) {
-                    free(params);
-                    error_oom();
-                }
-
-                params    = temp_ptr;
-                param_cap = new_cap;
-            }
+            if (param_count + 1 > param_cap)
+                params = grow_array(parser,
+                                    params,
+                                    &param_cap,
+                                    sizeof(*params));
 
-            params[param_count].name =
-                    strdup(parser->look.lexeme ? parser->look.lexeme : "");
-            params[param_count].line         = parser->look.line;
-            params[param_count].column_start = parser->look.column_start;
-            params[param_count].column_end   = parser->look.column_end;
+            params[param_count].name         = copy_lexeme(parser);
+            params[param_count].line         = parser->at.line;
+            params[param_count].column_start = parser->at.column_start;
+            params[param_count].column_end   = parser->at.column_end;
 
             advance_parser(parser);
 
@@ -1139,12 +1369,7 @@ static AstDeclaration *parse_func_decl(Parser *parser) {
 
     TokenType return_type = parse_type_annotation(parser, true, &col_end);
 
-    AstBlock *body = parse_block(parser);
-
-    AstDeclaration *declaration = calloc(1, sizeof(*declaration));
-
-    if (!declaration)
-        error_oom();
+    AstDeclaration *declaration = new_node(parser, sizeof(*declaration));
 
     declaration->tag              = DEC_FUNC;
     declaration->line             = line;
@@ -1154,16 +1379,30 @@ static AstDeclaration *parse_func_decl(Parser *parser) {
     declaration->func.params      = params;
     declaration->func.param_count = param_count;
     declaration->func.return_type = return_type;
-    declaration->func.body        = body;
+
+    sink_declaration(parser, declaration);
+
+    if (parser->lazy) {
+
+        declaration->func.body_at = skip_body(parser);
+
+    } else {
+
+        AstBlock *body = parse_block(parser);
+        if (parser->sink)
+            return NULL;
+
+        declaration->func.body = body;
+    }
 
     return declaration;
 }
 
 static AstDeclaration *parse_var_decl(Parser *parser) {
 
-    int line      = parser->look.line;
-    int col_start = parser->look.column_start;
-    int col_end   = parser->look.column_end;
+    int line      = parser->at.line;
+    int col_start = parser->at.column_start;
+    int col_end   = parser->at.column_end;
 
     expect(parser, TOK_LET, "'let'");
 
@@ -1181,27 +1420,19 @@ static AstDeclaration *parse_var_decl(Parser *parser) {
             if (parser->look.type != TOK_VARIABLE) {
 
                 ErrorLocation loc = {.file      = parser->lexer->file_path,
-                                     .line      = parser->look.line,
-                                     .col_start = parser->look.column_start,
-                                     .col_end   = parser->look.column_end};
+                                     .line      = parser->at.line,
+                                     .col_start = parser->at.column_start,
+                                     .col_end   = parser->at.column_end};
                 error_expect_symbol(loc, "variable name");
             }
 
-            if (var_count + 1 > var_cap) {
+            if (var_count + 1 > var_cap)
+                var_names = grow_array(parser,
+                                       var_names,
+                                       &var_cap,
+                                       sizeof(*var_names));
 
-                size_t new_cap  = var_cap ? var_cap * 2 : 4;
-                void  *temp_ptr = realloc(var_names, new_cap * sizeof(char *));
-                if (!temp_ptr) {
-                    free(var_names);
-                    error_oom();
-                }
-
-                var_names = temp_ptr;
-                var_cap   = new_cap;
-            }
-
-            var_names[var_count++] =
-                    strdup(parser->look.lexeme ? parser->look.lexeme : "");
+            var_names[var_count++] = copy_lexeme(parser);
             advance_parser(parser);
 
         } while (match(parser, TOK_COMMA));
@@ -1211,12 +1442,8 @@ static AstDeclaration *parse_var_decl(Parser *parser) {
         // Single declaration
     } else if (parser->look.type == TOK_VARIABLE) {
 
-        var_names = malloc(sizeof(char *));
-
-        if (!var_names)
-            error_oom();
-
-        var_names[0] = strdup(parser->look.lexeme ? parser->look.lexeme : "");
+        var_names    = new_node(parser, sizeof(char *));
+        var_names[0] = copy_lexeme(parser);
         var_count    = 1;
         var_cap      = 1;
 
@@ -1225,9 +1452,9 @@ static AstDeclaration *parse_var_decl(Parser *parser) {
     } else {
 
         ErrorLocation loc = {.file      = parser->lexer->file_path,
-                             .line      = parser->look.line,
-                             .col_start = parser->look.column_start,
-                             .col_end   = parser->look.column_end};
+                             .line      = parser->at.line,
+                             .col_start = parser->at.column_start,
+                             .col_end   = parser->at.column_end};
         error_expect_symbol(loc, "variable name or '('");
     }
 
@@ -1235,7 +1462,7 @@ static AstDeclaration *parse_var_decl(Parser *parser) {
 
     TokenType var_type = parse_type_annotation(parser, false, &col_end);
 
-    AstDeclaration *declaration = calloc(1, sizeof(*declaration));
+    AstDeclaration *declaration = new_node(parser, sizeof(*declaration));
 
     declaration->tag                = DEC_VAR;
     declaration->line               = line;
@@ -1245,226 +1472,242 @@ static AstDeclaration *parse_var_decl(Parser *parser) {
     declaration->var_decl.var_count = var_count;
     declaration->var_decl.var_type  = var_type;
 
+    sink_declaration(parser, declaration);
+
     return declaration;
 }
 
-AstProgram *parse_program(Parser *parser) {
+/* Parse the declaration starting at the current token, and the line breaks
+ * after it, leaving the parser on the next declaration or EOF */
+AstDeclaration *parse_declaration(Parser *parser) {
 
-    AstProgram *program = calloc(1, sizeof(*program));
+    AstDeclaration *declaration = NULL;
 
-    while (parser->look.type == TOK_NEWLINE)
-        advance_parser(parser);
+    if (parser->look.type == TOK_ENTRY) {
 
-    while (parser->look.type != TOK_EOF) {
+        declaration = parse_entry_decl(parser);
 
-        while (parser->look.type == TOK_NEWLINE)
-            advance_parser(parser);
+    } else if (parser->look.type == TOK_LET) {
 
-        if (parser->look.type == TOK_EOF)
-            break;
+        declaration = parse_var_decl(parser);
 
-        AstDeclaration *declaration = NULL;
+    } else if (parser->look.type == TOK_FUNC) {
 
-        if (parser->look.type == TOK_ENTRY) {
+        declaration = parse_func_decl(parser);
 
-            declaration = parse_entry_decl(parser);
+    } else {
 
-        } else if (parser->look.type == TOK_LET) {
+        ErrorLocation loc = {.file      = parser->lexer->file_path,
+                             .line      = parser->at.line,
+                             .col_start = parser->at.column_start,
+                             .col_end   = parser->at.column_end};
+        error_invalid_token(loc);
+    }
 
-            declaration = parse_var_decl(parser);
+    while (parser->look.type == TOK_NEWLINE)
+        advance_parser(parser);
 
-        } else if (parser->look.type == TOK_FUNC) {
+    return declaration;
+}
 
-            declaration = parse_func_decl(parser);
+/* Go on after a syntax error outside any body, from the next line starting
+ * a declaration outside any braces. The program is marked broken, as what
+ * the lost declaration named can't be known to the checker */
+static void sync_declaration(Parser *parser, AstProgram *program) {
 
-        } else {
+    bool line_start = false;
 
-            ErrorLocation loc = {.file      = parser->lexer->file_path,
-                                 .line      = parser->look.line,
-                                 .col_start = parser->look.column_start,
-                                 .col_end   = parser->look.column_end};
-            error_invalid_token(loc);
-        }
+    program->broken       = true;
+    parser->op_count      = 0;
+    parser->operand_count = 0;
+    parser->open_count    = 0;
 
-        vector_push((void ***)&program->declarations,
-                    &program->len,
-                    &program->cap,
-                    declaration);
-
-        while (parser->look.type == TOK_NEWLINE)
-            advance_parser(parser);
-    }
+    for (size_t depth = 0; parser->look.type != TOK_EOF;
+         advance_parser(parser)) {
 
-    return program;
-}
+        TokenType type = parser->look.type;
 
-static void free_expression(AstExpression *expression) {
+        if (depth == 0 && line_start &&
+            (type == TOK_FUNC || type == TOK_ENTRY || type == TOK_LET))
+            return;
 
-    if (!expression)
-        return;
+        line_start = type == TOK_NEWLINE;
 
-    switch (expression->tag) {
+        if (type == TOK_LBRACE)
+            depth++;
+        else if (type == TOK_RBRACE && depth > 0)
+            depth--;
+    }
+}
 
-        case EXP_STRING:
-            free(expression->str_lit.value);
-            break;
-        case EXP_INTEGER:
-            break;
-        case EXP_FLOAT:
-            break;
-        case EXP_BOOLEAN:
-            break;
-        case EXP_VARIABLE:
-            free(expression->variable.name);
-            break;
-        case EXP_CALL: {
+/* Parse every declaration into the program, or with a sink hand each over
+ * and keep none, leaving the program empty. A recovering parser reports
+ * every syntax error it meets and leaves giving up to the caller, with the
+ * program and any body that lost something to one marked broken */
+AstProgram *parse_program(Parser *parser) {
 
-            for (size_t i = 0; i < expression->call.arg_count; i++) {
+    jmp_buf           recover;
+    jmp_buf *volatile outer = NULL;
 
-                free_expression(expression->call.args[i]);
-            }
+    AstProgram *program = arena_alloc(parser->lexer->arena, sizeof(*program));
 
-            free(expression->call.args);
-            free(expression->call.func_name);
+    if (parser->lazy)
+        program->deferred = parser;
 
-        } break;
+    while (parser->look.type == TOK_NEWLINE)
+        advance_parser(parser);
 
-        case EXP_BINARY: {
+    if (parser->recover) {
 
-            free_expression(expression->binary.left);
-            free_expression(expression->binary.right);
+        outer = error_recover(&recover);
 
-        } break;
+        if (setjmp(recover))
+            sync_declaration(parser, program);
+    }
 
-        case EXP_UNARY: {
+    while (parser->look.type != TOK_EOF) {
 
-            free_expression(expression->unary.expr);
+        AstDeclaration *declaration = parse_declaration(parser);
 
-        } break;
+        if (!parser->sink)
+            vector_push(parser,
+                        (void ***)&program->declarations,
+                        &program->len,
+                        &program->cap,
+                        declaration);
     }
 
-    free(expression);
-}
-
-static void free_statement(AstStatement *statement) {
-
-    if (!statement)
-        return;
+    if (parser->recover)
+        error_recover(outer);
 
-    switch (statement->tag) {
+    return program;
+}
 
-        case STM_OUT:
-            free_expression(statement->out.expression);
-            break;
+/* Parse the body of a function that parse_program() skipped, once it turns
+ * out to be needed. The parser goes back to the body's '{' and is left
+ * after its '}' */
+AstBlock *parse_function_body(Parser *parser, AstDeclaration *declaration) {
 
-        case STM_ASSIGN: {
+    if (parser->tokens) {
 
-            free(statement->assign.var_name);
-            free_expression(statement->assign.expression);
+        parser->next = declaration->func.body_at;
 
-        } break;
+    } else {
 
-        case STM_VAR_DECL: {
+        seek_lexer(parser->lexer, declaration->func.body_at);
 
-            for (size_t i = 0; i < statement->var_decl.var_count; i++) {
+        // Bodies come back out of order, so locate from scratch
+        parser->line_hint = SIZE_MAX;
+    }
 
-                free(statement->var_decl.var_names[i]);
-            }
+    advance_parser(parser);
 
-            free(statement->var_decl.var_names);
+    declaration->func.body = parse_block(parser);
 
-            for (size_t i = 0; i < statement->var_decl.init_count; i++) {
+    return declaration->func.body;
+}
 
-                free_expression(statement->var_decl.init_exprs[i]);
-            }
+/* Read on from the statement just parsed to the end of the source, giving
+ * every declaration still ahead to the sink with its body skipped, then go
+ * back to where parsing left off. A token buffer or a loaded source can be
+ * read twice, a stream cannot. Anything that doesn't start a declaration
+ * ends the scan, and is left for the parser to report once it gets there */
+void scan_declarations(Parser *parser) {
 
-            free(statement->var_decl.init_exprs);
+    Token      look      = parser->look;
+    SourceSpan at        = parser->at;
+    size_t     next      = parser->next;
+    size_t     line_hint = parser->line_hint;
+    size_t     pos       = parser->lexer->pos;
 
-        } break;
+    // Braces can't appear within a statement, so only the blocks still open
+    // around it stand before the next declaration
+    for (size_t depth = parser->open_count; depth > 0;
+         advance_parser(parser)) {
 
-        case STM_RETURN:
-            free_expression(statement->ret.expression);
-            break;
-        case STM_EXPR:
-            free_expression(statement->expr.expression);
+        if (parser->look.type == TOK_EOF)
             break;
-        case STM_IF: {
 
-            free_expression(statement->if_stmt.condition);
-            free_block(statement->if_stmt.then_block);
-            free_block(statement->if_stmt.else_block);
+        if (parser->look.type == TOK_LBRACE)
+            depth++;
+        else if (parser->look.type == TOK_RBRACE)
+            depth--;
+    }
 
-        } break;
-        case STM_WHILE: {
+    parser->lazy = true;
 
-            free_expression(statement->if_stmt.condition);
-            free_block(statement->if_stmt.then_block);
+    while (parser->look.type != TOK_EOF) {
 
-        } break;
-    }
+        if (parser->look.type == TOK_NEWLINE) {
 
-    free(statement);
-}
+            advance_parser(parser);
 
-static void free_block(AstBlock *block) {
+        } else if (parser->look.type == TOK_ENTRY) {
 
-    if (!block)
-        return;
+            advance_parser(parser);
+            skip_body(parser);
 
-    for (size_t i = 0; i < block->len; i++)
-        free_statement(block->statements[i]);
+        } else if (parser->look.type == TOK_LET) {
 
-    free(block->statements);
-    free(block);
-}
+            parse_var_decl(parser);
 
-static void free_declaration(AstDeclaration *declaration) {
+        } else if (parser->look.type == TOK_FUNC) {
 
-    if (!declaration)
-        return;
+            parse_func_decl(parser);
 
-    switch (declaration->tag) {
+        } else {
 
-        case DEC_ENTRY:
-            free_block(declaration->entry.block);
             break;
+        }
+    }
 
-        case DEC_VAR: {
-
-            for (size_t i = 0; i < declaration->var_decl.var_count; i++) {
+    parser->lazy       = false;
+    parser->look       = look;
+    parser->at         = at;
+    parser->next       = next;
+    parser->line_hint  = line_hint;
+    parser->lexer->pos = pos;
+}
 
-                free(declaration->var_decl.var_names[i]);
-            }
+/* Go back to the start of the source, from wherever parsing stopped, even
+ * partway through a statement. Tokens are read again from a token buffer
+ * or a loaded source, and what was parsed before stays in the arena */
+void rewind_parser(Parser *parser) {
 
-            free(declaration->var_decl.var_names);
+    parser->next          = 0;
+    parser->line_hint     = 0;
+    parser->op_count      = 0;
+    parser->operand_count = 0;
+    parser->open_count    = 0;
 
-        } break;
-        case DEC_FUNC: {
+    if (!parser->tokens)
+        seek_lexer(parser->lexer, 0);
 
-            free(declaration->func.name);
+    advance_parser(parser);
+}
 
-            for (size_t i = 0; i < declaration->func.param_count; i++) {
+/* Carry on parsing from offset in a loaded source, which must be where a
+ * token starts outside any statement, skipping line breaks there. Lines are
+ * located from scratch, as offset may be anywhere */
+void seek_parser(Parser *parser, size_t offset) {
 
-                free(declaration->func.params[i].name);
-            }
+    seek_lexer(parser->lexer, offset);
 
-            free(declaration->func.params);
-            free_block(declaration->func.body);
-
-        } break;
-    }
+    parser->line_hint = SIZE_MAX;
+    advance_parser(parser);
 
-    free(declaration);
+    while (parser->look.type == TOK_NEWLINE)
+        advance_parser(parser);
 }
 
-void free_program(AstProgram *program) {
-
-    if (!program)
-        return;
+/* Release the parser's stacks, the AST stays in the lexer's arena */
+void free_parser(Parser *parser) {
 
-    for (size_t i = 0; i < program->len; i++)
-        free_declaration(program->declarations[i]);
+    free(parser->ops);
+    free(parser->operands);
+    free(parser->open);
 
-    free(program->declarations);
-    free(program);
+    parser->ops      = NULL;
+    parser->operands = NULL;
+    parser->open     = NULL;
 }
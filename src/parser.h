@@ -5,6 +5,7 @@
 #include <stddef.h>
 
 #include "lexer.h"
+#include "ring.h"
 
 typedef enum {
 
@@ -48,6 +49,12 @@ typedef struct AstExpression {
     int           column_start;
     int           column_end;
 
+    // Filled in by the checker: the resolved type, and for variables and
+    // calls the local, global or function slot the name refers to
+    TokenType type;
+    bool      is_local;
+    size_t    slot;
+
     union {
 
         struct {
@@ -108,6 +115,8 @@ typedef struct {
         struct {
             char          *var_name;
             AstExpression *expression;
+            bool           is_local; // Resolved target, set by the checker
+            size_t         slot;
         } assign;
         struct {
 
@@ -116,6 +125,7 @@ typedef struct {
             TokenType       var_type;
             AstExpression **init_exprs;
             size_t          init_count;
+            size_t          first_slot; // Local of the first var, from checker
 
         } var_decl;
         struct {
@@ -137,6 +147,7 @@ struct AstBlock {
 
     AstStatement **statements;
     size_t         len, cap;
+    bool           broken; // Statements were lost to a syntax error
 };
 
 typedef struct {
@@ -164,29 +175,76 @@ typedef struct {
             AstParam *params;
             size_t    param_count;
             TokenType return_type;
-            AstBlock *body;
+            AstBlock *body;    // NULL while a skipped body waits to be parsed
+            size_t    body_at; // Its '{' as a token index or source offset
 
         } func;
     };
 
 } AstDeclaration;
 
+typedef struct Parser Parser;
+
+/* Takes a program piece by piece as it is parsed, in place of an AST. A
+ * declaration arrives before its body, and each statement as soon as it
+ * ends. An if or while arrives as its block opens, without blocks, then
+ * otherwise() marks where an else starts and close() the end of its last
+ * block, as it does the end of a body. Declarations found by reading ahead
+ * go to ahead() instead, with their bodies skipped */
+typedef struct {
+
+    void *context;
+    void (*declaration)(void *context, AstDeclaration *declaration);
+    void (*ahead)(void *context, AstDeclaration *declaration);
+    void (*statement)(void *context, AstStatement *statement);
+    void (*otherwise)(void *context);
+    void (*close)(void *context);
+
+} ParseSink;
+
 typedef struct {
 
     AstDeclaration **declarations;
     size_t           len, cap;
+    Parser          *deferred; // Parses skipped function bodies, or NULL
+    bool             broken;   // Declarations were lost to a syntax error
 
 } AstProgram;
 
-typedef struct {
-    Lexer *lexer;
-    Token  look;
-    size_t depth;
-} Parser;
-
-Parser      init_parser(Lexer *lexer);
-AstProgram *parse_program(Parser *parser);
-void        free_program(AstProgram *program);
-void        free_token(Token *token);
+struct Parser {
+    Lexer             *lexer;
+    const TokenBuffer *tokens;    // Lexed up front, or NULL to pull tokens
+    TokenRing         *ring;      // Lexed on another thread, or NULL
+    size_t             next;      // Index in tokens of the one after look
+    Token              look;
+    SourceSpan         at;        // Where look sits in the source
+    size_t             line_hint; // Line of the last token located
+    bool               lazy;      // Skip function bodies until they're needed
+    bool               recover;   // Go on past a syntax error to the next
+    Arena             *nodes;     // AST nodes, the lexer's arena or scratch
+    ParseSink         *sink;      // Takes the program instead of the AST
+
+    // Operators, operands and blocks still open, kept on the heap in place
+    // of recursion so nesting depth is bounded only by memory
+    struct PendingOp *ops;
+    size_t            op_count, op_cap;
+    AstExpression   **operands;
+    size_t            operand_count, operand_cap;
+    struct OpenBlock *open;
+    size_t            open_count, open_cap;
+};
+
+Parser          init_parser(Lexer             *lexer,
+                            const TokenBuffer *tokens,
+                            TokenRing         *ring,
+                            bool               lazy);
+AstProgram     *parse_program(Parser *parser);
+AstDeclaration *parse_declaration(Parser *parser);
+AstBlock       *parse_function_body(Parser         *parser,
+                                    AstDeclaration *declaration);
+void            scan_declarations(Parser *parser);
+void            rewind_parser(Parser *parser);
+void            seek_parser(Parser *parser, size_t offset);
+void            free_parser(Parser *parser);
 
 #endif
@@ -0,0 +1,282 @@
+#include "ring.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "scan.h"
+
+// The ring needs POSIX threads and C11 atomics, without them the parser
+// pulls tokens from the lexer itself
+#if defined(_POSIX_C_SOURCE) && !defined(__STDC_NO_ATOMICS__)
+#    define RING_THREADS 1
+#    include <pthread.h>
+#    include <sched.h>
+#    include <stdalign.h>
+#    include <stdatomic.h>
+#    include <unistd.h>
+#endif
+
+#ifdef RING_THREADS
+
+// Slots in the ring, a power of two, and how many are filled or taken
+// between publishing the count to the other side
+#define RING_SLOTS ((size_t)4096)
+#define RING_BATCH ((size_t)64)
+
+// Polls of an empty or full ring before giving up the CPU
+#define RING_SPINS 256
+
+typedef struct {
+
+    Token      token;
+    SourceSpan at;
+
+} RingSlot;
+
+/* Each side only writes its own cache line, and reads the other's count
+ * again only once its cached copy runs out, so a batch of tokens crosses
+ * between cores at the cost of one line */
+struct TokenRing {
+
+    // Written by the lexer's thread
+    alignas(64) atomic_size_t tail; // Slots filled and published
+    atomic_bool finished;           // Set once nothing more will be filled
+    size_t      filled;
+    size_t      head_seen;
+    size_t      fail_at; // Where lexing the token in hand started
+
+    // Written by the parser
+    alignas(64) atomic_size_t head; // Slots taken and published
+    atomic_bool quit;               // The parser stopped before the end
+    size_t      taken;
+    size_t      tail_seen;
+    bool        ended; // EOF was taken, and is given again from eof
+    RingSlot    eof;
+
+    alignas(64) Lexer lexer; // A copy of owner's, allocating from arena
+    Lexer    *owner;
+    Arena     arena;
+    jmp_buf   bail;
+    pthread_t thread;
+    RingSlot  slots[RING_SLOTS];
+};
+
+static void relax(unsigned *spins) {
+
+    if (++*spins < RING_SPINS)
+        return;
+
+    *spins = 0;
+    sched_yield();
+}
+
+/* Wait for a free slot, publishing what was filled first, as the parser may
+ * be waiting on it. False if the parser quit */
+static bool wait_for_room(TokenRing *ring) {
+
+    if (ring->filled - ring->head_seen < RING_SLOTS)
+        return true;
+
+    atomic_store_explicit(&ring->tail, ring->filled, memory_order_release);
+
+    for (unsigned spins = 0;;) {
+
+        ring->head_seen =
+                atomic_load_explicit(&ring->head, memory_order_acquire);
+
+        if (ring->filled - ring->head_seen < RING_SLOTS)
+            return true;
+
+        if (atomic_load_explicit(&ring->quit, memory_order_relaxed))
+            return false;
+
+        relax(&spins);
+    }
+}
+
+/* The lexer's thread. A lexical error stops it where it is, and the parser
+ * lexes that token again itself once it gets there, so errors before it in
+ * the source are still reported first */
+static void *fill_ring(void *arg) {
+
+    TokenRing *ring      = arg;
+    size_t     line_hint = 0;
+
+    ring->lexer.arena = &ring->arena;
+    ring->lexer.bail  = &ring->bail;
+
+    // A lexical error bails out to here, leaving fail_at on its token
+    if (!setjmp(ring->bail)) {
+
+        for (;;) {
+
+            ring->fail_at = ring->lexer.base + ring->lexer.pos;
+
+            Token      token = next_token(&ring->lexer);
+            SourceSpan at    = source_span(
+                    ring->lexer.source, token.offset, token.span, &line_hint);
+
+            if (!wait_for_room(ring))
+                break;
+
+            ring->slots[ring->filled++ & (RING_SLOTS - 1)] =
+                    (RingSlot){.token = token, .at = at};
+
+            if (token.type == TOK_EOF)
+                break;
+
+            if (ring->filled % RING_BATCH == 0)
+                atomic_store_explicit(
+                        &ring->tail, ring->filled, memory_order_release);
+        }
+    }
+
+    atomic_store_explicit(&ring->tail, ring->filled, memory_order_release);
+    atomic_store_explicit(&ring->finished, true, memory_order_release);
+
+    return NULL;
+}
+
+static void teardown_ring(void *ring) {
+
+    stop_token_ring(ring);
+}
+
+/* Start lexing the rest of lexer's source on a new thread, returning NULL if
+ * it can't be started or there is no second CPU for it to run on. lexer
+ * itself is left where it is, and only lexes again if the thread meets an
+ * error */
+TokenRing *start_token_ring(Lexer *lexer) {
+
+    if (lexer->stream || sysconf(_SC_NPROCESSORS_ONLN) < 2)
+        return NULL;
+
+    // Aligned so each side's line is a line of its own
+    TokenRing *ring = aligned_alloc(alignof(TokenRing), sizeof(TokenRing));
+    if (!ring)
+        error_oom();
+
+    memset(ring, 0, sizeof(TokenRing));
+
+    ring->lexer = *lexer;
+    ring->owner = lexer;
+
+    atomic_init(&ring->tail, 0);
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->finished, false);
+    atomic_init(&ring->quit, false);
+
+    // Pick the scanners now, rather than race the thread to
+    scan_impl_name();
+
+    if (pthread_create(&ring->thread, NULL, fill_ring, ring) != 0) {
+
+        free(ring);
+        return NULL;
+    }
+
+    // An error ending the process stops the thread first
+    exit_teardown(teardown_ring, ring);
+
+    return ring;
+}
+
+/* The thread finished without EOF, so it bailed on a lexical error. Lex
+ * that token here instead, which reports it */
+static Token relex_failed(TokenRing *ring, SourceSpan *at) {
+
+    seek_lexer(ring->owner, ring->fail_at);
+
+    Token token = next_token(ring->owner);
+    *at         = source_span(
+            ring->owner->source, token.offset, token.span, NULL);
+
+    return token;
+}
+
+/* Take the next token, waiting for the lexer's thread if it is behind. Once
+ * EOF is taken it is given for every call after */
+Token ring_next(TokenRing *ring, SourceSpan *at) {
+
+    if (ring->ended) {
+
+        *at = ring->eof.at;
+        return ring->eof.token;
+    }
+
+    for (unsigned spins = 0; ring->taken == ring->tail_seen;) {
+
+        // Let the thread reuse everything taken before waiting on it
+        atomic_store_explicit(&ring->head, ring->taken, memory_order_release);
+
+        bool finished =
+                atomic_load_explicit(&ring->finished, memory_order_acquire);
+        ring->tail_seen =
+                atomic_load_explicit(&ring->tail, memory_order_acquire);
+
+        if (ring->taken < ring->tail_seen)
+            break;
+
+        if (finished)
+            return relex_failed(ring, at);
+
+        relax(&spins);
+    }
+
+    RingSlot slot = ring->slots[ring->taken++ & (RING_SLOTS - 1)];
+
+    if (ring->taken % RING_BATCH == 0)
+        atomic_store_explicit(&ring->head, ring->taken, memory_order_release);
+
+    if (slot.token.type == TOK_EOF) {
+
+        ring->ended = true;
+        ring->eof   = slot;
+    }
+
+    *at = slot.at;
+
+    return slot.token;
+}
+
+/* Stop the thread, waiting for it to finish, and free the ring. Strings it
+ * decoded move to the owning lexer's arena, as tokens given out may still
+ * point at them */
+void stop_token_ring(TokenRing *ring) {
+
+    if (!ring)
+        return;
+
+    exit_teardown(NULL, NULL);
+
+    atomic_store_explicit(&ring->quit, true, memory_order_relaxed);
+    pthread_join(ring->thread, NULL);
+
+    arena_adopt(ring->owner->arena, &ring->arena);
+
+    free(ring);
+}
+
+#else
+
+TokenRing *start_token_ring(Lexer *lexer) {
+
+    (void)lexer;
+
+    return NULL;
+}
+
+Token ring_next(TokenRing *ring, SourceSpan *at) {
+
+    (void)ring;
+    (void)at;
+
+    return (Token){.type = TOK_EOF};
+}
+
+void stop_token_ring(TokenRing *ring) {
+
+    (void)ring;
+}
+
+#endif
@@ -0,0 +1,18 @@
+#ifndef RING_H
+#define RING_H
+
+#include "lexer.h"
+
+/* Tokens lexed on a thread of their own and handed to the parser through a
+ * single-producer, single-consumer ring, so lexing a large source overlaps
+ * parsing it. The lexer's thread locates each token in the source as well,
+ * and the parser takes them in order exactly as next_token() would give
+ * them. Only a loaded source can be lexed this way, since a stream's window
+ * and line index change as it is read */
+typedef struct TokenRing TokenRing;
+
+TokenRing *start_token_ring(Lexer *lexer);
+Token      ring_next(TokenRing *ring, SourceSpan *at);
+void       stop_token_ring(TokenRing *ring);
+
+#endif
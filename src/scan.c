@@ -0,0 +1,301 @@
+#include "scan.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Scan 16 or 32 bytes at a time on x86-64 when the compiler can target
+ * SSE2 and AVX2 per function, picking AVX2 at runtime if the CPU has it.
+ * Everything else, and builds with PHASE_SCALAR_SCAN, use the scalar loops,
+ * which give the same results */
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__) && \
+        !defined(PHASE_SCALAR_SCAN)
+#    define SCAN_SIMD 1
+#    include <immintrin.h>
+#else
+#    define SCAN_SIMD 0
+#endif
+
+typedef enum {
+
+    RUN_SPACES,
+    RUN_LINE,
+    RUN_STRING,
+    RUN_IDENT
+
+} RunKind;
+
+static inline bool is_space(char c) {
+
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+static inline bool is_ident_byte(char c) {
+
+    return c == '_' || (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') ||
+           (c >= '0' && c <= '9');
+}
+
+/* Whether c continues a run of the given kind */
+static inline bool in_run(RunKind kind, char c, char quote) {
+
+    switch (kind) {
+
+        case RUN_SPACES:
+            return is_space(c);
+        case RUN_LINE:
+            return c != '\n' && c != '\0';
+        case RUN_STRING:
+            return c != quote && c != '\\' && c != '\n' && c != '\0';
+        case RUN_IDENT:
+            return is_ident_byte(c);
+    }
+
+    return false;
+}
+
+static inline size_t scan_scalar(
+        RunKind kind, const char *src, size_t len, size_t pos, char quote) {
+
+    while (pos < len && in_run(kind, src[pos], quote))
+        pos++;
+
+    return pos;
+}
+
+#if SCAN_SIMD
+
+// AVX2 code is compiled per function and only called when the CPU has it
+#    define SCAN_AVX2 __attribute__((target("avx2")))
+
+/* Bytes in [lo, lo + n) as a signed compare, shifting the range so it starts
+ * at INT8_MIN */
+#    define RANGE_128(v, lo, n)                                                \
+        _mm_cmplt_epi8(_mm_add_epi8((v), _mm_set1_epi8((char)(-128 - (lo)))), \
+                       _mm_set1_epi8((char)(-128 + (n))))
+#    define RANGE_256(v, lo, n)                                     \
+        _mm256_cmpgt_epi8(_mm256_set1_epi8((char)(-128 + (n))),     \
+                          _mm256_add_epi8((v),                      \
+                                          _mm256_set1_epi8(         \
+                                                  (char)(-128 - (lo)))))
+
+/* Mask of the bytes in a 16-byte block that end the run */
+static inline uint32_t stop_mask_sse2(RunKind kind, __m128i v, char quote) {
+
+    __m128i keep;
+
+    switch (kind) {
+
+        case RUN_SPACES:
+            keep = _mm_or_si128(
+                    _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')),
+                                 _mm_cmpeq_epi8(v, _mm_set1_epi8('\t'))),
+                    _mm_cmpeq_epi8(v, _mm_set1_epi8('\r')));
+            break;
+
+        case RUN_LINE:
+            return (uint32_t)_mm_movemask_epi8(
+                    _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')),
+                                 _mm_cmpeq_epi8(v, _mm_setzero_si128())));
+
+        case RUN_STRING:
+            return (uint32_t)_mm_movemask_epi8(_mm_or_si128(
+                    _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(quote)),
+                                 _mm_cmpeq_epi8(v, _mm_set1_epi8('\\'))),
+                    _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')),
+                                 _mm_cmpeq_epi8(v, _mm_setzero_si128()))));
+
+        case RUN_IDENT: {
+
+            // Folding case maps only letters into 'a'..'z'
+            __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+
+            keep = _mm_or_si128(
+                    _mm_or_si128(RANGE_128(lower, 'a', 26),
+                                 RANGE_128(v, '0', 10)),
+                    _mm_cmpeq_epi8(v, _mm_set1_epi8('_')));
+
+        } break;
+
+        default:
+            return 0xFFFF;
+    }
+
+    return ~(uint32_t)_mm_movemask_epi8(keep) & 0xFFFF;
+}
+
+static inline size_t scan_sse2(
+        RunKind kind, const char *src, size_t len, size_t pos, char quote) {
+
+    while (pos + 16 <= len) {
+
+        __m128i  v    = _mm_loadu_si128((const __m128i *)(src + pos));
+        uint32_t stop = stop_mask_sse2(kind, v, quote);
+
+        if (stop)
+            return pos + (size_t)__builtin_ctz(stop);
+
+        pos += 16;
+    }
+
+    return scan_scalar(kind, src, len, pos, quote);
+}
+
+SCAN_AVX2 static inline uint32_t
+stop_mask_avx2(RunKind kind, __m256i v, char quote) {
+
+    __m256i keep;
+
+    switch (kind) {
+
+        case RUN_SPACES:
+            keep = _mm256_or_si256(
+                    _mm256_or_si256(
+                            _mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')),
+                            _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t'))),
+                    _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r')));
+            break;
+
+        case RUN_LINE:
+            return (uint32_t)_mm256_movemask_epi8(_mm256_or_si256(
+                    _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')),
+                    _mm256_cmpeq_epi8(v, _mm256_setzero_si256())));
+
+        case RUN_STRING:
+            return (uint32_t)_mm256_movemask_epi8(_mm256_or_si256(
+                    _mm256_or_si256(
+                            _mm256_cmpeq_epi8(v, _mm256_set1_epi8(quote)),
+                            _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\'))),
+                    _mm256_or_si256(
+                            _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')),
+                            _mm256_cmpeq_epi8(v, _mm256_setzero_si256()))));
+
+        case RUN_IDENT: {
+
+            __m256i lower = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+
+            keep = _mm256_or_si256(
+                    _mm256_or_si256(RANGE_256(lower, 'a', 26),
+                                    RANGE_256(v, '0', 10)),
+                    _mm256_cmpeq_epi8(v, _mm256_set1_epi8('_')));
+
+        } break;
+
+        default:
+            return UINT32_MAX;
+    }
+
+    return ~(uint32_t)_mm256_movemask_epi8(keep);
+}
+
+SCAN_AVX2 static inline size_t scan_avx2(
+        RunKind kind, const char *src, size_t len, size_t pos, char quote) {
+
+    while (pos + 32 <= len) {
+
+        __m256i  v    = _mm256_loadu_si256((const __m256i *)(src + pos));
+        uint32_t stop = stop_mask_avx2(kind, v, quote);
+
+        if (stop)
+            return pos + (size_t)__builtin_ctz(stop);
+
+        pos += 32;
+    }
+
+    return scan_sse2(kind, src, len, pos, quote);
+}
+
+#endif
+
+/* One entry point per run kind and width, so the kind folds away inside */
+#define SCAN_ENTRY(name, kind, width, attr)                                \
+    attr static size_t name##_##width(                                     \
+            const char *src, size_t len, size_t pos, char quote) {         \
+                                                                           \
+        return scan_##width(kind, src, len, pos, quote);                   \
+    }
+
+SCAN_ENTRY(spaces, RUN_SPACES, scalar, )
+SCAN_ENTRY(line, RUN_LINE, scalar, )
+SCAN_ENTRY(string, RUN_STRING, scalar, )
+SCAN_ENTRY(ident, RUN_IDENT, scalar, )
+
+typedef size_t (*ScanFn)(const char *src, size_t len, size_t pos, char quote);
+
+typedef struct {
+
+    const char *name;
+    ScanFn      spaces;
+    ScanFn      line;
+    ScanFn      string;
+    ScanFn      ident;
+
+} ScanImpl;
+
+static const ScanImpl SCALAR_IMPL = {
+        "scalar", spaces_scalar, line_scalar, string_scalar, ident_scalar};
+
+#if SCAN_SIMD
+
+SCAN_ENTRY(spaces, RUN_SPACES, sse2, )
+SCAN_ENTRY(line, RUN_LINE, sse2, )
+SCAN_ENTRY(string, RUN_STRING, sse2, )
+SCAN_ENTRY(ident, RUN_IDENT, sse2, )
+SCAN_ENTRY(spaces, RUN_SPACES, avx2, SCAN_AVX2)
+SCAN_ENTRY(line, RUN_LINE, avx2, SCAN_AVX2)
+SCAN_ENTRY(string, RUN_STRING, avx2, SCAN_AVX2)
+SCAN_ENTRY(ident, RUN_IDENT, avx2, SCAN_AVX2)
+
+static const ScanImpl SSE2_IMPL = {
+        "sse2", spaces_sse2, line_sse2, string_sse2, ident_sse2};
+static const ScanImpl AVX2_IMPL = {
+        "avx2", spaces_avx2, line_avx2, string_avx2, ident_avx2};
+
+#endif
+
+static const ScanImpl *scan_impl = NULL;
+
+/* Pick the widest implementation the CPU supports, once */
+static const ScanImpl *select_scan(void) {
+
+    if (scan_impl)
+        return scan_impl;
+
+#if SCAN_SIMD
+    __builtin_cpu_init();
+    scan_impl = __builtin_cpu_supports("avx2") ? &AVX2_IMPL : &SSE2_IMPL;
+#else
+    scan_impl = &SCALAR_IMPL;
+#endif
+
+    return scan_impl;
+}
+
+size_t scan_spaces(const char *src, size_t len, size_t pos) {
+
+    return select_scan()->spaces(src, len, pos, '\0');
+}
+
+size_t scan_line(const char *src, size_t len, size_t pos) {
+
+    return select_scan()->line(src, len, pos, '\0');
+}
+
+size_t scan_string(const char *src, size_t len, size_t pos, char quote) {
+
+    return select_scan()->string(src, len, pos, quote);
+}
+
+size_t scan_ident(const char *src, size_t len, size_t pos) {
+
+    return select_scan()->ident(src, len, pos, '\0');
+}
+
+void scan_use_scalar(void) {
+
+    scan_impl = &SCALAR_IMPL;
+}
+
+const char *scan_impl_name(void) {
+
+    return select_scan()->name;
+}
@@ -0,0 +1,20 @@
+#ifndef SCAN_H
+#define SCAN_H
+
+#include <stddef.h>
+
+/* Byte-run scanners for the lexer. Each takes the source, its length and a
+ * starting position, and returns the position of the first byte that ends
+ * the run, at most len. None of the runs can contain a newline, and line
+ * and string runs also stop at a NUL, which the lexer reads as the end */
+
+size_t scan_spaces(const char *src, size_t len, size_t pos);
+size_t scan_line(const char *src, size_t len, size_t pos);
+size_t scan_string(const char *src, size_t len, size_t pos, char quote);
+size_t scan_ident(const char *src, size_t len, size_t pos);
+
+// Force the scalar loops, for comparing against the vector paths
+void        scan_use_scalar(void);
+const char *scan_impl_name(void);
+
+#endif
@@ -0,0 +1,130 @@
+#include "source.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "errors.h"
+
+void init_source(Source *source, const char *text, size_t len) {
+
+    size_t *starts = malloc(64 * sizeof(size_t));
+    if (!starts)
+        error_oom();
+
+    starts[0] = 0;
+
+    *source = (Source){.text        = text,
+                       .base        = 0,
+                       .len         = len,
+                       .line_starts = starts,
+                       .line_count  = 1,
+                       .line_cap    = 64};
+
+    if (len)
+        source_append(source, text, 0, len);
+}
+
+/* Index the line breaks in len bytes found at offset in the source. Every
+ * line break starts a line, including one right at the end */
+void source_append(Source     *source,
+                   const char *bytes,
+                   size_t      offset,
+                   size_t      len) {
+
+    const char *cursor = bytes;
+    const char *end    = bytes + len;
+    const char *nl;
+
+    while ((nl = memchr(cursor, '\n', (size_t)(end - cursor)))) {
+
+        if (source->line_count + 1 > source->line_cap) {
+
+            size_t new_cap  = source->line_cap * 2;
+            void  *temp_ptr = realloc(source->line_starts,
+                                     new_cap * sizeof(size_t));
+            if (!temp_ptr)
+                error_oom();
+
+            source->line_starts = temp_ptr;
+            source->line_cap    = new_cap;
+        }
+
+        source->line_starts[source->line_count++] =
+                offset + (size_t)(nl + 1 - bytes);
+        cursor = nl + 1;
+    }
+}
+
+void free_source(Source *source) {
+
+    free(source->line_starts);
+
+    *source = (Source){0};
+}
+
+/* Index of the last line starting at or before offset */
+static size_t find_line(const Source *source, size_t offset) {
+
+    size_t low  = 0;
+    size_t high = source->line_count;
+
+    while (high - low > 1) {
+
+        size_t mid = low + (high - low) / 2;
+
+        if (source->line_starts[mid] <= offset)
+            low = mid;
+        else
+            high = mid;
+    }
+
+    return low;
+}
+
+SourceSpan
+source_span(const Source *source, size_t offset, size_t span, size_t *hint) {
+
+    const size_t *starts = source->line_starts;
+    size_t        line;
+
+    if (hint && *hint < source->line_count && starts[*hint] <= offset) {
+
+        line = *hint;
+
+        while (line + 1 < source->line_count && starts[line + 1] <= offset)
+            line++;
+
+    } else {
+
+        line = find_line(source, offset);
+    }
+
+    if (hint)
+        *hint = line;
+
+    int column = (int)(offset - starts[line]) + 1;
+
+    return (SourceSpan){.line         = (int)line + 1,
+                        .column_start = column,
+                        .column_end   = column + (span ? (int)span - 1 : 0)};
+}
+
+/* The text of a line without its line break, as a slice of the source, or
+ * NULL once a stream has moved past it */
+const char *source_line(const Source *source, int line, size_t *len_out) {
+
+    if (!source->text || line <= 0 || (size_t)line > source->line_count)
+        return NULL;
+
+    size_t start = source->line_starts[line - 1];
+    size_t end   = (size_t)line < source->line_count
+                           ? source->line_starts[line] - 1
+                           : source->base + source->len;
+
+    if (start < source->base || end > source->base + source->len)
+        return NULL;
+
+    *len_out = end - start;
+
+    return source->text + (start - source->base);
+}
@@ -0,0 +1,44 @@
+#ifndef SOURCE_H
+#define SOURCE_H
+
+#include <stddef.h>
+
+/* The loaded source and the offset of the first byte of every line, built
+ * once so a byte offset turns into a line and column only when one is
+ * actually needed. A source streamed in is indexed as it arrives, and text
+ * only holds the part of it still in the lexer's window */
+typedef struct {
+
+    const char *text; // len bytes, possibly a read-only mapping
+    size_t      base; // Offset of text[0] in the whole source
+    size_t      len;
+    size_t     *line_starts;
+    size_t      line_count;
+    size_t      line_cap;
+
+} Source;
+
+// Line and columns of a span of bytes, all counted from 1
+typedef struct {
+
+    int line;
+    int column_start;
+    int column_end;
+
+} SourceSpan;
+
+void init_source(Source *source, const char *text, size_t len);
+void source_append(Source     *source,
+                   const char *bytes,
+                   size_t      offset,
+                   size_t      len);
+void free_source(Source *source);
+
+/* Locate offset..offset + span. hint, when given, holds the line of the
+ * previous lookup and makes a run of increasing offsets cost O(1) each */
+SourceSpan
+source_span(const Source *source, size_t offset, size_t span, size_t *hint);
+
+const char *source_line(const Source *source, int line, size_t *len_out);
+
+#endif
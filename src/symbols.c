@@ -0,0 +1,155 @@
+#include "symbols.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "errors.h"
+
+/* FNV-1a, computed once per declaration or reference and kept in the slot
+ * so probes only fall back to strcmp on a full hash match */
+uint64_t hash_symbol(const char *name) {
+
+    uint64_t hash = 14695981039346656037ULL;
+
+    for (const unsigned char *c = (const unsigned char *)name; *c; c++)
+        hash = (hash ^ *c) * 1099511628211ULL;
+
+    return hash;
+}
+
+/* Find the slot holding name, or the empty slot where it belongs */
+static Symbol *
+probe(const SymbolTable *table, const char *name, uint64_t hash) {
+
+    size_t mask = table->cap - 1;
+    size_t slot = (size_t)hash & mask;
+
+    while (table->slots[slot].name) {
+
+        Symbol *symbol = &table->slots[slot];
+
+        if (symbol->hash == hash && strcmp(symbol->name, name) == 0)
+            return symbol;
+
+        slot = (slot + 1) & mask;
+    }
+
+    return &table->slots[slot];
+}
+
+/* Double the slots and reinsert every key, keeping the table at most half
+ * full so probe sequences stay short */
+static void grow_slots(SymbolTable *table) {
+
+    size_t  new_cap = table->cap ? table->cap * 2 : 16;
+    Symbol *old     = table->slots;
+    size_t  old_cap = table->cap;
+
+    table->slots = calloc(new_cap, sizeof(Symbol));
+    if (!table->slots)
+        error_oom();
+
+    table->cap = new_cap;
+
+    for (size_t i = 0; i < old_cap; i++) {
+
+        if (old[i].name)
+            *probe(table, old[i].name, old[i].hash) = old[i];
+    }
+
+    free(old);
+}
+
+size_t find_symbol(const SymbolTable *table, const char *name, uint64_t hash) {
+
+    if (table->count == 0)
+        return SIZE_MAX;
+
+    Symbol *symbol = probe(table, name, hash);
+
+    return symbol->name ? symbol->indx : SIZE_MAX;
+}
+
+/* Bind name to indx, shadowing any visible binding until the innermost open
+ * scope closes */
+void bind_symbol(SymbolTable *table,
+                 const char  *name,
+                 uint64_t     hash,
+                 size_t       indx) {
+
+    if ((table->count + 1) * 2 > table->cap)
+        grow_slots(table);
+
+    Symbol *symbol = probe(table, name, hash);
+    bool    is_new = symbol->name == NULL;
+
+    if (table->mark_count > 0) {
+
+        if (table->saved_count + 1 > table->saved_cap) {
+
+            size_t new_cap  = table->saved_cap ? table->saved_cap * 2 : 16;
+            void  *temp_ptr = realloc(table->saved, new_cap * sizeof(Symbol));
+            if (!temp_ptr) {
+                free(table->saved);
+                error_oom();
+            }
+
+            table->saved     = temp_ptr;
+            table->saved_cap = new_cap;
+        }
+
+        table->saved[table->saved_count++] =
+                (Symbol){.name = name,
+                         .hash = hash,
+                         .indx = is_new ? SIZE_MAX : symbol->indx};
+    }
+
+    if (is_new)
+        table->count++;
+
+    symbol->name = name;
+    symbol->hash = hash;
+    symbol->indx = indx;
+}
+
+void open_scope(SymbolTable *table) {
+
+    if (table->mark_count + 1 > table->mark_cap) {
+
+        size_t new_cap  = table->mark_cap ? table->mark_cap * 2 : 8;
+        void  *temp_ptr = realloc(table->marks, new_cap * sizeof(size_t));
+        if (!temp_ptr) {
+            free(table->marks);
+            error_oom();
+        }
+
+        table->marks    = temp_ptr;
+        table->mark_cap = new_cap;
+    }
+
+    table->marks[table->mark_count++] = table->saved_count;
+}
+
+/* Undo the scope's bindings newest first, so a name bound twice in one
+ * scope ends up back at what was visible before the scope opened */
+void close_scope(SymbolTable *table) {
+
+    size_t mark = table->marks[--table->mark_count];
+
+    while (table->saved_count > mark) {
+
+        Symbol saved = table->saved[--table->saved_count];
+
+        probe(table, saved.name, saved.hash)->indx = saved.indx;
+    }
+}
+
+void free_symbols(SymbolTable *table) {
+
+    free(table->slots);
+    free(table->saved);
+    free(table->marks);
+
+    *table = (SymbolTable){0};
+}
@@ -0,0 +1,42 @@
+#ifndef SYMBOLS_H
+#define SYMBOLS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct {
+
+    const char *name; // Borrowed from the table that owns the symbol
+    uint64_t    hash;
+    size_t      indx; // SIZE_MAX once the binding has gone out of scope
+
+} Symbol;
+
+typedef struct {
+
+    Symbol *slots; // Open-addressed, a NULL name marks an empty slot
+    size_t  count;
+    size_t  cap;
+
+    // Bindings shadowed inside open scopes, restored when each one closes
+    Symbol *saved;
+    size_t  saved_count;
+    size_t  saved_cap;
+
+    size_t *marks;
+    size_t  mark_count;
+    size_t  mark_cap;
+
+} SymbolTable;
+
+uint64_t hash_symbol(const char *name);
+size_t   find_symbol(const SymbolTable *table, const char *name, uint64_t hash);
+void     bind_symbol(SymbolTable *table,
+                     const char  *name,
+                     uint64_t     hash,
+                     size_t       indx);
+void     open_scope(SymbolTable *table);
+void     close_scope(SymbolTable *table);
+void     free_symbols(SymbolTable *table);
+
+#endif
@@ -0,0 +1,264 @@
+#include "verifier.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "errors.h"
+
+/* Operand width and fixed stack effect of an opcode, OP_CALL and OP_RET
+ * depend on the function involved and are handled separately */
+typedef struct {
+
+    bool    valid;
+    uint8_t operand_len;
+    uint8_t pops;
+    uint8_t pushes;
+
+} OpInfo;
+
+// clang-format off
+static const OpInfo OP_INFO[] = {
+    [OP_PUSH_CONST]          = { true, 2, 0, 1 },
+    [OP_PRINT]               = { true, 0, 1, 0 },
+    [OP_SET_GLOBAL]          = { true, 2, 1, 0 },
+    [OP_GET_GLOBAL]          = { true, 2, 0, 1 },
+    [OP_SET_LOCAL]           = { true, 2, 1, 0 },
+    [OP_GET_LOCAL]           = { true, 2, 0, 1 },
+    [OP_CALL]                = { true, 2, 0, 0 },
+    [OP_RET]                 = { true, 0, 0, 0 },
+    [OP_JUMP]                = { true, 2, 0, 0 },
+    [OP_JUMP_IF_FALSE]       = { true, 2, 1, 0 },
+    [OP_NOT]                 = { true, 0, 1, 1 },
+    [OP_AND]                 = { true, 0, 2, 1 },
+    [OP_OR]                  = { true, 0, 2, 1 },
+    [OP_EQUAL_INT]           = { true, 0, 2, 1 },
+    [OP_EQUAL_FLOAT]         = { true, 0, 2, 1 },
+    [OP_EQUAL_BOOL]          = { true, 0, 2, 1 },
+    [OP_EQUAL_STR]           = { true, 0, 2, 1 },
+    [OP_LESS_INT]            = { true, 0, 2, 1 },
+    [OP_LESS_FLOAT]          = { true, 0, 2, 1 },
+    [OP_GREATER_INT]         = { true, 0, 2, 1 },
+    [OP_GREATER_FLOAT]       = { true, 0, 2, 1 },
+    [OP_LESS_EQUAL_INT]      = { true, 0, 2, 1 },
+    [OP_LESS_EQUAL_FLOAT]    = { true, 0, 2, 1 },
+    [OP_GREATER_EQUAL_INT]   = { true, 0, 2, 1 },
+    [OP_GREATER_EQUAL_FLOAT] = { true, 0, 2, 1 },
+    [OP_NEG_INT]             = { true, 0, 1, 1 },
+    [OP_NEG_FLOAT]           = { true, 0, 1, 1 },
+    [OP_ADD_INT]             = { true, 0, 2, 1 },
+    [OP_ADD_FLOAT]           = { true, 0, 2, 1 },
+    [OP_SUB_INT]             = { true, 0, 2, 1 },
+    [OP_SUB_FLOAT]           = { true, 0, 2, 1 },
+    [OP_MUL_INT]             = { true, 0, 2, 1 },
+    [OP_MUL_FLOAT]           = { true, 0, 2, 1 },
+    [OP_DIV_INT]             = { true, 0, 2, 1 },
+    [OP_DIV_FLOAT]           = { true, 0, 2, 1 },
+    [OP_POP]                 = { true, 0, 1, 0 },
+    [OP_HALT]                = { true, 0, 0, 0 },
+    [OP_NO_RETURN]           = { true, 0, 0, 0 }
+};
+// clang-format on
+
+#define OP_INFO_COUNT (sizeof(OP_INFO) / sizeof(OP_INFO[0]))
+
+/* Per-byte state shared by every function walked, so code reached from two
+ * functions or decoded at two different boundaries is caught */
+typedef struct {
+
+    const Emitter *emitter;
+    size_t        *owner; // 0 = unvisited, otherwise function number + 1
+    bool          *is_operand;
+    long          *depth;
+    size_t        *worklist;
+    size_t         work_count;
+
+} Verifier;
+
+static uint16_t operand_at(const Emitter *emitter, size_t pos) {
+
+    return (uint16_t)((emitter->code[pos] << 8) | emitter->code[pos + 1]);
+}
+
+/* Record that control reaches pos with the given stack depth, queueing it
+ * the first time it is seen */
+static void
+reach(Verifier *verifier, size_t pos, long depth, size_t owner, size_t from) {
+
+    if (pos >= verifier->emitter->code_len)
+        error_invalid_bytecode(from, "control leaves the code");
+    if (verifier->is_operand[pos])
+        error_invalid_bytecode(from, "jump into an operand");
+
+    if (verifier->owner[pos] == 0) {
+
+        verifier->owner[pos] = owner;
+        verifier->depth[pos] = depth;
+
+        verifier->worklist[verifier->work_count++] = pos;
+        return;
+    }
+
+    if (verifier->owner[pos] != owner)
+        error_invalid_bytecode(from, "control crosses into another function");
+    if (verifier->depth[pos] != depth)
+        error_invalid_bytecode(pos, "stack depth differs between paths");
+}
+
+static void
+verify_function(Verifier *verifier, const FunctionDef *fn, size_t owner) {
+
+    const Emitter *emitter = verifier->emitter;
+
+    if (fn->local_count < fn->param_count)
+        error_invalid_bytecode(fn->start_ip, "fewer locals than parameters");
+
+    reach(verifier, fn->start_ip, 0, owner, fn->start_ip);
+
+    while (verifier->work_count > 0) {
+
+        size_t  pos   = verifier->worklist[--verifier->work_count];
+        long    depth = verifier->depth[pos];
+        uint8_t op    = emitter->code[pos];
+
+        if (op >= OP_INFO_COUNT || !OP_INFO[op].valid)
+            error_invalid_opcode((ErrorLocation){0}, op);
+
+        OpInfo info = OP_INFO[op];
+        size_t next = pos + 1 + info.operand_len;
+
+        if (next > emitter->code_len)
+            error_vm_oob((ErrorLocation){0});
+
+        for (size_t i = pos + 1; i < next; i++) {
+
+            if (verifier->owner[i] != 0)
+                error_invalid_bytecode(pos, "operand overlaps an instruction");
+
+            verifier->is_operand[i] = true;
+        }
+
+        uint16_t operand = info.operand_len ? operand_at(emitter, pos + 1) : 0;
+        long     pops    = info.pops;
+        long     pushes  = info.pushes;
+
+        switch (op) {
+
+            case OP_PUSH_CONST:
+                if (operand >= emitter->const_count)
+                    error_invalid_const_index((ErrorLocation){0},
+                                              emitter->const_count);
+                break;
+
+            case OP_SET_GLOBAL:
+            case OP_GET_GLOBAL:
+                if (operand >= emitter->global_count)
+                    error_invalid_var_index((ErrorLocation){0},
+                                            emitter->global_count);
+                break;
+
+            case OP_SET_LOCAL:
+            case OP_GET_LOCAL:
+                if (operand >= fn->local_count)
+                    error_invalid_var_index((ErrorLocation){0},
+                                            fn->local_count);
+                break;
+
+            case OP_CALL: {
+
+                if (operand >= emitter->func_count)
+                    error_invalid_bytecode(pos, "unknown function");
+
+                const FunctionDef *callee = &emitter->functions[operand];
+
+                if (!callee->compiled)
+                    error_invalid_bytecode(pos, "call to uncompiled function");
+
+                pops   = (long)callee->param_count;
+                pushes = callee->return_type != TOK_VOID_T ? 1 : 0;
+
+            } break;
+
+            default:
+                break;
+        }
+
+        if (depth < pops)
+            error_invalid_bytecode(pos, "stack underflow");
+
+        depth += pushes - pops;
+
+        // The VM sizes each frame's window from this, so it must hold
+        if (depth > (long)fn->max_stack)
+            error_invalid_bytecode(pos, "stack exceeds the recorded maximum");
+
+        switch (op) {
+
+            case OP_RET: {
+
+                long expected = fn->return_type != TOK_VOID_T ? 1 : 0;
+
+                if (depth != expected)
+                    error_invalid_bytecode(pos, "unbalanced stack at return");
+
+            } break;
+
+            case OP_HALT:
+                if (depth != 0)
+                    error_invalid_bytecode(pos, "unbalanced stack at halt");
+                break;
+
+            case OP_NO_RETURN:
+                break;
+
+            // Targets are counted from the start of the function
+            case OP_JUMP:
+                reach(verifier, fn->start_ip + operand, depth, owner, pos);
+                break;
+
+            case OP_JUMP_IF_FALSE:
+                reach(verifier, fn->start_ip + operand, depth, owner, pos);
+                reach(verifier, next, depth, owner, pos);
+                break;
+
+            default:
+                reach(verifier, next, depth, owner, pos);
+                break;
+        }
+    }
+}
+
+/* Prove once, before the VM runs, that every reachable instruction decodes
+ * cleanly, stays inside its own function, only touches valid constants,
+ * globals, locals and functions, and keeps the operand stack balanced and
+ * within each function's recorded maximum. The interpreter relies on this
+ * and performs none of these checks itself */
+void verify_program(const Emitter *emitter) {
+
+    size_t code_len = emitter->code_len;
+
+    Verifier verifier = {.emitter    = emitter,
+                         .owner      = calloc(code_len, sizeof(size_t)),
+                         .is_operand = calloc(code_len, sizeof(bool)),
+                         .depth      = calloc(code_len, sizeof(long)),
+                         .worklist   = calloc(code_len, sizeof(size_t)),
+                         .work_count = 0};
+
+    if (code_len &&
+        (!verifier.owner || !verifier.is_operand || !verifier.depth ||
+         !verifier.worklist))
+        error_oom();
+
+    verify_function(&verifier, &emitter->entry, 1);
+
+    // Functions left out of a lazy compile have no code to verify
+    for (size_t i = 0; i < emitter->func_count; i++)
+        if (emitter->functions[i].compiled)
+            verify_function(&verifier, &emitter->functions[i], i + 2);
+
+    free(verifier.owner);
+    free(verifier.is_operand);
+    free(verifier.depth);
+    free(verifier.worklist);
+}
@@ -0,0 +1,8 @@
+#ifndef VERIFIER_H
+#define VERIFIER_H
+
+#include "codegen.h"
+
+void verify_program(const Emitter *emitter);
+
+#endif
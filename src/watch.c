@@ -0,0 +1,875 @@
+#include "watch.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "checker.h"
+#include "errors.h"
+
+// Changes are found by polling the file's size and modification time,
+// wherever POSIX has them
+#ifdef _POSIX_C_SOURCE
+#    define WATCH_POSIX 1
+#    include <sys/stat.h>
+#    include <time.h>
+#endif
+
+// Time between looks at the file
+#define WATCH_POLL_NS 100000000L
+
+/* A top-level declaration and what was compiled from it. Units tile the
+ * source, each running from its first token to the next one's */
+typedef struct {
+
+    size_t          start; // Offset of its first token
+    AstDeclaration *decl;
+    size_t          parsed_in; // Round, lines in the tree are as of then
+    Arena           arena;     // Its tree and everything compiled from it
+    size_t          slot;      // In the function table, for a function
+
+    // The body of entry or a function as last compiled, and the round it
+    // was compiled in. Its constants are still in a pool of its own
+    Emitter     part;
+    FunctionDef body;
+    bool        compiled;
+    size_t      compiled_in;
+
+} WatchUnit;
+
+/* A function or global by name, with the types bodies were checked against
+ * while it has held its slot */
+typedef struct {
+
+    char      *name;
+    TokenType  type; // The global's, or the function's return type
+    TokenType *params;
+    size_t     param_count;
+    size_t     changed_in; // Round it was taken or its types changed in
+
+} WatchSlot;
+
+/* A function or a global as declared this round */
+typedef struct {
+
+    WatchUnit *unit;
+    char      *name;
+    TokenType  type;
+    AstParam  *params;
+    size_t     param_count;
+
+} WatchName;
+
+typedef struct {
+
+    WatchSlot *slots;
+    size_t     count;
+    size_t     cap;
+
+} SlotTable;
+
+struct Watch {
+
+    const char *path;
+    char       *text; // As last parsed, and indexed by source
+    size_t      len;
+    Source      source;
+    char       *next_text; // Read since, and not parsed yet
+    size_t      next_len;
+
+    WatchUnit *units; // In source order
+    size_t     unit_count;
+    size_t     unit_cap;
+
+    // Parsed from an edit, and spliced in once it all parses
+    WatchUnit *fresh;
+    size_t     fresh_count;
+    size_t     fresh_cap;
+    Lexer      lexer;
+    Parser     parser;
+
+    SlotTable functions;
+    SlotTable globals;
+
+    // This round's functions or globals, and their slot order, kept between
+    // rounds so an error registering them leaves nothing behind
+    WatchName *names;
+    size_t     name_count;
+    size_t     name_cap;
+    size_t    *order;
+    bool      *placed;
+    size_t     order_cap;
+
+    // Bodies compiled before the last round a global was freed or changed
+    // type may use it as it was, and are compiled again
+    size_t round;
+    size_t broken_in;
+
+    // The program, rebuilt every round from the units, and the arenas of
+    // units parsed again, which it may still point into until the next
+    Arena      arena;
+    Arena      retired;
+    Emitter    program;
+    WatchUnit *compiling;
+    size_t     compiled_count;
+
+#ifdef WATCH_POSIX
+    struct timespec mtime;
+    off_t           size;
+#endif
+};
+
+/* Make room for one more item in a growable array */
+static void *reserve(void *items, size_t count, size_t *cap, size_t size) {
+
+    if (count + 1 <= *cap)
+        return items;
+
+    size_t new_cap  = *cap ? *cap * 2 : 16;
+    void  *temp_ptr = realloc(items, new_cap * size);
+    if (!temp_ptr) {
+        free(items);
+        error_oom();
+    }
+
+    *cap = new_cap;
+
+    return temp_ptr;
+}
+
+/* Read the whole file, or NULL if it can't be opened, as an editor saving
+ * it may briefly leave it missing */
+static char *read_file(const char *path, size_t *len_out) {
+
+    FILE *file = fopen(path, "rb");
+    if (!file)
+        return NULL;
+
+    char  *buffer = NULL;
+    size_t len    = 0;
+    size_t cap    = 0;
+
+    for (;;) {
+
+        if (len + 4096 > cap) {
+
+            cap            = cap ? cap * 2 : 65536;
+            void *temp_ptr = realloc(buffer, cap);
+            if (!temp_ptr) {
+                free(buffer);
+                error_oom();
+            }
+
+            buffer = temp_ptr;
+        }
+
+        size_t got = fread(buffer + len, 1, cap - len, file);
+        len += got;
+
+        if (got == 0)
+            break;
+    }
+
+    fclose(file);
+
+    *len_out = len;
+
+    return buffer;
+}
+
+#ifdef WATCH_POSIX
+/* Note the file's size and modification time, true if either changed */
+static bool stat_changed(Watch *watch) {
+
+    struct stat info;
+
+    if (stat(watch->path, &info) != 0)
+        return false;
+
+    bool changed = info.st_size != watch->size ||
+                   info.st_mtim.tv_sec != watch->mtime.tv_sec ||
+                   info.st_mtim.tv_nsec != watch->mtime.tv_nsec;
+
+    watch->size  = info.st_size;
+    watch->mtime = info.st_mtim;
+
+    return changed;
+}
+#endif
+
+/* Start watching the file at path, reading it for the first compile */
+Watch *open_watch(const char *path) {
+
+    Watch *watch = calloc(1, sizeof(Watch));
+    if (!watch)
+        error_oom();
+
+    watch->path = path;
+
+    // Noted first, so a change while it is read is still seen
+#ifdef WATCH_POSIX
+    stat_changed(watch);
+#endif
+
+    watch->next_text = read_file(path, &watch->next_len);
+    if (!watch->next_text)
+        error_ifnf(path);
+
+    init_source(&watch->source, NULL, 0);
+    error_set_lines(&watch->source);
+
+    return watch;
+}
+
+/* Wait for the file to change and read it. Without POSIX there is nothing
+ * to wait with, and this returns false at once */
+bool wait_for_change(Watch *watch) {
+
+#ifdef WATCH_POSIX
+    for (;;) {
+
+        nanosleep(&(struct timespec){.tv_nsec = WATCH_POLL_NS}, NULL);
+
+        if (!stat_changed(watch))
+            continue;
+
+        size_t len  = 0;
+        char  *text = read_file(watch->path, &len);
+
+        if (!text)
+            continue;
+
+        free(watch->next_text);
+        watch->next_text = text;
+        watch->next_len  = len;
+
+        return true;
+    }
+#else
+    (void)watch;
+
+    return false;
+#endif
+}
+
+static void free_unit(WatchUnit *unit) {
+
+    if (unit->compiled)
+        free_part(&unit->part);
+
+    arena_free(&unit->arena);
+}
+
+/* Index of the last unit starting at or before offset, which must be at or
+ * after the first one's start */
+static size_t find_unit(const Watch *watch, size_t offset) {
+
+    size_t low  = 0;
+    size_t high = watch->unit_count;
+
+    while (high - low > 1) {
+
+        size_t mid = low + (high - low) / 2;
+
+        if (watch->units[mid].start <= offset)
+            low = mid;
+        else
+            high = mid;
+    }
+
+    return low;
+}
+
+/* Parse the declaration the parser is on into unit's arena */
+static void parse_unit(Parser *parser, WatchUnit *unit, size_t round) {
+
+    parser->nodes        = &unit->arena;
+    parser->lexer->arena = &unit->arena;
+    unit->start          = parser->look.offset;
+    unit->parsed_in      = round;
+    unit->decl           = parse_declaration(parser);
+}
+
+/* Parse again what an edit changed, from the unit the byte before it is
+ * in, as the token ending there may run into it, up to the first
+ * declaration past it that starts where one started before. From there on
+ * the text is the same, only moved, and those units are kept as they are */
+static void update_units(Watch *watch) {
+
+    const char *old_text = watch->text;
+    const char *new_text = watch->next_text;
+    size_t      old_len  = watch->len;
+    size_t      new_len  = watch->next_len;
+    size_t      limit    = old_len < new_len ? old_len : new_len;
+    size_t      prefix   = 0;
+    size_t      suffix   = 0;
+
+    while (prefix < limit && old_text[prefix] == new_text[prefix])
+        prefix++;
+
+    while (suffix < limit - prefix &&
+           old_text[old_len - 1 - suffix] == new_text[new_len - 1 - suffix])
+        suffix++;
+
+    size_t first   = 0;
+    size_t restart = 0;
+
+    if (watch->unit_count && prefix > 0 &&
+        prefix - 1 >= watch->units[0].start) {
+
+        first   = find_unit(watch, prefix - 1);
+        restart = watch->units[first].start;
+    }
+
+    free_source(&watch->source);
+    init_source(&watch->source, new_text, new_len);
+
+    watch->lexer  = init_lexer(&watch->source, watch->path, &watch->arena);
+    watch->parser = init_parser(&watch->lexer, NULL, NULL, false);
+    seek_parser(&watch->parser, restart);
+
+    size_t resume = watch->unit_count;
+
+    while (watch->parser.look.type != TOK_EOF) {
+
+        size_t at = watch->parser.look.offset;
+
+        if (at >= new_len - suffix) {
+
+            size_t old_at = at + old_len - new_len;
+            size_t found  = find_unit(watch, old_at);
+
+            if (watch->units[found].start == old_at) {
+
+                resume = found;
+                break;
+            }
+        }
+
+        watch->fresh = reserve(watch->fresh,
+                               watch->fresh_count,
+                               &watch->fresh_cap,
+                               sizeof(WatchUnit));
+
+        WatchUnit *unit = &watch->fresh[watch->fresh_count++];
+
+        *unit = (WatchUnit){0};
+        parse_unit(&watch->parser, unit, watch->round);
+    }
+
+    free_parser(&watch->parser);
+
+    // Splice the new units in place of the ones they replace
+    size_t kept  = watch->unit_count - resume;
+    size_t count = first + watch->fresh_count + kept;
+
+    for (size_t i = first; i < resume; i++)
+        free_unit(&watch->units[i]);
+
+    if (count > watch->unit_cap) {
+
+        size_t new_cap = watch->unit_cap * 2 > count ? watch->unit_cap * 2
+                                                     : count;
+        void  *temp_ptr = realloc(watch->units, new_cap * sizeof(WatchUnit));
+        if (!temp_ptr)
+            error_oom();
+
+        watch->units    = temp_ptr;
+        watch->unit_cap = new_cap;
+    }
+
+    // An empty source has no units at all
+    if (count) {
+
+        memmove(watch->units + first + watch->fresh_count,
+                watch->units + resume,
+                kept * sizeof(WatchUnit));
+        memcpy(watch->units + first,
+               watch->fresh,
+               watch->fresh_count * sizeof(WatchUnit));
+    }
+
+    for (size_t i = count - kept; i < count; i++)
+        watch->units[i].start = watch->units[i].start + new_len - old_len;
+
+    watch->unit_count  = count;
+    watch->fresh_count = 0;
+
+    free(watch->text);
+    watch->text      = watch->next_text;
+    watch->len       = new_len;
+    watch->next_text = NULL;
+}
+
+/* An edit failed to parse. What it parsed goes, and the units stay as they
+ * were for the text before it */
+static void drop_update(Watch *watch) {
+
+    for (size_t i = 0; i < watch->fresh_count; i++)
+        free_unit(&watch->fresh[i]);
+
+    watch->fresh_count = 0;
+
+    free_parser(&watch->parser);
+    free(watch->next_text);
+    watch->next_text = NULL;
+
+    free_source(&watch->source);
+    init_source(&watch->source, watch->text, watch->len);
+}
+
+/* Parse a unit's declaration again where it is now, into a new arena, so
+ * the lines in its tree are right for any error checking it raises. The
+ * program was registered from the old tree, so that is kept for the round.
+ * Anything compiled from it goes with it */
+static void reparse_unit(Watch *watch, WatchUnit *unit) {
+
+    if (unit->parsed_in == watch->round)
+        return;
+
+    if (unit->compiled)
+        free_part(&unit->part);
+
+    unit->compiled = false;
+    arena_adopt(&watch->retired, &unit->arena);
+
+    Lexer  lexer  = init_lexer(&watch->source, watch->path, &unit->arena);
+    Parser parser = init_parser(&lexer, NULL, NULL, false);
+
+    seek_parser(&parser, unit->start);
+    parse_unit(&parser, unit, watch->round);
+    free_parser(&parser);
+}
+
+static void copy_types(WatchSlot *slot, const WatchName *name) {
+
+    void *temp_ptr =
+            realloc(slot->params, (name->param_count + 1) * sizeof(TokenType));
+    if (!temp_ptr)
+        error_oom();
+
+    slot->type        = name->type;
+    slot->params      = temp_ptr;
+    slot->param_count = name->param_count;
+
+    for (size_t i = 0; i < name->param_count; i++)
+        slot->params[i] = name->params[i].type;
+}
+
+static bool same_types(const WatchSlot *slot, const WatchName *name) {
+
+    if (slot->type != name->type || slot->param_count != name->param_count)
+        return false;
+
+    for (size_t i = 0; i < name->param_count; i++)
+        if (slot->params[i] != name->params[i].type)
+            return false;
+
+    return true;
+}
+
+static size_t first_named(const SymbolTable *index, const char *name) {
+
+    return find_symbol(index, name, hash_symbol(name));
+}
+
+/* Put this round's names in slot order, noting in each slot the round it
+ * last changed in, and returning whether any did now. Names keep the slots
+ * they had and new ones take the next, while the last slot moves into the
+ * hole a name that is gone leaves. Taking a new slot is no change, as
+ * nothing compiled can refer to a name before it exists. A name declared
+ * again comes last, where registering it fails for a function and never
+ * gets resolved to for a global */
+static bool order_slots(Watch *watch, SlotTable *table) {
+
+    const WatchName *names   = watch->names;
+    size_t           count   = watch->name_count;
+    size_t          *order   = watch->order;
+    bool            *placed  = watch->placed;
+    SymbolTable      index   = {0};
+    size_t           n       = 0;
+    bool             changed = false;
+
+    if (count)
+        memset(placed, 0, count * sizeof(bool));
+
+    for (size_t i = 0; i < count; i++)
+        if (first_named(&index, names[i].name) == SIZE_MAX)
+            bind_symbol(&index, names[i].name, hash_symbol(names[i].name), i);
+
+    for (size_t s = 0; s < table->count;) {
+
+        WatchSlot *slot = &table->slots[s];
+        size_t     i    = first_named(&index, slot->name);
+
+        if (i == SIZE_MAX) {
+
+            free(slot->name);
+            free(slot->params);
+
+            *slot            = table->slots[--table->count];
+            slot->changed_in = watch->round;
+            changed          = true;
+            continue;
+        }
+
+        if (!same_types(slot, &names[i])) {
+
+            copy_types(slot, &names[i]);
+            slot->changed_in = watch->round;
+            changed          = true;
+        }
+
+        s++;
+    }
+
+    for (size_t s = 0; s < table->count; s++) {
+
+        size_t i = first_named(&index, table->slots[s].name);
+
+        order[n++] = i;
+        placed[i]  = true;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+
+        if (placed[i] || first_named(&index, names[i].name) != i)
+            continue;
+
+        table->slots = reserve(
+                table->slots, table->count, &table->cap, sizeof(WatchSlot));
+
+        WatchSlot *slot = &table->slots[table->count++];
+
+        *slot = (WatchSlot){.name       = malloc(strlen(names[i].name) + 1),
+                            .changed_in = watch->round};
+        if (!slot->name)
+            error_oom();
+
+        strcpy(slot->name, names[i].name);
+        copy_types(slot, &names[i]);
+
+        order[n++] = i;
+        placed[i]  = true;
+    }
+
+    for (size_t i = 0; i < count; i++)
+        if (!placed[i])
+            order[n++] = i;
+
+    free_symbols(&index);
+
+    return changed;
+}
+
+static void add_name(Watch *watch, WatchName name) {
+
+    watch->names = reserve(
+            watch->names, watch->name_count, &watch->name_cap, sizeof(name));
+    watch->names[watch->name_count++] = name;
+}
+
+/* Gather every function, or every global, declared this round */
+static void collect_names(Watch *watch, DeclarationTag tag) {
+
+    watch->name_count = 0;
+
+    for (size_t u = 0; u < watch->unit_count; u++) {
+
+        WatchUnit      *unit = &watch->units[u];
+        AstDeclaration *decl = unit->decl;
+
+        if (decl->tag != tag)
+            continue;
+
+        if (tag == DEC_FUNC)
+            add_name(watch,
+                     (WatchName){.unit        = unit,
+                                 .name        = decl->func.name,
+                                 .type        = decl->func.return_type,
+                                 .params      = decl->func.params,
+                                 .param_count = decl->func.param_count});
+        else
+            for (size_t v = 0; v < decl->var_decl.var_count; v++)
+                add_name(watch,
+                         (WatchName){.unit = unit,
+                                     .name = decl->var_decl.var_names[v],
+                                     .type = decl->var_decl.var_type});
+    }
+
+    if (watch->order_cap < watch->name_cap) {
+
+        size_t cap      = watch->name_cap;
+        void  *temp_ptr = realloc(watch->order, cap * sizeof(size_t));
+        if (!temp_ptr)
+            error_oom();
+
+        watch->order = temp_ptr;
+        temp_ptr     = realloc(watch->placed, cap * sizeof(bool));
+        if (!temp_ptr)
+            error_oom();
+
+        watch->placed    = temp_ptr;
+        watch->order_cap = cap;
+    }
+}
+
+/* Register every function and global in slot order */
+static void declare_units(Watch *watch) {
+
+    Emitter *program = &watch->program;
+
+    init_emitter(program, &watch->arena);
+
+    collect_names(watch, DEC_FUNC);
+    order_slots(watch, &watch->functions);
+
+    for (size_t i = 0; i < watch->name_count; i++) {
+
+        WatchUnit *unit = watch->names[watch->order[i]].unit;
+
+        // Every body is compiled, so none is queued for it as calls are met
+        unit->slot = i;
+        declare_function(program, unit->decl)->compiled = true;
+    }
+
+    collect_names(watch, DEC_VAR);
+
+    // Calls are listed in every body, but reads and writes of globals are
+    // not, so any change to one holds none of the bodies
+    if (order_slots(watch, &watch->globals))
+        watch->broken_in = watch->round;
+
+    for (size_t i = 0; i < watch->name_count; i++)
+        declare_global(program,
+                       watch->names[watch->order[i]].name,
+                       watch->names[watch->order[i]].type);
+}
+
+/* Whether a body as compiled last still holds, as long as nothing it calls
+ * has changed slot or types since */
+static bool still_holds(const Watch *watch, const WatchUnit *unit) {
+
+    if (!unit->compiled || unit->compiled_in < watch->broken_in)
+        return false;
+
+    const SlotTable *table = &watch->functions;
+
+    for (size_t c = 0; c < unit->body.callee_count; c++) {
+
+        size_t callee = unit->body.callees[c];
+
+        if (callee >= table->count ||
+            table->slots[callee].changed_in > unit->compiled_in)
+            return false;
+    }
+
+    return true;
+}
+
+/* Check and emit a unit's body into a part of its own, unless what was
+ * compiled last time still holds. A body compiled before is parsed again
+ * first, which also keeps the unit's arena from growing with every compile */
+static void compile_unit(Watch *watch, WatchUnit *unit, FunctionDef *fn) {
+
+    if (still_holds(watch, unit))
+        return;
+
+    reparse_unit(watch, unit);
+
+    watch->compiling = unit;
+    init_part(&unit->part, &watch->program, &unit->arena);
+
+    unit->part.recover = true;
+
+    // Entry ends in a halt only as the part's own entry
+    if (unit->decl->tag == DEC_ENTRY)
+        fn = &unit->part.entry;
+
+    compile_body(&unit->part, fn, unit->decl);
+
+    watch->compiling  = NULL;
+    unit->body        = *fn;
+    unit->compiled    = true;
+    unit->compiled_in = watch->round;
+    watch->compiled_count++;
+}
+
+/* Compile a unit, or report why it can't be and go on with the next, so an
+ * error in one body doesn't hide those in bodies checked after it against
+ * its declared signature. A unit that failed is compiled again next round */
+static void recover_unit(Watch       *watch,
+                         WatchUnit   *unit,
+                         FunctionDef *fn,
+                         bool         repeated) {
+
+    jmp_buf           recover;
+    jmp_buf *volatile outer = error_recover(&recover);
+
+    if (setjmp(recover)) {
+
+        error_recover(outer);
+
+        if (watch->compiling) {
+
+            free_part(&watch->compiling->part);
+            watch->compiling = NULL;
+        }
+
+        unit->compiled = false;
+
+        return;
+    }
+
+    if (repeated) {
+
+        reparse_unit(watch, unit);
+
+        ErrorLocation loc = {.line      = unit->decl->line,
+                             .col_start = unit->decl->column_start,
+                             .col_end   = unit->decl->column_end};
+        error_multiple_entry(loc);
+    }
+
+    compile_unit(watch, unit, fn);
+
+    error_recover(outer);
+}
+
+/* Entry first, then every function in source order, as check_program()
+ * goes, reporting every error before giving up. A unit that failed is
+ * compiled again next round and a second entry is found again, so a round
+ * reports every error the file still has, in source order like a compile
+ * from scratch, and not only those in what changed */
+static void compile_units(Watch *watch) {
+
+    WatchUnit *entry  = NULL;
+    size_t     errors = error_count();
+
+    for (size_t u = 0; u < watch->unit_count; u++) {
+
+        WatchUnit *unit = &watch->units[u];
+
+        if (unit->decl->tag != DEC_ENTRY)
+            continue;
+
+        recover_unit(watch, unit, &watch->program.entry, entry != NULL);
+        entry = unit;
+    }
+
+    for (size_t u = 0; u < watch->unit_count; u++) {
+
+        WatchUnit *unit = &watch->units[u];
+
+        if (unit->decl->tag == DEC_FUNC)
+            recover_unit(watch,
+                         unit,
+                         &watch->program.functions[unit->slot],
+                         false);
+    }
+
+    if (!entry)
+        error_no_entry();
+
+    if (error_count() > errors)
+        error_fail();
+}
+
+/* Copy a unit's body into the program after everything so far */
+static void link_unit(Emitter *program, FunctionDef *fn, WatchUnit *unit) {
+
+    const FunctionDef *body = &unit->body;
+    CodeSpan           span = {.code_start  = 0,
+                               .code_end    = unit->part.code_len,
+                               .fixup_start = 0,
+                               .fixup_end   = unit->part.fixup_count};
+
+    size_t *map = calloc(unit->part.const_count + 1, sizeof(size_t));
+    if (!map)
+        error_oom();
+
+    fn->has_return   = body->has_return;
+    fn->local_names  = body->local_names;
+    fn->local_types  = body->local_types;
+    fn->local_count  = body->local_count;
+    fn->local_cap    = body->local_cap;
+    fn->max_stack    = body->max_stack;
+    fn->callees      = body->callees;
+    fn->callee_count = body->callee_count;
+    fn->callee_cap   = body->callee_cap;
+    fn->compiled     = true;
+
+    link_function(program, fn, &unit->part, &span, map);
+
+    free(map);
+}
+
+static void link_units(Watch *watch) {
+
+    Emitter *program = &watch->program;
+
+    for (size_t u = 0; u < watch->unit_count; u++)
+        if (watch->units[u].decl->tag == DEC_ENTRY)
+            link_unit(program, &program->entry, &watch->units[u]);
+
+    for (size_t u = 0; u < watch->unit_count; u++) {
+
+        WatchUnit *unit = &watch->units[u];
+
+        if (unit->decl->tag == DEC_FUNC)
+            link_unit(program, &program->functions[unit->slot], unit);
+    }
+
+    bound_program(program);
+}
+
+/* Bring the program up to date with the file as last read, returning it
+ * along with how many bodies had to be compiled, or NULL once an error has
+ * been reported. The program stays valid until the next call */
+Emitter *compile_watched(Watch *watch, size_t *compiled_out) {
+
+    jmp_buf catch;
+
+    // Whatever ran from the last round's program is done with it
+    free_emitter(&watch->program);
+    arena_free(&watch->arena);
+    arena_free(&watch->retired);
+
+    watch->program        = (Emitter){0};
+    watch->compiled_count = 0;
+    watch->round++;
+
+    if (setjmp(catch)) {
+
+        error_catch(NULL);
+        report_exit(1);
+
+        if (watch->next_text)
+            drop_update(watch);
+
+        if (watch->compiling) {
+
+            free_part(&watch->compiling->part);
+            watch->compiling = NULL;
+        }
+
+        *compiled_out = watch->compiled_count;
+
+        return NULL;
+    }
+
+    error_catch(&catch);
+
+    if (watch->next_text)
+        update_units(watch);
+
+    declare_units(watch);
+    compile_units(watch);
+    link_units(watch);
+
+    error_catch(NULL);
+
+    *compiled_out = watch->compiled_count;
+
+    return &watch->program;
+}
@@ -0,0 +1,22 @@
+#ifndef WATCH_H
+#define WATCH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "codegen.h"
+
+/* A source kept compiled between edits. Each top-level declaration is a
+ * unit holding its tree and the position independent code of its body, so
+ * after an edit only the declarations it touched are lexed and parsed
+ * again, and only bodies that changed, or that use a function or global
+ * whose slot or type changed, are checked and emitted again. The rest is
+ * linked in as it was. Functions and globals keep their slots in the order
+ * they first appeared while they exist, so adding one moves nothing */
+typedef struct Watch Watch;
+
+Watch   *open_watch(const char *path);
+bool     wait_for_change(Watch *watch);
+Emitter *compile_watched(Watch *watch, size_t *compiled_out);
+
+#endif